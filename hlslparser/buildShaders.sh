@@ -63,6 +63,9 @@ parserOptions=""
 # preserve comments
 parserOptions+="-g -line "
 
+# only regenerate outputs whose source, includes or options changed
+parserOptions+="-cache ${dstDir}cache "
+
 pushd out/mac
 
 # build the metal shaders
@@ -5,9 +5,6 @@
 #include <string.h> // strcmp, strcasecmp
 #include <stdlib.h>	// strtod, strtol
 
-// this is usually just an unordered_map internally
-#include <unordered_set>
-
 namespace M4 {
 
 // Engine/String.cpp
@@ -235,9 +232,8 @@ void Log_ErrorArgList(const char * format, va_list args, const char* filename, u
     va_list tmp;
     va_copy(tmp, args);
     
-    // Not thread-safe
-    static std::string buffer;
-    buffer.clear();
+    // local so that errors can be logged from multiple threads
+    std::string buffer;
     String_PrintfArgList(buffer, format, tmp);
     
     // TODO: this doesn't work on Win/Android
@@ -252,91 +248,193 @@ void Log_ErrorArgList(const char * format, va_list args, const char* filename, u
 }
 
 
-// Engine/StringPool.cpp
-
-using StringPoolSet = std::unordered_set<const char*, CompareAndHandStrings, CompareAndHandStrings>;
+// Engine/Allocator.cpp
 
-#define CastImpl(imp) (StringPoolSet*)imp
+Allocator::~Allocator() {
+    Block* block = m_firstBlock;
+    while (block) {
+        Block* next = block->next;
+        free(block);
+        block = next;
+    }
+}
 
-StringPool::StringPool(Allocator * allocator) {
-    // NOTE: allocator not used
+void* Allocator::Allocate(size_t size, size_t alignment) {
+    if (size == 0)
+        size = 1;
     
-    m_impl = new StringPoolSet();
+    // reuse blocks kept from before Reset, skip ones that are too small
+    while (m_currentBlock) {
+        uintptr_t base = (uintptr_t)m_currentBlock->GetData();
+        uintptr_t start = (base + m_currentBlock->offset + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        if (start + size <= base + m_currentBlock->size) {
+            m_currentBlock->offset = (size_t)(start - base) + size;
+            m_lastAllocation = (void*)start;
+            return m_lastAllocation;
+        }
+        
+        m_currentBlock = m_currentBlock->next;
+        if (m_currentBlock)
+            m_currentBlock->offset = 0;
+    }
+    
+    // large allocations get their own block
+    size_t dataSize = size + alignment;
+    if (dataSize < kBlockSize)
+        dataSize = kBlockSize;
+    
+    Block* block = (Block*)malloc(sizeof(Block) + dataSize);
+    if (block == NULL)
+        return NULL;
+    
+    block->next = NULL;
+    block->size = dataSize;
+    block->offset = 0;
+    
+    if (m_lastBlock)
+        m_lastBlock->next = block;
+    else
+        m_firstBlock = block;
+    m_lastBlock = block;
+    m_currentBlock = block;
+    
+    return Allocate(size, alignment);
 }
-StringPool::~StringPool() {
-    auto* impl = CastImpl(m_impl);
+
+void* Allocator::Reallocate(void* ptr, size_t oldSize, size_t size, size_t alignment) {
+    if (ptr == NULL)
+        return Allocate(size, alignment);
     
-    // delete the strings
-    for (auto it : *impl) {
-        const char* text = it;
-        free((char*)text);
+    // grow or shrink the last allocation in place
+    if (ptr == m_lastAllocation && m_currentBlock) {
+        size_t offset = (size_t)((char*)ptr - m_currentBlock->GetData());
+        if (offset + size <= m_currentBlock->size) {
+            m_currentBlock->offset = offset + (size ? size : 1);
+            return ptr;
+        }
     }
     
-    delete impl;
+    if (size <= oldSize)
+        return ptr;
+    
+    void* newPtr = Allocate(size, alignment);
+    if (newPtr)
+        memcpy(newPtr, ptr, oldSize);
+    return newPtr;
 }
 
-const char * StringPool::AddString(const char * text) {
-    auto* impl = CastImpl(m_impl);
-    auto it = impl->find(text);
-    if (it != impl->end())
-        return *it;
-    
-    // _strdup doesn't go through allocator either
-#if _MSC_VER
-    const char * dup = _strdup(text);
-#else
-    const char * dup = strdup(text);
-#endif
+void Allocator::Reset() {
+    m_currentBlock = m_firstBlock;
+    if (m_currentBlock)
+        m_currentBlock->offset = 0;
+    m_lastAllocation = NULL;
+}
+
+size_t Allocator::GetUsedSize() const {
+    if (m_currentBlock == NULL)
+        return 0;
     
-    impl->insert(dup);
-    return dup;
+    size_t size = 0;
+    for (Block* block = m_firstBlock; block != m_currentBlock; block = block->next)
+        size += block->offset;
+    return size + m_currentBlock->offset;
 }
 
-const char* StringPool::PrintFormattedVaList(const char* fmt, va_list args) {
-    char* res = nullptr;
+size_t Allocator::GetReservedSize() const {
+    size_t size = 0;
+    for (Block* block = m_firstBlock; block; block = block->next)
+        size += block->size;
+    return size;
+}
+
+// Engine/StringPool.cpp
+
+StringPool::StringPool(Allocator * allocator) : m_allocator(allocator) {
+}
+StringPool::~StringPool() {
+    // strings and table are released with the allocator
+}
+
+uint32_t StringPool::FindSlot(const char * text, uint32_t hash) const {
+    uint32_t mask = m_capacity - 1;
+    uint32_t slot = hash & mask;
     
-    va_list tmp;
+    // linear probe until the string or an empty slot is found
+    while (true) {
+        const Entry& entry = m_entries[slot];
+        if (entry.text == NULL)
+            return slot;
+        if (entry.hash == hash && String_Equal(entry.text, text))
+            return slot;
+        slot = (slot + 1) & mask;
+    }
+}
 
-    // va_copy needed?
-    va_copy(tmp, args);
+void StringPool::Grow() {
+    Entry* oldEntries = m_entries;
+    uint32_t oldCapacity = m_capacity;
     
-    // just call 2x, once for len
-    int len = vsnprintf(nullptr, 0, fmt, tmp);
-    if (len >= 0)
-    {
-        res = (char*)malloc(len+1);
-        vsnprintf(res, len+1, fmt, tmp);
+    m_capacity = oldCapacity ? oldCapacity * 2 : 256;
+    m_entries = m_allocator->New<Entry>(m_capacity);
+    memset(m_entries, 0, sizeof(Entry) * m_capacity);
+    
+    for (uint32_t i = 0; i < oldCapacity; ++i) {
+        const Entry& entry = oldEntries[i];
+        if (entry.text)
+            m_entries[FindSlot(entry.text, entry.hash)] = entry;
     }
-    va_end(tmp);
+    
+    m_allocator->Delete(oldEntries);
+}
 
-    // caller responsible for freeing mem
-    return res;
+const char * StringPool::AddString(const char * text) {
+    // keep load under 70%
+    if ((m_count + 1) * 10 > m_capacity * 7)
+        Grow();
+    
+    uint32_t hash = HashFnv1a(text);
+    Entry& entry = m_entries[FindSlot(text, hash)];
+    if (entry.text)
+        return entry.text;
+    
+    size_t length = strlen(text) + 1;
+    char * dup = m_allocator->New<char>(length);
+    memcpy(dup, text, length);
+    
+    entry.text = dup;
+    entry.hash = hash;
+    m_count++;
+    return dup;
 }
 
 const char * StringPool::AddStringFormatList(const char * format, va_list args) {
     // don't format if no tokens
+    if (!String_HasChar(format, '%'))
+        return AddString(format);
+    
+    // most names fit on the stack
+    char buffer[256];
+    
     va_list tmp;
     va_copy(tmp, args);
-    const char * text = PrintFormattedVaList(format, tmp);
+    int len = vsnprintf(buffer, sizeof(buffer), format, tmp);
     va_end(tmp);
-
-    auto* impl = CastImpl(m_impl);
     
-    // add it if not found
-    auto it = impl->find(text);
-    if (it == impl->end())
-    {
-        impl->insert(text);
-        return text;
-    }
+    if (len < 0)
+        return NULL;
+    if (len < (int)sizeof(buffer))
+        return AddString(buffer);
+    
+    std::string text;
+    text.resize(len);
+    va_copy(tmp, args);
+    vsnprintf(&text[0], len+1, format, tmp);
+    va_end(tmp);
     
-    // allocated inside PrintFormattedVaList
-    free((char*)text);
-    return *it;
+    return AddString(text.c_str());
 }
 
 const char * StringPool::AddStringFormat(const char * format, ...) {
-    // TODO: don't format if no tokens
     va_list args;
     va_start(args, format);
     const char * string = AddStringFormatList(format, args);
@@ -346,8 +444,9 @@ const char * StringPool::AddStringFormat(const char * format, ...) {
 }
 
 bool StringPool::GetContainsString(const char * text) const {
-    const auto* impl = CastImpl(m_impl);
-    return impl->find(text) != impl->end();
+    if (m_count == 0)
+        return false;
+    return m_entries[FindSlot(text, HashFnv1a(text))].text != NULL;
 }
 
 } // M4 namespace
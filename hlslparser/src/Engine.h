@@ -36,24 +36,61 @@ namespace M4 {
 
 // Engine/Allocator.h
 
-// This doesn't do placement new/delete, but is only
-// use to allocate NodePage and StringPool.  Then placement
-// new/delete is called explicitly by say NewNode.  So
-// there default ctor variable initializers are safe to use.
+// This is an arena that NodePage, StringPool and Array allocate from.
+// Memory is only released by Reset or destruction, so keep one per
+// translation unit or per thread, and Reset it between units.  The blocks
+// are kept, so later units don't go back to malloc.  This doesn't do
+// placement new/delete, but NewNode calls placement new/delete explicitly.
+// So there default ctor variable initializers are safe to use.
 class Allocator {
 public:
+    Allocator() {}
+    ~Allocator();
+    
+    Allocator(const Allocator&) = delete;
+    Allocator& operator=(const Allocator&) = delete;
+    
     template <typename T> T * New() {
-        return (T *)malloc(sizeof(T));
+        return (T *)Allocate(sizeof(T), alignof(T));
     }
     template <typename T> T * New(size_t count) {
-        return (T *)malloc(sizeof(T) * count);
+        return (T *)Allocate(sizeof(T) * count, alignof(T));
     }
     template <typename T> void Delete(T * ptr) {
-        free((void *)ptr);
+        // released on Reset
+        (void)ptr;
     }
-    template <typename T> T * Realloc(T * ptr, size_t count) {
-        return (T *)realloc(ptr, sizeof(T) * count);
+    template <typename T> T * Realloc(T * ptr, size_t oldCount, size_t count) {
+        return (T *)Reallocate(ptr, sizeof(T) * oldCount, sizeof(T) * count, alignof(T));
     }
+    
+    void* Allocate(size_t size, size_t alignment);
+    
+    // grows in place if ptr was the last allocation, like realloc this moves bytes
+    void* Reallocate(void* ptr, size_t oldSize, size_t size, size_t alignment);
+    
+    // Release all allocations, but keep the blocks for reuse.
+    void Reset();
+    
+    size_t GetUsedSize() const;
+    size_t GetReservedSize() const;
+    
+private:
+    struct Block {
+        Block*  next;
+        size_t  size;   // of data
+        size_t  offset; // used bytes of data
+        size_t  padding;
+        
+        char* GetData() { return (char*)(this + 1); }
+    };
+    
+    static const size_t kBlockSize = 64 * 1024;
+    
+    Block*  m_firstBlock = NULL;
+    Block*  m_lastBlock = NULL;
+    Block*  m_currentBlock = NULL;
+    void*   m_lastAllocation = NULL;
 };
 
 
@@ -102,6 +139,17 @@ inline uint32_t HashFnv1a(const char* val, uint32_t hash = 0x811c9dc5)
     return hash;
 }
 
+// 64-bit fnv1a over a buffer, for content hashes where collisions matter
+inline uint64_t HashFnv1a64(const char* data, size_t length, uint64_t hash = 0xcbf29ce484222325ull)
+{
+    const uint64_t prime = 0x100000001b3ull;
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash = (hash ^ (uint8_t)data[i]) * prime;
+    }
+    return hash;
+}
+
 // this compares string stored as const char*
 struct CompareAndHandStrings
 {
@@ -220,7 +268,7 @@ private:
         }
         else {
             // realloc the buffer
-            buffer = allocator->Realloc<T>(buffer, new_capacity);
+            buffer = allocator->Realloc<T>(buffer, capacity, new_capacity);
         }
 
         capacity = new_capacity;
@@ -237,7 +285,9 @@ private:
 
 // Engine/StringPool.h
 
-// @@ Implement this with a hash table!
+// Interns strings, so that equal strings return the same pointer.  This is
+// an open addressing table with linear probing, and the strings and table
+// are stored in the allocator.
 struct StringPool {
     StringPool(Allocator * allocator);
     ~StringPool();
@@ -247,8 +297,18 @@ struct StringPool {
     const char * AddStringFormatList(const char * fmt, va_list args);
     bool GetContainsString(const char * text) const;
 private:
-    const char*PrintFormattedVaList(const char* fmt, va_list args);
-    void* m_impl = NULL;
+    struct Entry {
+        const char* text;
+        uint32_t    hash;
+    };
+    
+    uint32_t FindSlot(const char * text, uint32_t hash) const;
+    void Grow();
+    
+    Allocator*  m_allocator = NULL;
+    Entry*      m_entries = NULL;
+    uint32_t    m_capacity = 0; // power of 2
+    uint32_t    m_count = 0;
 };
 
 
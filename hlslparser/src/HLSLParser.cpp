@@ -772,7 +772,8 @@ static const EffectState pipelineStates[] = {
 */
 
 // Note: these strings need to live until end of the app
-StringPool gStringPool(NULL);
+static Allocator gStringAllocator;
+StringPool gStringPool(&gStringAllocator);
 
 enum All
 {
@@ -1887,9 +1888,7 @@ static bool GetBinaryOpResultType(HLSLBinaryOp binaryOp, const HLSLType& type1,
 
 HLSLParser::HLSLParser(Allocator* allocator, const char* fileName, const char* buffer, size_t length) : 
     m_tokenizer(fileName, buffer, length),
-    m_userTypes(allocator),
-    m_variables(allocator),
-    m_functions(allocator)
+    m_variables(allocator)
 {
     m_numGlobals = 0;
     m_tree = NULL;
@@ -2046,7 +2045,7 @@ bool HLSLParser::ParseTopLevel(HLSLStatement*& statement)
         HLSLStruct* structure = m_tree->AddNode<HLSLStruct>(fileName, line);
         structure->name = structName;
 
-        m_userTypes.PushBack(structure);
+        m_userTypes.emplace(structure->name, structure);
  
         HLSLStructField* lastField = NULL;
 
@@ -2238,7 +2237,7 @@ bool HLSLParser::ParseTopLevel(HLSLStatement*& statement)
                 // Add a function entry so that calls can refer to it
                 if (!declaration)
                 {
-                    m_functions.PushBack( function );
+                    AddFunction( function );
                     statement = function;
                 }
                 EndScope();
@@ -2263,7 +2262,7 @@ bool HLSLParser::ParseTopLevel(HLSLStatement*& statement)
             }
             else
             {
-                m_functions.PushBack( function );
+                AddFunction( function );
             }
 
             if (!Expect('{') || !ParseBlock(function->statement, function->returnType))
@@ -4590,12 +4589,10 @@ const HLSLStruct* HLSLParser::FindUserDefinedType(const char* name) const
 {
     // Pointer comparison is sufficient for strings since they exist in the
     // string pool.
-    for (int i = 0; i < m_userTypes.GetSize(); ++i)
+    auto it = m_userTypes.find(name);
+    if (it != m_userTypes.end())
     {
-        if (m_userTypes[i]->name == name)
-        {
-            return m_userTypes[i];
-        }
+        return it->second;
     }
     return NULL;
 }
@@ -4627,6 +4624,7 @@ void HLSLParser::BeginScope()
     // Use NULL as a sentinel that indices a new scope level.
     Variable& variable = m_variables.PushBackNew();
     variable.name = NULL;
+    variable.shadowedIndex = -1;
 }
 
 void HLSLParser::EndScope()
@@ -4634,6 +4632,13 @@ void HLSLParser::EndScope()
     int numVariables = m_variables.GetSize() - 1;
     while (m_variables[numVariables].name != NULL)
     {
+        // uncover any variable of the same name in an outer scope
+        const Variable& variable = m_variables[numVariables];
+        if (variable.shadowedIndex >= 0)
+            m_variableIndices[variable.name] = variable.shadowedIndex;
+        else
+            m_variableIndices.erase(variable.name);
+        
         --numVariables;
         ASSERT(numVariables >= 0);
     }
@@ -4642,13 +4647,12 @@ void HLSLParser::EndScope()
 
 const HLSLType* HLSLParser::FindVariable(const char* name, bool& global) const
 {
-    for (int i = m_variables.GetSize() - 1; i >= 0; --i)
+    auto it = m_variableIndices.find(name);
+    if (it != m_variableIndices.end())
     {
-        if (m_variables[i].name == name)
-        {
-            global = (i < m_numGlobals);
-            return &m_variables[i].type;
-        }
+        int i = it->second;
+        global = (i < m_numGlobals);
+        return &m_variables[i].type;
     }
     return NULL;
 }
@@ -4656,12 +4660,10 @@ const HLSLType* HLSLParser::FindVariable(const char* name, bool& global) const
 // This only search user-defined c-style functions.  Intrinsics are not in this.
 const HLSLFunction* HLSLParser::FindFunction(const char* name) const
 {
-    for (int i = 0; i < m_functions.GetSize(); ++i)
+    auto it = m_functions.find(name);
+    if (it != m_functions.end())
     {
-        if (m_functions[i]->name == name)
-        {
-            return m_functions[i];
-        }
+        return it->second.front();
     }
     return NULL;
 }
@@ -4693,39 +4695,61 @@ static bool AreArgumentListsEqual(HLSLTree* tree, HLSLArgument* lhs, HLSLArgumen
 
 const HLSLFunction* HLSLParser::FindFunction(const HLSLFunction* fun) const
 {
-    for (int i = 0; i < m_functions.GetSize(); ++i)
+    auto it = m_functions.find(fun->name);
+    if (it == m_functions.end())
     {
-        if (m_functions[i]->name == fun->name &&
-            AreTypesEqual(m_tree, m_functions[i]->returnType, fun->returnType) &&
-            AreArgumentListsEqual(m_tree, m_functions[i]->argument, fun->argument))
+        return NULL;
+    }
+    
+    for (const HLSLFunction* function : it->second)
+    {
+        if (AreTypesEqual(m_tree, function->returnType, fun->returnType) &&
+            AreArgumentListsEqual(m_tree, function->argument, fun->argument))
         {
-            return m_functions[i];
+            return function;
         }
     }
     return NULL;
 }
 
+void HLSLParser::AddFunction(HLSLFunction* function)
+{
+    m_functions[function->name].push_back(function);
+}
+
 void HLSLParser::DeclareVariable(const char* name, const HLSLType& type)
 {
     if (m_variables.GetSize() == m_numGlobals)
     {
         ++m_numGlobals;
     }
+    
+    int index = m_variables.GetSize();
+    
     Variable& variable = m_variables.PushBackNew();
     variable.name = name;
     variable.type = type;
+    variable.shadowedIndex = -1;
+    
+    auto it = m_variableIndices.find(name);
+    if (it != m_variableIndices.end())
+    {
+        variable.shadowedIndex = it->second;
+        it->second = index;
+    }
+    else
+    {
+        m_variableIndices.emplace(name, index);
+    }
 }
 
 bool HLSLParser::GetIsFunction(const char* name) const
 {
     // check user defined functions
-    for (int i = 0; i < m_functions.GetSize(); ++i)
+    // == is ok here because we're passed the strings through the string pool.
+    if (m_functions.find(name) != m_functions.end())
     {
-        // == is ok here because we're passed the strings through the string pool.
-        if (m_functions[i]->name == name)
-        {
-            return true;
-        }
+        return true;
     }
     
     // see if it's an intrinsic
@@ -4743,10 +4767,10 @@ const HLSLFunction* HLSLParser::MatchFunctionCall(const HLSLFunctionCall* functi
 
     // Get the user defined c functions with the specified name.
     // There may be more than one, and these are not ordered.
-    for (int i = 0; i < m_functions.GetSize(); ++i)
+    const auto& overloads = m_functions.find(name);
+    if (overloads != m_functions.end())
     {
-        const HLSLFunction* function = m_functions[i];
-        if (function->name == name)
+        for (const HLSLFunction* function : overloads->second)
         {
             nameMatches = true;
             
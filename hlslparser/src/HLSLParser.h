@@ -14,6 +14,9 @@
 #include "HLSLTokenizer.h"
 #include "HLSLTree.h"
 
+#include <unordered_map>
+#include <vector>
+
 namespace M4
 {
 
@@ -137,14 +140,23 @@ private:
     {
         const char*     name;
         HLSLType        type;
+        int             shadowedIndex; // same name in an outer scope, or -1
     };
 
+    void AddFunction(HLSLFunction* function);
+
+    // Names are all from the tree's string pool, so these hash and compare
+    // the pointers and not the strings.
+    using FunctionOverloads = std::vector<HLSLFunction*>;
+    
     HLSLTokenizer           m_tokenizer;
-    Array<HLSLStruct*>      m_userTypes;
     Array<Variable>         m_variables;
-    Array<HLSLFunction*>    m_functions;
     int                     m_numGlobals;
 
+    std::unordered_map<const char*, HLSLStruct*>        m_userTypes;
+    std::unordered_map<const char*, int>                m_variableIndices; // innermost in m_variables
+    std::unordered_map<const char*, FunctionOverloads>  m_functions; // in declaration order
+
     HLSLTree*               m_tree;
     
     bool                    m_allowUndeclaredIdentifiers = false;
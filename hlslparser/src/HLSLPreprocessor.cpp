@@ -0,0 +1,1197 @@
+#include "HLSLPreprocessor.h"
+
+#include "Engine.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <mutex>
+
+namespace M4
+{
+
+enum HLSLPPLineType
+{
+    HLSLPPLine_Text,
+    HLSLPPLine_Blank,       // null directive, or #pragma that isn't once
+    HLSLPPLine_Define,
+    HLSLPPLine_Undef,
+    HLSLPPLine_Include,
+    HLSLPPLine_If,
+    HLSLPPLine_Ifdef,
+    HLSLPPLine_Ifndef,
+    HLSLPPLine_Elif,
+    HLSLPPLine_Else,
+    HLSLPPLine_Endif,
+    HLSLPPLine_PragmaOnce,
+    HLSLPPLine_Error,
+    HLSLPPLine_Line,        // passed through to the tokenizer
+    HLSLPPLine_Invalid,     // only reported if reached in an active block
+};
+
+// One logical line of a source file.  Directives are already parsed,
+// and text lines are split into tokens for macro replacement.
+struct HLSLPPLine
+{
+    HLSLPPLineType type = HLSLPPLine_Text;
+    int lineNumber = 0;
+    int numLines = 1; // physical lines, > 1 with continuations
+
+    std::string text; // text line, macro/include name, or error message
+    bool hasIdentifiers = false;
+    bool isSystemInclude = false;
+
+    HLSLPPMacro macro;
+    std::vector<HLSLPPToken> tokens; // text line or #if/#elif expression
+};
+
+struct HLSLPPFile
+{
+    size_t length = 0;
+    std::vector<HLSLPPLine> lines;
+};
+
+static const uint32_t kMaxIncludeDepth = 32;
+
+//-----------------------------------------
+
+static bool IsIdentifierStart(char c)
+{
+    return isalpha((unsigned char)c) || c == '_';
+}
+
+static bool IsIdentifierChar(char c)
+{
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+// Multi-character operators that are evaluated in #if.
+static const char* _ppOperators[] =
+{
+    "&&", "||", "==", "!=", "<=", ">=", "<<", ">>", "##",
+};
+
+// Splits [start, end) into tokens that concatenate back to the original text.
+// inBlockComment carries a /* */ comment across lines.
+static void TokenizeLine(const char* start, const char* end, bool& inBlockComment, std::vector<HLSLPPToken>& tokens)
+{
+    const char* p = start;
+    while (p < end)
+    {
+        HLSLPPToken token;
+        const char* tokenStart = p;
+
+        if (inBlockComment || (p[0] == '/' && p + 1 < end && p[1] == '*'))
+        {
+            if (!inBlockComment)
+                p += 2;
+            inBlockComment = true;
+            while (p < end)
+            {
+                if (p[0] == '*' && p + 1 < end && p[1] == '/')
+                {
+                    p += 2;
+                    inBlockComment = false;
+                    break;
+                }
+                ++p;
+            }
+            token.type = HLSLPPToken_Comment;
+        }
+        else if (p[0] == '/' && p + 1 < end && p[1] == '/')
+        {
+            p = end;
+            token.type = HLSLPPToken_Comment;
+        }
+        else if (isspace((unsigned char)p[0]))
+        {
+            while (p < end && isspace((unsigned char)p[0]))
+                ++p;
+            token.type = HLSLPPToken_Whitespace;
+        }
+        else if (IsIdentifierStart(p[0]))
+        {
+            while (p < end && IsIdentifierChar(p[0]))
+                ++p;
+            token.type = HLSLPPToken_Identifier;
+        }
+        else if (isdigit((unsigned char)p[0]) || (p[0] == '.' && p + 1 < end && isdigit((unsigned char)p[1])))
+        {
+            // pp-number, so suffixes like 1.0f and 1e-5 stay as one token
+            while (p < end)
+            {
+                if ((p[0] == '+' || p[0] == '-') && (p[-1] == 'e' || p[-1] == 'E'))
+                    ++p;
+                else if (IsIdentifierChar(p[0]) || p[0] == '.')
+                    ++p;
+                else
+                    break;
+            }
+            token.type = HLSLPPToken_Number;
+        }
+        else if (p[0] == '"')
+        {
+            ++p;
+            while (p < end && p[0] != '"')
+            {
+                if (p[0] == '\\' && p + 1 < end)
+                    ++p;
+                ++p;
+            }
+            if (p < end)
+                ++p;
+            token.type = HLSLPPToken_String;
+        }
+        else
+        {
+            p++;
+            for (const char* op : _ppOperators)
+            {
+                if (p < end && tokenStart[0] == op[0] && p[0] == op[1])
+                {
+                    p++;
+                    break;
+                }
+            }
+            token.type = HLSLPPToken_Symbol;
+        }
+
+        token.text.assign(tokenStart, p - tokenStart);
+        tokens.push_back(std::move(token));
+    }
+}
+
+// Drops comments and leading/trailing whitespace from directive tokens.
+static void TrimTokens(std::vector<HLSLPPToken>& tokens)
+{
+    std::vector<HLSLPPToken> result;
+    for (auto& token : tokens)
+    {
+        if (token.type == HLSLPPToken_Comment)
+        {
+            token.type = HLSLPPToken_Whitespace;
+            token.text = " ";
+        }
+        if (token.type == HLSLPPToken_Whitespace && (result.empty() || result.back().type == HLSLPPToken_Whitespace))
+            continue;
+        result.push_back(std::move(token));
+    }
+    while (!result.empty() && result.back().type == HLSLPPToken_Whitespace)
+        result.pop_back();
+    tokens.swap(result);
+}
+
+static void SetInvalid(HLSLPPLine& line, const char* message)
+{
+    line.type = HLSLPPLine_Invalid;
+    line.text = message;
+}
+
+// directive is the text after the #, with continuations joined
+// inBlockComment is the file state, since a /* on a directive can span lines.
+static void ParseDirective(const std::string& directive, bool& inBlockComment, HLSLPPLine& line)
+{
+    std::vector<HLSLPPToken> tokens;
+    TokenizeLine(directive.data(), directive.data() + directive.size(), inBlockComment, tokens);
+    TrimTokens(tokens);
+
+    if (tokens.empty())
+    {
+        line.type = HLSLPPLine_Blank;
+        return;
+    }
+    if (tokens[0].type != HLSLPPToken_Identifier)
+    {
+        SetInvalid(line, "Expected preprocessor directive after #");
+        return;
+    }
+
+    const std::string& name = tokens[0].text;
+
+    // skip the directive name and any whitespace after it
+    uint32_t pos = 1;
+    if (pos < tokens.size() && tokens[pos].type == HLSLPPToken_Whitespace)
+        pos++;
+
+    std::vector<HLSLPPToken> args(tokens.begin() + pos, tokens.end());
+
+    if (name == "define")
+    {
+        if (args.empty() || args[0].type != HLSLPPToken_Identifier)
+        {
+            SetInvalid(line, "Expected macro name after #define");
+            return;
+        }
+        line.type = HLSLPPLine_Define;
+        line.text = args[0].text;
+
+        // function-like only if ( immediately follows the name
+        uint32_t i = 1;
+        if (i < args.size() && args[i].text == "(")
+        {
+            line.macro.isFunctionLike = true;
+            i++;
+
+            bool isClosed = false;
+            bool expectParam = true;
+            for (; i < args.size(); ++i)
+            {
+                const HLSLPPToken& token = args[i];
+                if (token.type == HLSLPPToken_Whitespace)
+                    continue;
+
+                if (token.text == ")" && (!expectParam || line.macro.params.empty()))
+                {
+                    isClosed = true;
+                    i++;
+                    break;
+                }
+                else if (expectParam && token.type == HLSLPPToken_Identifier)
+                {
+                    line.macro.params.push_back(token.text);
+                    expectParam = false;
+                }
+                else if (!expectParam && token.text == ",")
+                {
+                    expectParam = true;
+                }
+                else
+                {
+                    SetInvalid(line, "Invalid macro parameter list");
+                    return;
+                }
+            }
+
+            if (!isClosed)
+            {
+                SetInvalid(line, "Expected ) in macro parameter list");
+                return;
+            }
+        }
+
+        if (i < args.size() && args[i].type == HLSLPPToken_Whitespace)
+            i++;
+
+        line.macro.body.assign(args.begin() + i, args.end());
+
+        for (const auto& token : line.macro.body)
+        {
+            if (token.text == "#" || token.text == "##")
+            {
+                SetInvalid(line, "Stringizing and token pasting are not supported in macros");
+                return;
+            }
+        }
+    }
+    else if (name == "undef" || name == "ifdef" || name == "ifndef")
+    {
+        if (args.empty() || args[0].type != HLSLPPToken_Identifier)
+        {
+            SetInvalid(line, "Expected macro name after directive");
+            return;
+        }
+        line.type = (name == "undef") ? HLSLPPLine_Undef :
+                    (name == "ifdef") ? HLSLPPLine_Ifdef : HLSLPPLine_Ifndef;
+        line.text = args[0].text;
+    }
+    else if (name == "include")
+    {
+        // reassemble the text, since <> aren't tokenized as a string
+        std::string path;
+        for (const auto& token : args)
+            path += token.text;
+
+        size_t length = path.size();
+        if (length >= 2 && path[0] == '"' && path[length-1] == '"')
+        {
+            line.isSystemInclude = false;
+        }
+        else if (length >= 2 && path[0] == '<' && path[length-1] == '>')
+        {
+            line.isSystemInclude = true;
+        }
+        else
+        {
+            SetInvalid(line, "Expected \"file\" or <file> after #include");
+            return;
+        }
+        line.type = HLSLPPLine_Include;
+        line.text = path.substr(1, length - 2);
+    }
+    else if (name == "if" || name == "elif")
+    {
+        if (args.empty())
+        {
+            SetInvalid(line, "Expected expression after #if");
+            return;
+        }
+        line.type = (name == "if") ? HLSLPPLine_If : HLSLPPLine_Elif;
+        line.tokens = std::move(args);
+    }
+    else if (name == "else" || name == "endif")
+    {
+        line.type = (name == "else") ? HLSLPPLine_Else : HLSLPPLine_Endif;
+    }
+    else if (name == "pragma")
+    {
+        bool isOnce = args.size() == 1 && args[0].text == "once";
+        line.type = isOnce ? HLSLPPLine_PragmaOnce : HLSLPPLine_Blank;
+    }
+    else if (name == "error")
+    {
+        line.type = HLSLPPLine_Error;
+        for (const auto& token : args)
+            line.text += token.text;
+    }
+    else if (name == "line")
+    {
+        line.type = HLSLPPLine_Line;
+        line.text = "#" + directive;
+    }
+    else
+    {
+        line.type = HLSLPPLine_Invalid;
+        line.text = "Unsupported preprocessor directive #" + name;
+    }
+}
+
+static void ParseFile(const char* buffer, size_t length, HLSLPPFile& file)
+{
+    file.length = length;
+
+    const char* p = buffer;
+    const char* end = buffer + length;
+    int lineNumber = 1;
+    bool inBlockComment = false;
+
+    // directives aren't output, so neither is the rest of a comment they open
+    bool inDirectiveComment = false;
+
+    while (p < end)
+    {
+        const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+        if (lineEnd == nullptr)
+            lineEnd = end;
+
+        HLSLPPLine line;
+        line.lineNumber = lineNumber;
+
+        const char* s = p;
+        while (s < lineEnd && (*s == ' ' || *s == '\t'))
+            ++s;
+
+        if (!inBlockComment && s < lineEnd && *s == '#')
+        {
+            // join any continuation lines
+            std::string directive(s + 1, lineEnd - (s + 1));
+            while (true)
+            {
+                while (!directive.empty() && directive.back() == '\r')
+                    directive.pop_back();
+                if (directive.empty() || directive.back() != '\\' || lineEnd >= end)
+                    break;
+
+                directive.back() = ' ';
+                p = lineEnd + 1;
+                lineEnd = (const char*)memchr(p, '\n', end - p);
+                if (lineEnd == nullptr)
+                    lineEnd = end;
+                directive.append(p, lineEnd - p);
+                line.numLines++;
+            }
+
+            ParseDirective(directive, inBlockComment, line);
+            inDirectiveComment = inBlockComment;
+        }
+        else
+        {
+            line.type = HLSLPPLine_Text;
+            line.text.assign(p, lineEnd - p);
+            TokenizeLine(p, lineEnd, inBlockComment, line.tokens);
+
+            if (inDirectiveComment)
+            {
+                // the line starts with the comment token, drop it so an unmatched */ isn't output
+                inDirectiveComment = inBlockComment;
+                if (!line.tokens.empty())
+                {
+                    line.text.erase(0, line.tokens[0].text.size());
+                    line.tokens.erase(line.tokens.begin());
+                }
+            }
+
+            for (const auto& token : line.tokens)
+            {
+                if (token.type == HLSLPPToken_Identifier)
+                {
+                    line.hasIdentifiers = true;
+                    break;
+                }
+            }
+
+            // don't hold onto tokens that will never be replaced
+            if (!line.hasIdentifiers)
+                line.tokens.clear();
+        }
+
+        lineNumber += line.numLines;
+        file.lines.push_back(std::move(line));
+
+        p = lineEnd + 1;
+    }
+}
+
+//-----------------------------------------
+// The parsed file cache is shared by all preprocessors in the process,
+// and only depends on file content.  Macro state is applied on top of it.
+
+using HLSLPPFileCache = std::unordered_map<uint64_t, std::shared_ptr<const HLSLPPFile>>;
+
+static std::mutex gFileCacheLock;
+static HLSLPPFileCache gFileCache;
+static uint32_t gFileCacheHits = 0;
+static uint32_t gFileCacheMisses = 0;
+
+static std::shared_ptr<const HLSLPPFile> GetParsedFile(const char* buffer, size_t length)
+{
+    uint64_t hash = HashFnv1a64(buffer, length);
+
+    {
+        std::lock_guard<std::mutex> lock(gFileCacheLock);
+        auto it = gFileCache.find(hash);
+        if (it != gFileCache.end() && it->second->length == length)
+        {
+            gFileCacheHits++;
+            return it->second;
+        }
+    }
+
+    // parse outside of the lock, two threads may both parse the same
+    // file the first time, but that's simpler than waiting on the other.
+    auto file = std::make_shared<HLSLPPFile>();
+    ParseFile(buffer, length, *file);
+
+    std::lock_guard<std::mutex> lock(gFileCacheLock);
+    gFileCacheMisses++;
+    gFileCache[hash] = file;
+    return file;
+}
+
+void HLSLPreprocessor::GetCacheStats(uint32_t& numHits, uint32_t& numMisses)
+{
+    std::lock_guard<std::mutex> lock(gFileCacheLock);
+    numHits = gFileCacheHits;
+    numMisses = gFileCacheMisses;
+}
+
+void HLSLPreprocessor::ClearCache()
+{
+    std::lock_guard<std::mutex> lock(gFileCacheLock);
+    gFileCache.clear();
+    gFileCacheHits = 0;
+    gFileCacheMisses = 0;
+}
+
+static bool ReadFileText(const char* fileName, std::string& text)
+{
+    FILE* fp = fopen(fileName, "rb");
+    if (!fp)
+        return false;
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    bool success = size >= 0;
+    if (success)
+    {
+        text.resize(size);
+        success = fread((char*)text.data(), 1, size, fp) == (size_t)size;
+    }
+    fclose(fp);
+    return success;
+}
+
+//-----------------------------------------
+
+HLSLPreprocessor::HLSLPreprocessor(const HLSLPreprocessorOptions& options) :
+    m_options(options)
+{
+}
+
+HLSLPreprocessor::~HLSLPreprocessor()
+{
+}
+
+void HLSLPreprocessor::Error(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    Log_ErrorArgList(format, args, m_fileName, m_lineNumber);
+    va_end(args);
+}
+
+bool HLSLPreprocessor::Preprocess(const char* fileName, const char* buffer, size_t length, std::string& output)
+{
+    m_macros.clear();
+    m_onceFiles.clear();
+    m_expanding.clear();
+    m_files.clear();
+
+    for (const auto& define : m_options.defines)
+    {
+        // NAME or NAME=value, where an empty value is 1 like other compilers
+        size_t equalPos = define.find('=');
+        std::string name = define.substr(0, equalPos);
+        std::string value = (equalPos == std::string::npos) ? "1" : define.substr(equalPos + 1);
+
+        HLSLPPMacro& macro = m_macros[name];
+        bool inBlockComment = false;
+        TokenizeLine(value.data(), value.data() + value.size(), inBlockComment, macro.body);
+    }
+
+    output.clear();
+    output.reserve(length);
+
+    return ProcessFile(fileName, buffer, length, 0, output);
+}
+
+bool HLSLPreprocessor::IsSkippedInclude(const std::string& name) const
+{
+    std::string baseName = std::filesystem::path(name).filename().generic_string();
+    for (const auto& skip : m_options.skipIncludes)
+    {
+        if (skip == name || skip == baseName)
+            return true;
+    }
+    return false;
+}
+
+bool HLSLPreprocessor::FindInclude(const std::string& name, bool isSystem, const std::string& fileName, std::string& path) const
+{
+    using namespace std::filesystem;
+    std::error_code errorCode;
+
+    // quoted includes search the directory of the including file first
+    std::vector<std::filesystem::path> candidates;
+    if (!isSystem)
+        candidates.push_back(std::filesystem::path(fileName).parent_path() / name);
+    for (const auto& includePath : m_options.includePaths)
+        candidates.push_back(std::filesystem::path(includePath) / name);
+
+    for (const auto& candidate : candidates)
+    {
+        if (is_regular_file(candidate, errorCode))
+        {
+            path = canonical(candidate, errorCode).generic_string();
+            return !errorCode;
+        }
+    }
+    return false;
+}
+
+bool HLSLPreprocessor::ProcessFile(const std::string& fileName, const char* buffer, size_t length, uint32_t depth, std::string& output)
+{
+    m_files.push_back(fileName);
+
+    std::shared_ptr<const HLSLPPFile> file = GetParsedFile(buffer, length);
+
+    struct Conditional
+    {
+        bool isParentActive;
+        bool isActive;
+        bool isTaken; // some branch was already active
+        bool hasElse;
+        int lineNumber;
+    };
+    std::vector<Conditional> conditionals;
+
+    bool isActive = true;
+
+    for (const HLSLPPLine& line : file->lines)
+    {
+        // point errors at this line, these get clobbered by includes
+        m_fileName = fileName.c_str();
+        m_lineNumber = line.lineNumber;
+
+        switch (line.type)
+        {
+            case HLSLPPLine_Text:
+            {
+                if (isActive)
+                {
+                    if (!line.hasIdentifiers || m_macros.empty())
+                        output += line.text;
+                    else if (!ExpandLine(line.tokens, output))
+                        return false;
+                }
+                break;
+            }
+
+            case HLSLPPLine_If:
+            case HLSLPPLine_Ifdef:
+            case HLSLPPLine_Ifndef:
+            {
+                bool value = false;
+                if (isActive)
+                {
+                    if (line.type == HLSLPPLine_If)
+                    {
+                        if (!EvaluateCondition(line.tokens, value))
+                            return false;
+                    }
+                    else
+                    {
+                        value = m_macros.find(line.text) != m_macros.end();
+                        if (line.type == HLSLPPLine_Ifndef)
+                            value = !value;
+                    }
+                }
+
+                Conditional conditional = { isActive, value, value, false, line.lineNumber };
+                conditionals.push_back(conditional);
+                isActive = value;
+                break;
+            }
+
+            case HLSLPPLine_Elif:
+            case HLSLPPLine_Else:
+            {
+                if (conditionals.empty() || conditionals.back().hasElse)
+                {
+                    Error("%s without matching #if\n", line.type == HLSLPPLine_Else ? "#else" : "#elif");
+                    return false;
+                }
+
+                Conditional& conditional = conditionals.back();
+                bool value = false;
+                if (conditional.isParentActive && !conditional.isTaken)
+                {
+                    if (line.type == HLSLPPLine_Else)
+                        value = true;
+                    else if (!EvaluateCondition(line.tokens, value))
+                        return false;
+                }
+
+                conditional.isActive = value;
+                conditional.isTaken |= value;
+                conditional.hasElse = line.type == HLSLPPLine_Else;
+                isActive = value;
+                break;
+            }
+
+            case HLSLPPLine_Endif:
+            {
+                if (conditionals.empty())
+                {
+                    Error("#endif without matching #if\n");
+                    return false;
+                }
+                isActive = conditionals.back().isParentActive;
+                conditionals.pop_back();
+                break;
+            }
+
+            case HLSLPPLine_Define:
+            {
+                if (isActive)
+                    m_macros[line.text] = line.macro;
+                break;
+            }
+            case HLSLPPLine_Undef:
+            {
+                if (isActive)
+                    m_macros.erase(line.text);
+                break;
+            }
+            case HLSLPPLine_PragmaOnce:
+            {
+                if (isActive)
+                    m_onceFiles.insert(fileName);
+                break;
+            }
+            case HLSLPPLine_Error:
+            {
+                if (isActive)
+                {
+                    Error("#error %s\n", line.text.c_str());
+                    return false;
+                }
+                break;
+            }
+            case HLSLPPLine_Line:
+            {
+                if (isActive)
+                    output += line.text;
+                break;
+            }
+            case HLSLPPLine_Invalid:
+            {
+                if (isActive)
+                {
+                    Error("%s\n", line.text.c_str());
+                    return false;
+                }
+                break;
+            }
+            case HLSLPPLine_Blank:
+                break;
+
+            case HLSLPPLine_Include:
+            {
+                if (!isActive || IsSkippedInclude(line.text))
+                    break;
+
+                std::string includeFileName;
+                if (!FindInclude(line.text, line.isSystemInclude, fileName, includeFileName))
+                {
+                    Error("Include file %s not found\n", line.text.c_str());
+                    return false;
+                }
+
+                if (m_onceFiles.find(includeFileName) != m_onceFiles.end())
+                    break;
+
+                if (depth + 1 >= kMaxIncludeDepth)
+                {
+                    Error("Include depth exceeded including %s\n", line.text.c_str());
+                    return false;
+                }
+
+                std::string includeText;
+                if (!ReadFileText(includeFileName.c_str(), includeText))
+                {
+                    Error("Include file %s could not be read\n", includeFileName.c_str());
+                    return false;
+                }
+
+                // splice in the include, and then restore the line numbering
+                String_Printf(output, "#line 1 \"%s\"\n", includeFileName.c_str());
+                if (!ProcessFile(includeFileName, includeText.data(), includeText.size(), depth + 1, output))
+                    return false;
+                String_Printf(output, "#line %d \"%s\"", line.lineNumber + line.numLines, fileName.c_str());
+
+                // the newline below moves onto the restored line
+                output += '\n';
+                continue;
+            }
+        }
+
+        // keep line numbers aligned with the source
+        output.append(line.numLines, '\n');
+    }
+
+    if (!conditionals.empty())
+    {
+        m_fileName = fileName.c_str();
+        m_lineNumber = conditionals.back().lineNumber;
+        Error("Unterminated #if\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool HLSLPreprocessor::ExpandLine(const std::vector<HLSLPPToken>& tokens, std::string& output)
+{
+    // most lines don't reference any macros
+    bool hasMacros = false;
+    for (const auto& token : tokens)
+    {
+        if (token.type == HLSLPPToken_Identifier && m_macros.find(token.text) != m_macros.end())
+        {
+            hasMacros = true;
+            break;
+        }
+    }
+
+    if (!hasMacros)
+    {
+        for (const auto& token : tokens)
+            output += token.text;
+        return true;
+    }
+
+    std::vector<HLSLPPToken> result;
+    if (!Expand(tokens, result))
+        return false;
+
+    for (const auto& token : result)
+        output += token.text;
+    return true;
+}
+
+// Collects the arguments of a function-like macro call starting at the (.
+// Arguments must be on the same logical line as the macro name.
+static bool CollectMacroArgs(const std::vector<HLSLPPToken>& tokens, uint32_t& pos, std::vector<std::vector<HLSLPPToken>>& args)
+{
+    uint32_t i = pos;
+    while (i < tokens.size() && (tokens[i].type == HLSLPPToken_Whitespace || tokens[i].type == HLSLPPToken_Comment))
+        i++;
+
+    if (i >= tokens.size() || tokens[i].text != "(")
+        return false;
+    i++;
+
+    args.clear();
+    args.emplace_back();
+
+    int parenDepth = 1;
+    for (; i < tokens.size(); ++i)
+    {
+        const HLSLPPToken& token = tokens[i];
+        if (token.text == "(")
+        {
+            parenDepth++;
+        }
+        else if (token.text == ")")
+        {
+            if (--parenDepth == 0)
+            {
+                pos = i + 1;
+                for (auto& arg : args)
+                    TrimTokens(arg);
+                return true;
+            }
+        }
+        else if (token.text == "," && parenDepth == 1)
+        {
+            args.emplace_back();
+            continue;
+        }
+        args.back().push_back(token);
+    }
+
+    return false;
+}
+
+bool HLSLPreprocessor::Expand(const std::vector<HLSLPPToken>& tokens, std::vector<HLSLPPToken>& result)
+{
+    for (uint32_t i = 0; i < tokens.size(); ++i)
+    {
+        const HLSLPPToken& token = tokens[i];
+
+        auto it = token.type == HLSLPPToken_Identifier ? m_macros.find(token.text) : m_macros.end();
+
+        // a macro isn't replaced inside its own expansion
+        if (it == m_macros.end() ||
+            std::find(m_expanding.begin(), m_expanding.end(), token.text) != m_expanding.end())
+        {
+            result.push_back(token);
+            continue;
+        }
+
+        // macros can't be redefined during expansion, so this stays valid
+        const HLSLPPMacro& macro = it->second;
+        std::string name = token.text;
+
+        if (!macro.isFunctionLike)
+        {
+            m_expanding.push_back(name);
+            bool success = Expand(macro.body, result);
+            m_expanding.pop_back();
+            if (!success)
+                return false;
+            continue;
+        }
+
+        std::vector<std::vector<HLSLPPToken>> args;
+        uint32_t pos = i + 1;
+        if (!CollectMacroArgs(tokens, pos, args))
+        {
+            // name without a call, so leave it alone
+            result.push_back(token);
+            continue;
+        }
+
+        // F() passes one empty arg
+        if (macro.params.empty() && args.size() == 1 && args[0].empty())
+            args.clear();
+
+        if (args.size() != macro.params.size())
+        {
+            Error("Macro %s expects %d arguments, but %d given\n", name.c_str(), (int)macro.params.size(), (int)args.size());
+            return false;
+        }
+
+        // args are fully expanded before substitution
+        std::vector<std::vector<HLSLPPToken>> expandedArgs(args.size());
+        for (uint32_t a = 0; a < args.size(); ++a)
+        {
+            if (!Expand(args[a], expandedArgs[a]))
+                return false;
+        }
+
+        std::vector<HLSLPPToken> substituted;
+        for (const auto& bodyToken : macro.body)
+        {
+            uint32_t paramIndex = 0;
+            if (bodyToken.type == HLSLPPToken_Identifier)
+            {
+                for (; paramIndex < macro.params.size(); ++paramIndex)
+                {
+                    if (macro.params[paramIndex] == bodyToken.text)
+                        break;
+                }
+            }
+
+            if (bodyToken.type == HLSLPPToken_Identifier && paramIndex < macro.params.size())
+                substituted.insert(substituted.end(), expandedArgs[paramIndex].begin(), expandedArgs[paramIndex].end());
+            else
+                substituted.push_back(bodyToken);
+        }
+
+        m_expanding.push_back(name);
+        bool success = Expand(substituted, result);
+        m_expanding.pop_back();
+        if (!success)
+            return false;
+
+        i = pos - 1;
+    }
+
+    return true;
+}
+
+//-----------------------------------------
+// #if expression evaluation with C integer semantics
+
+class HLSLPPExpression
+{
+public:
+    HLSLPPExpression(const std::vector<const HLSLPPToken*>& tokens) : m_tokens(tokens) {}
+
+    bool Evaluate(int64_t& value)
+    {
+        value = ParseConditional();
+        if (m_pos != m_tokens.size() && !m_error)
+            SetError("Unexpected token in #if expression");
+        return !m_error;
+    }
+
+    const char* GetError() const { return m_errorText; }
+
+private:
+
+    bool Accept(const char* text)
+    {
+        if (m_pos < m_tokens.size() && m_tokens[m_pos]->text == text)
+        {
+            m_pos++;
+            return true;
+        }
+        return false;
+    }
+
+    void SetError(const char* text)
+    {
+        if (!m_error)
+        {
+            m_error = true;
+            m_errorText = text;
+        }
+    }
+
+    static int GetPrecedence(const std::string& op)
+    {
+        if (op == "||") return 1;
+        if (op == "&&") return 2;
+        if (op == "|") return 3;
+        if (op == "^") return 4;
+        if (op == "&") return 5;
+        if (op == "==" || op == "!=") return 6;
+        if (op == "<" || op == ">" || op == "<=" || op == ">=") return 7;
+        if (op == "<<" || op == ">>") return 8;
+        if (op == "+" || op == "-") return 9;
+        if (op == "*" || op == "/" || op == "%") return 10;
+        return 0;
+    }
+
+    int64_t ParseConditional()
+    {
+        int64_t condition = ParseBinary(1);
+        if (Accept("?"))
+        {
+            int64_t a = ParseConditional();
+            if (!Accept(":"))
+            {
+                SetError("Expected : in #if expression");
+                return 0;
+            }
+            int64_t b = ParseConditional();
+            return condition ? a : b;
+        }
+        return condition;
+    }
+
+    int64_t ParseBinary(int minPrecedence)
+    {
+        int64_t lhs = ParseUnary();
+        while (!m_error && m_pos < m_tokens.size())
+        {
+            const HLSLPPToken& op = *m_tokens[m_pos];
+            int precedence = op.type == HLSLPPToken_Symbol ? GetPrecedence(op.text) : 0;
+            if (precedence == 0 || precedence < minPrecedence)
+                break;
+            m_pos++;
+
+            int64_t rhs = ParseBinary(precedence + 1);
+            const std::string& o = op.text;
+
+            if      (o == "||") lhs = lhs || rhs;
+            else if (o == "&&") lhs = lhs && rhs;
+            else if (o == "|")  lhs = lhs | rhs;
+            else if (o == "^")  lhs = lhs ^ rhs;
+            else if (o == "&")  lhs = lhs & rhs;
+            else if (o == "==") lhs = lhs == rhs;
+            else if (o == "!=") lhs = lhs != rhs;
+            else if (o == "<")  lhs = lhs < rhs;
+            else if (o == ">")  lhs = lhs > rhs;
+            else if (o == "<=") lhs = lhs <= rhs;
+            else if (o == ">=") lhs = lhs >= rhs;
+            else if (o == "<<") lhs = lhs << rhs;
+            else if (o == ">>") lhs = lhs >> rhs;
+            else if (o == "+")  lhs = lhs + rhs;
+            else if (o == "-")  lhs = lhs - rhs;
+            else if (o == "*")  lhs = lhs * rhs;
+            else if (rhs == 0)
+            {
+                SetError("Division by zero in #if expression");
+                return 0;
+            }
+            else if (o == "/")  lhs = lhs / rhs;
+            else if (o == "%")  lhs = lhs % rhs;
+        }
+        return lhs;
+    }
+
+    int64_t ParseUnary()
+    {
+        if (Accept("!")) return !ParseUnary();
+        if (Accept("-")) return -ParseUnary();
+        if (Accept("+")) return ParseUnary();
+        if (Accept("~")) return ~ParseUnary();
+
+        if (Accept("("))
+        {
+            int64_t value = ParseConditional();
+            if (!Accept(")"))
+                SetError("Expected ) in #if expression");
+            return value;
+        }
+
+        if (m_pos >= m_tokens.size())
+        {
+            SetError("Unexpected end of #if expression");
+            return 0;
+        }
+
+        const HLSLPPToken& token = *m_tokens[m_pos++];
+        if (token.type == HLSLPPToken_Number)
+        {
+            char* end = nullptr;
+            int64_t value = (int64_t)strtoull(token.text.c_str(), &end, 0);
+
+            // ignore integer suffixes
+            while (*end == 'u' || *end == 'U' || *end == 'l' || *end == 'L')
+                ++end;
+            if (*end != 0)
+                SetError("Invalid integer in #if expression");
+            return value;
+        }
+
+        // undefined identifiers are 0
+        if (token.type == HLSLPPToken_Identifier)
+            return 0;
+
+        SetError("Unexpected token in #if expression");
+        return 0;
+    }
+
+private:
+    const std::vector<const HLSLPPToken*>& m_tokens;
+    size_t m_pos = 0;
+    bool m_error = false;
+    const char* m_errorText = nullptr;
+};
+
+bool HLSLPreprocessor::EvaluateCondition(const std::vector<HLSLPPToken>& tokens, bool& value)
+{
+    // replace defined(X) and defined X before macros are expanded
+    std::vector<HLSLPPToken> replaced;
+    for (uint32_t i = 0; i < tokens.size(); ++i)
+    {
+        if (tokens[i].type != HLSLPPToken_Identifier || tokens[i].text != "defined")
+        {
+            replaced.push_back(tokens[i]);
+            continue;
+        }
+
+        uint32_t pos = i + 1;
+        auto skipWhitespace = [&]() {
+            while (pos < tokens.size() && tokens[pos].type == HLSLPPToken_Whitespace)
+                pos++;
+        };
+
+        skipWhitespace();
+        bool hasParen = pos < tokens.size() && tokens[pos].text == "(";
+        if (hasParen)
+        {
+            pos++;
+            skipWhitespace();
+        }
+
+        if (pos >= tokens.size() || tokens[pos].type != HLSLPPToken_Identifier)
+        {
+            Error("Expected macro name after defined\n");
+            return false;
+        }
+
+        HLSLPPToken result;
+        result.type = HLSLPPToken_Number;
+        result.text = m_macros.find(tokens[pos].text) != m_macros.end() ? "1" : "0";
+        replaced.push_back(result);
+        pos++;
+
+        if (hasParen)
+        {
+            skipWhitespace();
+            if (pos >= tokens.size() || tokens[pos].text != ")")
+            {
+                Error("Expected ) after defined\n");
+                return false;
+            }
+            pos++;
+        }
+
+        i = pos - 1;
+    }
+
+    std::vector<HLSLPPToken> expanded;
+    if (!Expand(replaced, expanded))
+        return false;
+
+    std::vector<const HLSLPPToken*> expressionTokens;
+    for (const auto& token : expanded)
+    {
+        if (token.type != HLSLPPToken_Whitespace && token.type != HLSLPPToken_Comment)
+            expressionTokens.push_back(&token);
+    }
+
+    HLSLPPExpression expression(expressionTokens);
+    int64_t result = 0;
+    if (!expression.Evaluate(result))
+    {
+        Error("%s\n", expression.GetError());
+        return false;
+    }
+
+    value = result != 0;
+    return true;
+}
+
+}
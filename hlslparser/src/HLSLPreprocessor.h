@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Engine.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace M4
+{
+
+enum HLSLPPTokenType
+{
+    HLSLPPToken_Identifier,
+    HLSLPPToken_Number,
+    HLSLPPToken_String,
+    HLSLPPToken_Whitespace,
+    HLSLPPToken_Comment,
+    HLSLPPToken_Symbol,
+};
+
+struct HLSLPPToken
+{
+    HLSLPPTokenType type = HLSLPPToken_Symbol;
+    std::string text;
+};
+
+struct HLSLPPMacro
+{
+    bool isFunctionLike = false;
+    std::vector<std::string> params;
+    std::vector<HLSLPPToken> body;
+};
+
+struct HLSLPreprocessorOptions
+{
+    /// Searched after the directory of the including file.
+    std::vector<std::string> includePaths;
+
+    /// NAME or NAME=value, same as -D on the command line of a compiler.
+    std::vector<std::string> defines;
+
+    /// Includes that are left unexpanded.  The generators write out
+    /// their own #include of these, and they are only for dxc/metal.
+    std::vector<std::string> skipIncludes = { "ShaderHLSL.h", "ShaderMSL.h" };
+};
+
+/** Expands #include, #define, #undef, #if/#ifdef/#ifndef/#elif/#else/#endif
+and #pragma once ahead of the tokenizer.  Includes are spliced in with #line
+directives, so the tokenizer still reports errors against the original file
+and line.  Each file is split into directives and tokenized lines once, and
+that is cached by content hash across all preprocessor instances in the
+process.  So the common headers included by many shader permutations are only
+scanned once.  Stringizing (#) and token pasting (##) are not supported. */
+class HLSLPreprocessor
+{
+public:
+
+    HLSLPreprocessor(const HLSLPreprocessorOptions& options = HLSLPreprocessorOptions());
+    ~HLSLPreprocessor();
+
+    /// Writes the expanded source to output.  fileName should be the same
+    /// name passed to HLSLParser, and is used to resolve relative includes.
+    bool Preprocess(const char* fileName, const char* buffer, size_t length, std::string& output);
+
+    /// All files that were read, starting with fileName.
+    const std::vector<std::string>& GetFiles() const { return m_files; }
+
+    /// Process-wide stats on the parsed file cache.
+    static void GetCacheStats(uint32_t& numHits, uint32_t& numMisses);
+    static void ClearCache();
+
+private:
+
+    bool ProcessFile(const std::string& fileName, const char* buffer, size_t length, uint32_t depth, std::string& output);
+    bool FindInclude(const std::string& name, bool isSystem, const std::string& fileName, std::string& path) const;
+    bool IsSkippedInclude(const std::string& name) const;
+
+    bool ExpandLine(const std::vector<HLSLPPToken>& tokens, std::string& output);
+    bool Expand(const std::vector<HLSLPPToken>& tokens, std::vector<HLSLPPToken>& result);
+    bool EvaluateCondition(const std::vector<HLSLPPToken>& tokens, bool& value);
+
+    void Error(const char* format, ...) M4_PRINTF_ATTR(2, 3);
+
+private:
+
+    HLSLPreprocessorOptions m_options;
+
+    std::unordered_map<std::string, HLSLPPMacro> m_macros;
+    std::unordered_set<std::string> m_onceFiles;
+    std::vector<std::string> m_expanding;
+    std::vector<std::string> m_files;
+
+    // for error reporting
+    const char* m_fileName = nullptr;
+    int m_lineNumber = 0;
+};
+
+}
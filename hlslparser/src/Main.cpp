@@ -1,4 +1,5 @@
 #include "HLSLParser.h"
+#include "HLSLPreprocessor.h"
 
 //#include "GLSLGenerator.h"
 #include "HLSLGenerator.h"
@@ -7,9 +8,14 @@
 #include <stdio.h>
 #include <sys/stat.h>
 
+#include <algorithm>
+#include <atomic>
 #include <filesystem>
+#include <thread>
+#include <vector>
 
 using namespace std;
+using namespace M4;
 
 enum Language
 {
@@ -39,14 +45,23 @@ void PrintUsage()
 {
 	fprintf(stderr,
         "usage: hlslparser [-h|-g] -i shader.hlsl -o [shader.hlsl | shader.metal]\n"
+        "       hlslparser [-h|-g] -batch manifest.txt [-j N]\n"
 		 "Translate DX9-style HLSL shader to HLSL/MSL shader.\n"
          " -i          input HLSL\n"
          " -o          output HLSL or MSL\n"
+         " -batch      manifest of jobs, one per line:\n"
+         "             input.hlsl output.[hlsl|metal] [-D name[=value]] [-I dir]\n"
 		 "optional arguments:\n"
          " -g          debug mode, preserve comments\n"
          " -h, --help  show this help message and exit\n"
          " -line       write #file/line directive\n"
-         " -nohalf     turn half into float"
+         " -nohalf     turn half into float\n"
+         " -D name[=value]  define a preprocessor macro\n"
+         " -I dir      add an include search directory\n"
+         " -j N        number of threads, defaults to all cores\n"
+         " -deps       write output.d with the includes and hashes of each output\n"
+         " -cache dir  skip outputs whose deps didn't change, and reuse\n"
+         "             outputs of the same source and options from dir, implies -deps"
 		);
 }
 
@@ -83,117 +98,70 @@ static string filenameNoExtension(const char* filename)
     return filenameNoExt.substr(0, dotPos);
 }
 
-int main( int argc, char* argv[] )
+struct GenerateOptions
 {
-	using namespace M4;
-
-	// Parse arguments
-	string fileName;
-	const char* entryName = NULL;
-
-	// TODO: could we take modern DX12 HLSL and translate to MSL only
-	// That would simplify all this.  What spirv-cross already does though.
-	// Could drop HLSLGenerator then, and just use this to gen MSL.
-	// Much of the glue code can just be in a header, but having it
-	// in parser, lets this only splice code that is needed.
-
-	Language language = Language_MSL;
-	HLSLTarget target = HLSLTarget_PixelShader;
-    string outputFileName;
     bool isDebug = false;
     bool isTreatHalfAsFloat = false;
     bool isWriteFileLine = false;
-    
-	for( int argn = 1; argn < argc; ++argn )
-	{
-		const char* const arg = argv[ argn ];
+    bool isWriteDeps = false;
+    string cacheDir; // content addressed store of outputs
+};
 
-		if( String_Equal( arg, "-h" ) || String_Equal( arg, "--help" ) )
-		{
-			PrintUsage();
-			return 0;
-		}
-		
-        else if( String_Equal( arg, "-o" ) || String_Equal( arg, "-output" ) )
-        {
-            if ( ++argn < argc )
-                outputFileName = argv[ argn ];
-        }
-        else if( String_Equal( arg, "-i" ) || String_Equal( arg, "-input" ) )
-		{
-            if ( ++argn < argc )
-                fileName = argv[ argn ];
-		}
-        else if ( String_Equal( arg, "-g" ))
-        {
-            // will preserve double-slash comments where possible
-            isDebug = true;
-        }
-        else if ( String_Equal( arg, "-nohalf" ))
-        {
-            // will preserve double-slash comments where possible
-            isTreatHalfAsFloat = true;
-        }
-        else if ( String_Equal( arg, "-line" ))
-        {
-            // will preserve double-slash comments where possible
-            isWriteFileLine = true;
-        }
-        
-// This is derived from end characters of entry point
-//        else if( String_Equal( arg, "-vs" ) )
-//        {
-//            target = HLSLTarget_VertexShader;
-//        }
-//        else if( String_Equal( arg, "-fs" ) )
-//        {
-//            target = HLSLTarget_PixelShader;
-//        }
- // TODO: require a arg to set entryName
-//		else if( entryName == NULL )
-//		{
-//			entryName = arg;
-//		}
-		else
-		{
-			Log_Error( "Too many arguments\n" );
-			PrintUsage();
-			return 1;
-		}
-	}
+// One input file translated to one output file.  All entry points
+// found in the file are written to the output in source order.
+struct ShaderJob
+{
+    string fileName;
+    string outputFileName;
+    Language language = Language_MSL;
+    HLSLPreprocessorOptions preprocessorOptions;
+    
+    string source; // preprocessed
+    vector<string> entryPoints;
+    vector<string> entryOutputs;
+    vector<vector<uint8_t>> entryWritten; // see GenerateEntryPoint
+    bool isFailed = false;
+    
+    // for incremental builds
+    vector<string> files; // source and includes
+    vector<uint64_t> fileHashes;
+    uint64_t optionsHash = 0;
+    uint64_t cacheKey = 0;
+    bool isCached = false;   // output was read from the cache
+    bool isUpToDate = false; // output and deps file didn't need to change
+};
 
+// Validates the filenames, and derives the language from the output extension.
+static bool SetupJob( ShaderJob& job, string fileName, string outputFileName )
+{
 	if( fileName.empty() )
 	{
 		Log_Error( "Missing source filename\n" );
-		PrintUsage();
-		return 1;
+		return false;
 	}
     if( !endsWith( fileName, "hlsl" ) )
     {
         Log_Error( "Input filename must end with .hlsl\n" );
-        PrintUsage();
-        return 1;
+        return false;
     }
     
     if( outputFileName.empty() )
     {
         Log_Error( "Missing dest filename\n" );
-        PrintUsage();
-        return 1;
+        return false;
     }
     if( endsWith( outputFileName, "hlsl" ) )
     {
-        language = Language_HLSL;
+        job.language = Language_HLSL;
     }
     else if( endsWith( outputFileName, "metal" ) )
     {
-        language = Language_MSL;
+        job.language = Language_MSL;
     }
     else
     {
         Log_Error( "Output file must end with .hlsl or msls\n" );
-        PrintUsage();
-        return 1;
+        return false;
     }
     
     // replace the extension on the output file
@@ -203,11 +171,11 @@ int main( int argc, char* argv[] )
     // Code now finds entry points.
     // outputFileName += (target == HLSLTarget_PixelShader) ? "PS" : "VS";
     
-    if ( language == Language_MSL )
+    if ( job.language == Language_MSL )
     {
         outputFileName += ".metal";
     }
-    else if ( language == Language_HLSL )
+    else if ( job.language == Language_HLSL )
     {
         outputFileName += ".hlsl";
     }
@@ -228,29 +196,319 @@ int main( int argc, char* argv[] )
         if ( outputFileName == fileName )
         {
             Log_Error( "Src and Dst filenames match.  Exiting.\n" );
-            return 1;
+            return false;
         }
     }
     
-    //------------------------------------
-    // Now start the work
+    job.fileName = fileName;
+    job.outputFileName = outputFileName;
+    return true;
+}
+
+// Each line is "input.hlsl output.metal|hlsl [-D name[=value]] [-I dir]".
+// Paths are relative to the manifest, and # starts a comment line.
+static bool ReadManifest( const char* manifestName, const HLSLPreprocessorOptions& preprocessorOptions, vector<ShaderJob>& jobs )
+{
+    string text;
+    if ( !ReadFile( manifestName, text ) )
+    {
+        Log_Error( "Manifest file %s not found\n", manifestName );
+        return false;
+    }
     
-	// Read input file
-    string source;
-    if (!ReadFile( fileName.c_str(), source ))
+    filesystem::path manifestDir = filesystem::path( manifestName ).parent_path();
+    auto resolvePath = [&]( const string& name ) {
+        filesystem::path path( name );
+        return path.is_absolute() ? name : ( manifestDir / path ).generic_string();
+    };
+    
+    size_t lineStart = 0;
+    uint32_t lineNumber = 0;
+    while ( lineStart < text.size() )
     {
-        Log_Error( "Input file not found\n" );
-        return 1;
+        size_t lineEnd = text.find( '\n', lineStart );
+        if ( lineEnd == string::npos )
+            lineEnd = text.size();
+        string line = text.substr( lineStart, lineEnd - lineStart );
+        lineStart = lineEnd + 1;
+        lineNumber++;
+        
+        vector<string> words;
+        const char* wordSeparators = " \t\r";
+        size_t wordStart = line.find_first_not_of( wordSeparators );
+        while ( wordStart != string::npos )
+        {
+            size_t wordEnd = line.find_first_of( wordSeparators, wordStart );
+            words.push_back( line.substr( wordStart, wordEnd - wordStart ) );
+            wordStart = line.find_first_not_of( wordSeparators, wordEnd );
+        }
+        
+        if ( words.empty() || words[0][0] == '#' )
+            continue;
+        
+        if ( words.size() < 2 )
+        {
+            Log_Error( "%s:%d: expected input and output filename\n", manifestName, lineNumber );
+            return false;
+        }
+        
+        ShaderJob job;
+        job.preprocessorOptions = preprocessorOptions;
+        
+        for ( uint32_t i = 2; i < words.size(); ++i )
+        {
+            if ( ( words[i] == "-D" || words[i] == "-I" ) && i + 1 < words.size() )
+            {
+                if ( words[i] == "-D" )
+                    job.preprocessorOptions.defines.push_back( words[i+1] );
+                else
+                    job.preprocessorOptions.includePaths.push_back( resolvePath( words[i+1] ) );
+                ++i;
+            }
+            else
+            {
+                Log_Error( "%s:%d: unknown argument %s\n", manifestName, lineNumber, words[i].c_str() );
+                return false;
+            }
+        }
+        
+        if ( !SetupJob( job, resolvePath( words[0] ), resolvePath( words[1] ) ) )
+            return false;
+        
+        jobs.push_back( std::move( job ) );
     }
+    
+    return true;
+}
+
+//------------------------------------
+// Incremental builds
+//
+// Each output gets an output.d file next to it.  This is a make style depfile
+// of the source and its includes, with the hashes of those files, the options
+// and the output in comments ahead of it.  When those all still match, the
+// job is skipped without preprocessing or parsing.
+//
+// Otherwise the preprocessed source and options are hashed into a key, and
+// the cache dir holds outputs by key.  So reverting an edit, or permutations
+// that preprocess to the same source, reuse the output without a parse.
+
+static const char* kDepsHeader = "# hlslparser deps 1";
+
+// Part of every cache key.  Bump this whenever a change to the parser or
+// the generators changes the generated shaders, so cached output isn't reused.
+// Identical builds share the same keys, so the cache can be shared.
+static const uint32_t kGeneratorVersion = 1;
+
+static string HashToString( uint64_t hash )
+{
+    char text[32];
+    snprintf( text, sizeof(text), "%016llx", (unsigned long long)hash );
+    return text;
+}
+
+static bool HashFile( const string& fileName, uint64_t& hash )
+{
+    string text;
+    if ( !ReadFile( fileName.c_str(), text ) )
+        return false;
+    
+    hash = HashFnv1a64( text.data(), text.size() );
+    return true;
+}
+
+// Everything besides the preprocessed source that changes the output.
+static uint64_t HashOptions( const ShaderJob& job, const GenerateOptions& options )
+{
+    string text;
+    
+    // a different version of hlslparser may generate different output
+    text += "version " + to_string( kGeneratorVersion ) + "\n";
+    
+    // -line writes out the source path
+    text += job.fileName;
+    text += '\n';
+    
+    text += job.language == Language_MSL ? "msl" : "hlsl";
+    text += options.isDebug ? " -g" : "";
+    text += options.isTreatHalfAsFloat ? " -nohalf" : "";
+    text += options.isWriteFileLine ? " -line" : "";
+    text += '\n';
+    
+    const HLSLPreprocessorOptions& preprocessorOptions = job.preprocessorOptions;
+    for ( const string& define : preprocessorOptions.defines )
+        text += "-D " + define + "\n";
+    for ( const string& includePath : preprocessorOptions.includePaths )
+        text += "-I " + includePath + "\n";
+    for ( const string& skipInclude : preprocessorOptions.skipIncludes )
+        text += "skip " + skipInclude + "\n";
+    
+    return HashFnv1a64( text.data(), text.size() );
+}
+
+static string GetDepsFileName( const ShaderJob& job )
+{
+    return job.outputFileName + ".d";
+}
+
+static string GetCacheFileName( const ShaderJob& job, const GenerateOptions& options )
+{
+    string name = HashToString( job.cacheKey );
+    name += job.language == Language_MSL ? ".metal" : ".hlsl";
+    return ( filesystem::path( options.cacheDir ) / name ).string();
+}
 
-	// Parse input file
-	Allocator allocator;
-	HLSLParser parser( &allocator, fileName.c_str(), source.data(), source.size() );
-    if (isDebug)
+// Compares the hashes in the deps file against the current files.
+static bool IsJobUpToDate( const ShaderJob& job )
+{
+    string text;
+    if ( !ReadFile( GetDepsFileName( job ).c_str(), text ) )
+        return false;
+    
+    bool isHeaderValid = false;
+    bool isOptionsValid = false;
+    bool isOutputValid = false;
+    bool isSourceValid = false;
+    
+    size_t lineStart = 0;
+    while ( lineStart < text.size() )
+    {
+        size_t lineEnd = text.find( '\n', lineStart );
+        if ( lineEnd == string::npos )
+            lineEnd = text.size();
+        
+        string line = text.substr( lineStart, lineEnd - lineStart );
+        lineStart = lineEnd + 1;
+        
+        if ( line == kDepsHeader )
+        {
+            isHeaderValid = true;
+            continue;
+        }
+        
+        // "# key hash [path]", the make rule follows the comments
+        if ( line.size() < 2 || line[0] != '#' )
+            break;
+        
+        char key[16] = {};
+        char hashText[32] = {};
+        int pathOffset = 0;
+        if ( sscanf( line.c_str(), "# %15s %31s %n", key, hashText, &pathOffset ) < 2 )
+            return false;
+        
+        uint64_t hash = strtoull( hashText, nullptr, 16 );
+        
+        if ( String_Equal( key, "options" ) )
+        {
+            if ( hash != job.optionsHash )
+                return false;
+            isOptionsValid = true;
+        }
+        else if ( String_Equal( key, "output" ) )
+        {
+            uint64_t outputHash = 0;
+            if ( !HashFile( job.outputFileName, outputHash ) || outputHash != hash )
+                return false;
+            isOutputValid = true;
+        }
+        else if ( String_Equal( key, "source" ) || String_Equal( key, "include" ) )
+        {
+            uint64_t fileHash = 0;
+            if ( pathOffset == 0 || !HashFile( line.substr( pathOffset ), fileHash ) || fileHash != hash )
+                return false;
+            if ( String_Equal( key, "source" ) )
+                isSourceValid = true;
+        }
+    }
+    
+    return isHeaderValid && isOptionsValid && isOutputValid && isSourceValid;
+}
+
+// Make needs spaces escaped in paths.
+static string EscapeDepsPath( const string& path )
+{
+    string text;
+    for ( char c : path )
+    {
+        if ( c == ' ' || c == '#' )
+            text += '\\';
+        text += c;
+    }
+    return text;
+}
+
+static bool WriteDepsFile( const ShaderJob& job, uint64_t outputHash )
+{
+    string text = kDepsHeader;
+    text += '\n';
+    text += "# options " + HashToString( job.optionsHash ) + "\n";
+    text += "# output " + HashToString( outputHash ) + "\n";
+    for ( uint32_t i = 0; i < job.files.size(); ++i )
+    {
+        text += i == 0 ? "# source " : "# include ";
+        text += HashToString( job.fileHashes[i] ) + " " + job.files[i] + "\n";
+    }
+    
+    text += EscapeDepsPath( job.outputFileName ) + ":";
+    for ( const string& file : job.files )
+    {
+        text += " \\\n  " + EscapeDepsPath( file );
+    }
+    text += '\n';
+    
+    string depsFileName = GetDepsFileName( job );
+    FILE* fp = fopen( depsFileName.c_str(), "wb" );
+    if ( !fp )
+    {
+        Log_Error( "Could not open deps file %s\n", depsFileName.c_str() );
+        return false;
+    }
+    fwrite( text.data(), 1, text.size(), fp );
+    fclose( fp );
+    return true;
+}
+
+// Other processes may share the cache, so write a temp file and rename it.
+static void StoreCachedOutput( const ShaderJob& job, const GenerateOptions& options )
+{
+    string cacheFileName = GetCacheFileName( job, options );
+    string tmpFileName = cacheFileName + ".tmp";
+    
+    FILE* fp = fopen( tmpFileName.c_str(), "wb" );
+    if ( !fp )
+        return;
+    
+    for ( const string& output : job.entryOutputs )
+    {
+        fwrite( output.data(), 1, output.size(), fp );
+    }
+    fclose( fp );
+    
+    std::error_code errorCode;
+    filesystem::rename( tmpFileName, cacheFileName, errorCode );
+    if ( errorCode )
+        filesystem::remove( tmpFileName, errorCode );
+}
+
+//------------------------------------
+
+// Trees are parsed and dropped once per job and entry point, so each thread
+// keeps one arena and rewinds it instead of returning memory to malloc.
+// Only one tree per thread can use this at a time.
+static Allocator& GetThreadAllocator()
+{
+    static thread_local Allocator allocator;
+    allocator.Reset();
+    return allocator;
+}
+
+static bool ParseSource( const ShaderJob& job, const GenerateOptions& options, Allocator& allocator, HLSLTree& tree )
+{
+	HLSLParser parser( &allocator, job.fileName.c_str(), job.source.data(), job.source.size() );
+    if (options.isDebug)
     {
         parser.SetKeepComments(true);
     }
-	HLSLTree tree( &allocator );
     
     // TODO: tie this to CLI, MSL should set both to true
     HLSLParserOptions parserOptions;
@@ -260,116 +518,522 @@ int main( int argc, char* argv[] )
 	if( !parser.Parse( &tree, parserOptions ) )
 	{
 		Log_Error( "Parsing failed\n" );
-		return 1;
+		return false;
 	}
+    return true;
+}
+
+// Reads and preprocesses the source, and finds the entry points.
+static bool PrepareJob( ShaderJob& job, const GenerateOptions& options )
+{
+    job.optionsHash = HashOptions( job, options );
     
-    int status = 0;
+    if ( options.isWriteDeps && IsJobUpToDate( job ) )
+    {
+        job.isUpToDate = true;
+        return true;
+    }
     
-    // build a list of entryPoints
-    Array<const char*> entryPoints(&allocator);
-    if (entryName != nullptr)
+	// Read input file
+    string source;
+    if (!ReadFile( job.fileName.c_str(), source ))
     {
-        entryPoints.PushBack(entryName);
+        Log_Error( "Input file %s not found\n", job.fileName.c_str() );
+        return false;
     }
-    else
+
+    // Expand includes, macros and conditionals
+    HLSLPreprocessor preprocessor( job.preprocessorOptions );
+    if ( !preprocessor.Preprocess( job.fileName.c_str(), source.data(), source.size(), job.source ) )
     {
-        // search all functions with designated endings
-        HLSLStatement* statement = tree.GetRoot()->statement;
-        while (statement != NULL)
+        Log_Error( "Preprocessing failed\n" );
+        return false;
+    }
+    
+    if ( options.isWriteDeps )
+    {
+        // #pragma once files are listed again for each include
+        for ( const string& file : preprocessor.GetFiles() )
         {
-            if (statement->nodeType == HLSLNodeType_Function)
+            if ( std::find( job.files.begin(), job.files.end(), file ) == job.files.end() )
+                job.files.push_back( file );
+        }
+        
+        job.fileHashes.resize( job.files.size() );
+        for ( uint32_t i = 0; i < job.files.size(); ++i )
+        {
+            if ( !HashFile( job.files[i], job.fileHashes[i] ) )
             {
-                HLSLFunction* function = (HLSLFunction*)statement;
-                const char* name = function->name;
-                
-                if (endsWith(name, "VS"))
-                {
-                    entryPoints.PushBack(name);
-                }
-                else if (endsWith(name, "PS"))
-                {
-                    entryPoints.PushBack(name);
-                }
-                else if (endsWith(name, "CS"))
-                {
-                    entryPoints.PushBack(name);
-                }
+                Log_Error( "Could not read %s\n", job.files[i].c_str() );
+                return false;
             }
-
-            statement = statement->nextStatement;
         }
     }
     
-    string output;
+    if ( !options.cacheDir.empty() )
+    {
+        job.cacheKey = HashFnv1a64( job.source.data(), job.source.size(), job.optionsHash );
+        
+        string output;
+        if ( ReadFile( GetCacheFileName( job, options ).c_str(), output ) )
+        {
+            job.entryOutputs.push_back( std::move( output ) );
+            job.isCached = true;
+            return true;
+        }
+    }
+    
+	Allocator& allocator = GetThreadAllocator();
+	HLSLTree tree( &allocator );
+    if ( !ParseSource( job, options, allocator, tree ) )
+        return false;
     
-    for (uint32_t i = 0; i < (uint32_t)entryPoints.GetSize(); ++i)
+    // search all functions with designated endings
+    HLSLStatement* statement = tree.GetRoot()->statement;
+    while (statement != NULL)
     {
-        const char* entryPoint = entryPoints[i];
-        entryName = entryPoint;
-        if (endsWith(entryPoint, "VS"))
-            target = HLSLTarget_VertexShader;
-        else if (endsWith(entryPoint, "PS"))
-            target = HLSLTarget_PixelShader;
-        else if (endsWith(entryPoint, "CS"))
-            target = HLSLTarget_ComputeShader;
-            
-        // Generate output
-        if (language == Language_HLSL)
+        if (statement->nodeType == HLSLNodeType_Function)
         {
-            HLSLOptions options;
-            options.writeFileLine = isWriteFileLine;
-            options.treatHalfAsFloat = isTreatHalfAsFloat;
-            options.writeVulkan = true; // TODO: tie to CLI
+            HLSLFunction* function = (HLSLFunction*)statement;
+            const char* name = function->name;
             
-            HLSLGenerator generator;
-            if (generator.Generate( &tree, target, entryName, options))
+            if (endsWith(name, "VS") || endsWith(name, "PS") || endsWith(name, "CS"))
             {
-                // write the buffer out
-                output += generator.GetResult();
-            }
-            else
-            {
-                Log_Error( "Translation failed, aborting\n" );
-                status = 1;
+                job.entryPoints.push_back(name);
             }
         }
-        else if (language == Language_MSL)
+
+        statement = statement->nextStatement;
+    }
+    
+    job.entryOutputs.resize( job.entryPoints.size() );
+    return true;
+}
+
+// Lists every statement in visit order.  Parses of the same source give
+// the same order, so flags can be carried between separate trees.
+class GatherStatementsVisitor : public HLSLTreeVisitor
+{
+public:
+    vector<HLSLStatement*> statements;
+    
+    virtual void VisitTopLevelStatement(HLSLStatement * node) override
+    {
+        statements.push_back(node);
+        HLSLTreeVisitor::VisitTopLevelStatement(node);
+    }
+    
+    virtual void VisitStatement(HLSLStatement * node) override
+    {
+        statements.push_back(node);
+        HLSLTreeVisitor::VisitStatement(node);
+    }
+};
+
+// Pruning, sorting and flattening for an entry point all modify the tree.
+// So each entry point parses the preprocessed source into its own tree, and
+// then entry points can generate concurrently without sharing any nodes.
+//
+// Generators also mark statements as written, so that structs, comments and
+// const scalars shared by multiple entry points are only output once per file.
+// writtenBefore carries that over from the earlier entry points, and written
+// returns the flags after this entry point.
+static bool GenerateEntryPoint( const ShaderJob& job, const GenerateOptions& options, const string& entryPoint,
+    const vector<uint8_t>& writtenBefore, string& output, vector<uint8_t>* written )
+{
+	Allocator& allocator = GetThreadAllocator();
+	HLSLTree tree( &allocator );
+    if ( !ParseSource( job, options, allocator, tree ) )
+        return false;
+    
+    GatherStatementsVisitor gather;
+    gather.VisitRoot( tree.GetRoot() );
+    vector<HLSLStatement*>& statements = gather.statements;
+    
+    for ( uint32_t i = 0; i < writtenBefore.size() && i < statements.size(); ++i )
+    {
+        statements[i]->written = writtenBefore[i] != 0;
+    }
+    
+    const char* entryName = entryPoint.c_str();
+    
+    HLSLTarget target = HLSLTarget_PixelShader;
+    if (endsWith(entryPoint, "VS"))
+        target = HLSLTarget_VertexShader;
+    else if (endsWith(entryPoint, "PS"))
+        target = HLSLTarget_PixelShader;
+    else if (endsWith(entryPoint, "CS"))
+        target = HLSLTarget_ComputeShader;
+    
+    bool success = false;
+    
+    // Generate output
+    if (job.language == Language_HLSL)
+    {
+        HLSLOptions generatorOptions;
+        generatorOptions.writeFileLine = options.isWriteFileLine;
+        generatorOptions.treatHalfAsFloat = options.isTreatHalfAsFloat;
+        generatorOptions.writeVulkan = true; // TODO: tie to CLI
+        
+        HLSLGenerator generator;
+        if (generator.Generate( &tree, target, entryName, generatorOptions))
+        {
+            // write the buffer out
+            output = generator.GetResult();
+            success = true;
+        }
+    }
+    else if (job.language == Language_MSL)
+    {
+        MSLOptions generatorOptions;
+        generatorOptions.writeFileLine = options.isWriteFileLine;
+        generatorOptions.treatHalfAsFloat = options.isTreatHalfAsFloat;
+        
+        MSLGenerator generator;
+        if (generator.Generate(&tree, target, entryName, generatorOptions))
         {
-            MSLOptions options;
-            options.writeFileLine = isWriteFileLine;
-            options.treatHalfAsFloat = isTreatHalfAsFloat;
-            
-            MSLGenerator generator;
-            if (generator.Generate(&tree, target, entryName, options))
+            // write the buffer out
+            output = generator.GetResult();
+            success = true;
+        }
+    }
+    
+    if ( !success )
+    {
+        Log_Error( "Translation of %s failed\n", entryName );
+        return false;
+    }
+    
+    if ( written )
+    {
+        written->resize( statements.size() );
+        for ( uint32_t i = 0; i < statements.size(); ++i )
+        {
+            (*written)[i] = statements[i]->written;
+        }
+    }
+    return true;
+}
+
+static bool WriteJob( const ShaderJob& job, const GenerateOptions& options )
+{
+    // leave the timestamp alone, so later build steps don't rerun
+    if ( job.isUpToDate )
+        return true;
+    
+    // using wb to avoid having Win convert \n to \r\n
+    FILE* fp = fopen( job.outputFileName.c_str(), "wb" );
+    if ( !fp )
+    {
+        Log_Error( "Could not open output file %s\n", job.outputFileName.c_str() );
+        return false;
+    }
+    
+    uint64_t outputHash = HashFnv1a64( nullptr, 0 );
+    for ( const string& output : job.entryOutputs )
+    {
+        fwrite( output.data(), 1, output.size(), fp );
+        outputHash = HashFnv1a64( output.data(), output.size(), outputHash );
+    }
+    fclose( fp );
+    
+    if ( !options.cacheDir.empty() && !job.isCached )
+        StoreCachedOutput( job, options );
+    
+    if ( options.isWriteDeps && !WriteDepsFile( job, outputHash ) )
+        return false;
+    
+    return true;
+}
+
+// Runs func(0..count-1) across numThreads, including the calling thread.
+template <typename Func>
+static void ParallelFor( uint32_t count, uint32_t numThreads, Func func )
+{
+    atomic<uint32_t> nextIndex( 0 );
+    auto worker = [&]() {
+        for ( uint32_t index = nextIndex++; index < count; index = nextIndex++ )
+        {
+            func( index );
+        }
+    };
+    
+    numThreads = std::min( numThreads, count );
+    
+    vector<thread> threads;
+    for ( uint32_t i = 1; i < numThreads; ++i )
+    {
+        threads.emplace_back( worker );
+    }
+    worker();
+    
+    for ( auto& t : threads )
+    {
+        t.join();
+    }
+}
+
+static bool RunJobs( vector<ShaderJob>& jobs, const GenerateOptions& options, uint32_t numThreads )
+{
+    // preprocess and find the entry points of all files
+    ParallelFor( (uint32_t)jobs.size(), numThreads, [&]( uint32_t jobIndex ) {
+        ShaderJob& job = jobs[jobIndex];
+        job.isFailed = !PrepareJob( job, options );
+    });
+    
+    // Then generate every entry point of every file in two passes.  The first
+    // generates each entry point on its own, which is the final output for the
+    // first entry point, and records what each one writes.  The second uses
+    // those to generate the remaining entry points with the same output
+    // as generating them one after another into a single tree.
+    struct EntryTask
+    {
+        uint32_t jobIndex;
+        uint32_t entryIndex;
+    };
+    vector<EntryTask> firstTasks;
+    vector<EntryTask> secondTasks;
+    for ( uint32_t jobIndex = 0; jobIndex < jobs.size(); ++jobIndex )
+    {
+        ShaderJob& job = jobs[jobIndex];
+        if ( job.isFailed )
+            continue;
+        
+        uint32_t numEntryPoints = (uint32_t)job.entryPoints.size();
+        job.entryWritten.resize( numEntryPoints );
+        
+        for ( uint32_t entryIndex = 0; entryIndex < numEntryPoints; ++entryIndex )
+        {
+            // last entry point doesn't affect any others
+            if ( entryIndex == 0 || entryIndex + 1 < numEntryPoints )
+                firstTasks.push_back( { jobIndex, entryIndex } );
+            if ( entryIndex > 0 )
+                secondTasks.push_back( { jobIndex, entryIndex } );
+        }
+    }
+    
+    vector<uint8_t> isTaskFailed( firstTasks.size(), 0 );
+    ParallelFor( (uint32_t)firstTasks.size(), numThreads, [&]( uint32_t taskIndex ) {
+        const EntryTask& task = firstTasks[taskIndex];
+        ShaderJob& job = jobs[task.jobIndex];
+        
+        string output;
+        isTaskFailed[taskIndex] = !GenerateEntryPoint( job, options, job.entryPoints[task.entryIndex],
+            vector<uint8_t>(), output, &job.entryWritten[task.entryIndex] );
+        
+        if ( task.entryIndex == 0 )
+            job.entryOutputs[0] = std::move( output );
+    });
+    
+    for ( uint32_t taskIndex = 0; taskIndex < firstTasks.size(); ++taskIndex )
+    {
+        if ( isTaskFailed[taskIndex] )
+            jobs[firstTasks[taskIndex].jobIndex].isFailed = true;
+    }
+    
+    // accumulate the written flags of all earlier entry points
+    for ( ShaderJob& job : jobs )
+    {
+        if ( job.isFailed )
+            continue;
+        
+        for ( uint32_t entryIndex = 1; entryIndex < job.entryWritten.size(); ++entryIndex )
+        {
+            vector<uint8_t>& written = job.entryWritten[entryIndex];
+            const vector<uint8_t>& writtenBefore = job.entryWritten[entryIndex - 1];
+            written.resize( writtenBefore.size() );
+            for ( uint32_t i = 0; i < writtenBefore.size(); ++i )
             {
-                // write the buffer out
-                output += generator.GetResult();
+                written[i] |= writtenBefore[i];
             }
-            else
+        }
+    }
+    
+    isTaskFailed.clear();
+    isTaskFailed.resize( secondTasks.size(), 0 );
+    ParallelFor( (uint32_t)secondTasks.size(), numThreads, [&]( uint32_t taskIndex ) {
+        const EntryTask& task = secondTasks[taskIndex];
+        ShaderJob& job = jobs[task.jobIndex];
+        if ( job.isFailed )
+            return;
+        
+        isTaskFailed[taskIndex] = !GenerateEntryPoint( job, options, job.entryPoints[task.entryIndex],
+            job.entryWritten[task.entryIndex - 1], job.entryOutputs[task.entryIndex], nullptr );
+    });
+    
+    for ( uint32_t taskIndex = 0; taskIndex < secondTasks.size(); ++taskIndex )
+    {
+        if ( isTaskFailed[taskIndex] )
+            jobs[secondTasks[taskIndex].jobIndex].isFailed = true;
+    }
+    
+    // don't write partial output for a file that failed
+    bool success = true;
+    for ( const ShaderJob& job : jobs )
+    {
+        if ( job.isFailed || !WriteJob( job, options ) )
+        {
+            Log_Error( "Failed %s\n", job.fileName.c_str() );
+            success = false;
+        }
+    }
+    
+    return success;
+}
+
+int main( int argc, char* argv[] )
+{
+	using namespace M4;
+
+	// Parse arguments
+	string fileName;
+    string manifestName;
+
+	// TODO: could we take modern DX12 HLSL and translate to MSL only
+	// That would simplify all this.  What spirv-cross already does though.
+	// Could drop HLSLGenerator then, and just use this to gen MSL.
+	// Much of the glue code can just be in a header, but having it
+	// in parser, lets this only splice code that is needed.
+
+    string outputFileName;
+    GenerateOptions options;
+    HLSLPreprocessorOptions preprocessorOptions;
+    uint32_t numThreads = std::max( 1u, thread::hardware_concurrency() );
+    
+	for( int argn = 1; argn < argc; ++argn )
+	{
+		const char* const arg = argv[ argn ];
+
+		if( String_Equal( arg, "-h" ) || String_Equal( arg, "--help" ) )
+		{
+			PrintUsage();
+			return 0;
+		}
+		
+        else if( String_Equal( arg, "-o" ) || String_Equal( arg, "-output" ) )
+        {
+            if ( ++argn < argc )
+                outputFileName = argv[ argn ];
+        }
+        else if( String_Equal( arg, "-i" ) || String_Equal( arg, "-input" ) )
+		{
+            if ( ++argn < argc )
+                fileName = argv[ argn ];
+		}
+        else if( String_Equal( arg, "-batch" ) )
+        {
+            if ( ++argn < argc )
+                manifestName = argv[ argn ];
+        }
+        else if( String_Equal( arg, "-j" ) )
+        {
+            if ( ++argn < argc )
+                numThreads = std::max( 1, atoi( argv[ argn ] ) );
+        }
+        else if ( String_Equal( arg, "-g" ))
+        {
+            // will preserve double-slash comments where possible
+            options.isDebug = true;
+        }
+        else if ( String_Equal( arg, "-nohalf" ))
+        {
+            // will preserve double-slash comments where possible
+            options.isTreatHalfAsFloat = true;
+        }
+        else if ( String_Equal( arg, "-line" ))
+        {
+            // will preserve double-slash comments where possible
+            options.isWriteFileLine = true;
+        }
+        else if ( String_Equal( arg, "-deps" ) )
+        {
+            options.isWriteDeps = true;
+        }
+        else if ( String_Equal( arg, "-cache" ) )
+        {
+            if ( ++argn < argc )
             {
-                Log_Error( "Translation failed, aborting\n" );
-                status = 1;
+                options.cacheDir = argv[ argn ];
+                options.isWriteDeps = true;
             }
         }
+        else if ( String_Equal( arg, "-D" ) )
+        {
+            if ( ++argn < argc )
+                preprocessorOptions.defines.push_back( argv[ argn ] );
+        }
+        else if ( String_Equal( arg, "-I" ) )
+        {
+            if ( ++argn < argc )
+                preprocessorOptions.includePaths.push_back( argv[ argn ] );
+        }
         
-        if (status != 0)
-            break;
-    }
+// This is derived from end characters of entry point
+//        else if( String_Equal( arg, "-vs" ) )
+//        {
+//            target = HLSLTarget_VertexShader;
+//        }
+//        else if( String_Equal( arg, "-fs" ) )
+//        {
+//            target = HLSLTarget_PixelShader;
+//        }
+ // TODO: require a arg to set entryName
+//		else if( entryName == NULL )
+//		{
+//			entryName = arg;
+//		}
+		else
+		{
+			Log_Error( "Too many arguments\n" );
+			PrintUsage();
+			return 1;
+		}
+	}
+
+    vector<ShaderJob> jobs;
     
-    if (status == 0)
+    if ( !manifestName.empty() )
     {
-        // using wb to avoid having Win convert \n to \r\n
-        FILE* fp = fopen( outputFileName.c_str(), "wb" );
-        if ( !fp )
+        if ( !fileName.empty() || !outputFileName.empty() )
         {
-            Log_Error( "Could not open output file %s\n", outputFileName.c_str() );
+            Log_Error( "-batch can't be combined with -i/-o\n" );
+            PrintUsage();
             return 1;
         }
         
-        fprintf(fp, "%s", output.c_str());
-        fclose( fp );
+        if ( !ReadManifest( manifestName.c_str(), preprocessorOptions, jobs ) )
+        {
+            return 1;
+        }
     }
-        
+    else
+    {
+        ShaderJob job;
+        job.preprocessorOptions = preprocessorOptions;
+        if ( !SetupJob( job, fileName, outputFileName ) )
+        {
+            PrintUsage();
+            return 1;
+        }
+        jobs.push_back( std::move( job ) );
+    }
+    
+    if ( !options.cacheDir.empty() )
+    {
+        std::error_code errorCode;
+        filesystem::create_directories( options.cacheDir, errorCode );
+        if ( errorCode )
+        {
+            Log_Error( "Could not create cache dir %s\n", options.cacheDir.c_str() );
+            return 1;
+        }
+    }
+    
+    //------------------------------------
+    // Now start the work
+    
+    int status = RunJobs( jobs, options, numThreads ) ? 0 : 1;
+    
     // It's not enough to return 1 from main, but set exit code.
     if (status)
         exit(status);
@@ -1,5 +1,67 @@
 #include "KramLib.h"
 
+#include <new>
+
+// Count the bytes of allocations while memory tracking is on, so that script
+// can report the peak memory of each command, and -maxmem can limit how many
+// run at once.  The counted size is stored in front of the allocation, since
+// free doesn't return it, and is 0 for allocations made while tracking is off.
+// This keeps the 16B alignment of malloc.
+static const size_t kAllocationHeaderSize = 16;
+
+// returns nullptr on failure
+static void* countedAllocNothrow(size_t size)
+{
+    uint8_t* ptr = (uint8_t*)malloc(size + kAllocationHeaderSize);
+    if (!ptr) {
+        return nullptr;
+    }
+
+    size_t countedSize = 0;
+    if (kram::isMemoryTracking()) {
+        countedSize = size;
+        kram::memoryAllocated(size);
+    }
+    *(size_t*)ptr = countedSize;
+
+    return ptr + kAllocationHeaderSize;
+}
+
+static void* countedAlloc(size_t size)
+{
+    void* ptr = countedAllocNothrow(size);
+    if (!ptr) {
+        // exceptions are disabled, so can't throw bad_alloc
+        abort();
+    }
+    return ptr;
+}
+
+static void countedFree(void* ptr)
+{
+    if (!ptr) {
+        return;
+    }
+    uint8_t* allocation = (uint8_t*)ptr - kAllocationHeaderSize;
+    size_t countedSize = *(size_t*)allocation;
+    if (countedSize > 0) {
+        kram::memoryFreed(countedSize);
+    }
+    free(allocation);
+}
+
+void* operator new(size_t size) { return countedAlloc(size); }
+void* operator new[](size_t size) { return countedAlloc(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAllocNothrow(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAllocNothrow(size); }
+
+void operator delete(void* ptr) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr) noexcept { countedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { countedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { countedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { countedFree(ptr); }
+
 int main(int argc, char* argv[])
 {
     int errorCode = kram::kramAppMain(argc, argv);
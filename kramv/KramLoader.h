@@ -40,6 +40,14 @@ class KTXImageData;
                                      (nullable MTLPixelFormat *)originalFormat
                                 name:(nonnull const char*)name;
 
+// load from a KTXImage, with imageDecoded already decoded from image if the
+// platform can't display the format.  Otherwise this decodes it.
+- (nullable id<MTLTexture>)loadTextureFromImage:(const kram::KTXImage &)image
+                                   imageDecoded:(nullable const kram::KTXImage *)imageDecoded
+                                 originalFormat:
+                                     (nullable MTLPixelFormat *)originalFormat
+                                name:(nonnull const char*)name;
+
 // load into KTXImage and KTXImageData, can use with loadTextureFromImage
 - (BOOL)loadImageFromURL:(nonnull NSURL *)url
                    image:(kram::KTXImage &)image
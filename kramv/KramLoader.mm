@@ -9,6 +9,7 @@
 #include <mutex>
 
 #include "KramLib.h"
+#include "KramViewerBase.h" // for decodeImage
 
 using namespace kram;
 using namespace NAMESPACE_STL;
@@ -74,59 +75,6 @@ struct KramBlit {
 
 
 
-// this means format isnt supported on platform, but can be decoded to rgba to
-// display
-bool isDecodeImageNeeded(MyMTLPixelFormat pixelFormat, MyMTLTextureType type)
-{
-    bool needsDecode = false;
-
-#if USE_SSE
-    if (isETCFormat(pixelFormat)) {
-        needsDecode = true;
-    }
-    else if (isASTCFormat(pixelFormat)) {
-        needsDecode = true;
-    }
-#else
-    if (isETCFormat(pixelFormat) && type == MyMTLTextureType3D) {
-        needsDecode = true;
-    }
-#endif
-    return needsDecode;
-}
-
-bool decodeImage(const KTXImage &image, KTXImage &imageDecoded)
-{
-    KramDecoderParams decoderParams;
-    KramDecoder decoder;
-#if USE_SSE
-    if (isETCFormat(image.pixelFormat)) {
-        if (!decoder.decode(image, imageDecoded, decoderParams)) {
-            return NO;
-        }
-    }
-    else if (isASTCFormat(image.pixelFormat)) {
-        if (!decoder.decode(image, imageDecoded, decoderParams)) {
-            return NO;
-        }
-    }
-#else
-    if (isETCFormat(image.pixelFormat) && image.textureType == MyMTLTextureType3D) {
-        if (!decoder.decode(image, imageDecoded, decoderParams)) {
-            return NO;
-        }
-    }
-#endif
-    else {
-        assert(false);  // don't call this routine if decode not needed
-    }
-
-    // TODO: decode BC format on iOS when not supported, but viewer only on macOS
-    // for now
-
-    return YES;
-}
-
 #if SUPPORT_RGB
 
 // TODO: move these into libkram
@@ -218,6 +166,18 @@ inline MyMTLPixelFormat remapInternalRGBFormat(MyMTLPixelFormat format)
                                  originalFormat:
                                      (nullable MTLPixelFormat *)originalFormat
                                            name:(const char*)name
+{
+    return [self loadTextureFromImage:image
+                         imageDecoded:nullptr
+                       originalFormat:originalFormat
+                                 name:name];
+}
+
+- (nullable id<MTLTexture>)loadTextureFromImage:(const KTXImage &)image
+                                   imageDecoded:(nullable const KTXImage *)imageDecoded
+                                 originalFormat:
+                                     (nullable MTLPixelFormat *)originalFormat
+                                           name:(const char*)name
 {
 #if SUPPORT_RGB
     if (isInternalRGBFormat(image.pixelFormat)) {
@@ -267,12 +227,17 @@ inline MyMTLPixelFormat remapInternalRGBFormat(MyMTLPixelFormat format)
     }
 
     if (isDecodeImageNeeded(image.pixelFormat, image.textureType)) {
-        KTXImage imageDecoded;
-        if (!decodeImage(image, imageDecoded)) {
+        // may have been decoded off the main thread
+        if (imageDecoded) {
+            return [self blitTextureFromImage:*imageDecoded name:name];
+        }
+        
+        KTXImage imageDecodedTmp;
+        if (!decodeImage(image, imageDecodedTmp)) {
             return nil;
         }
 
-        return [self blitTextureFromImage:imageDecoded name:name];
+        return [self blitTextureFromImage:imageDecodedTmp name:name];
     }
     else
     {
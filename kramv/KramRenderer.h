@@ -58,6 +58,7 @@ class KTXImage;
 - (BOOL)loadTextureFromImage:(nonnull const char *)fullFilenameString
                    timestamp:(double)timestamp
                        image:(kram::KTXImage &)image
+                imageDecoded:(nullable kram::KTXImage *)imageDecoded
                  imageNormal:(nullable kram::KTXImage *)imageNormal
                    imageDiff:(nullable kram::KTXImage *)imageDiff
                    isArchive:(BOOL)isArchive;
@@ -1150,6 +1150,7 @@ inline const char* toFilenameShort(const char* filename) {
 - (BOOL)loadTextureFromImage:(nonnull const char *)fullFilenameString
                    timestamp:(double)timestamp
                        image:(kram::KTXImage &)image
+                imageDecoded:(nullable kram::KTXImage *)imageDecoded
                  imageNormal:(nullable kram::KTXImage *)imageNormal
                    imageDiff:(nullable kram::KTXImage *)imageDiff
                    isArchive:(BOOL)isArchive
@@ -1170,6 +1171,7 @@ inline const char* toFilenameShort(const char* filename) {
 
         MTLPixelFormat originalFormatMTL = MTLPixelFormatInvalid;
         id<MTLTexture> texture = [_loader loadTextureFromImage:image
+                                                  imageDecoded:imageDecoded
                                                 originalFormat:&originalFormatMTL
                                                           name:filenameShort];
         if (!texture) {
@@ -1,5 +1,7 @@
 #include "KramViewerBase.h"
 
+#include "TaskSystem.h"
+
 #include "simdjson/simdjson.h"
 
 namespace kram {
@@ -162,6 +164,59 @@ bool isDirectory(const char* filename) {
     return fileHelper.isDirectory(filename);
 }
 
+// this means format isnt supported on platform, but can be decoded to rgba to
+// display
+bool isDecodeImageNeeded(MyMTLPixelFormat pixelFormat, MyMTLTextureType type)
+{
+    bool needsDecode = false;
+
+#if USE_SSE
+    if (isETCFormat(pixelFormat)) {
+        needsDecode = true;
+    }
+    else if (isASTCFormat(pixelFormat)) {
+        needsDecode = true;
+    }
+#else
+    if (isETCFormat(pixelFormat) && type == MyMTLTextureType3D) {
+        needsDecode = true;
+    }
+#endif
+    return needsDecode;
+}
+
+bool decodeImage(const KTXImage &image, KTXImage &imageDecoded)
+{
+    KramDecoderParams decoderParams;
+    KramDecoder decoder;
+#if USE_SSE
+    if (isETCFormat(image.pixelFormat)) {
+        if (!decoder.decode(image, imageDecoded, decoderParams)) {
+            return false;
+        }
+    }
+    else if (isASTCFormat(image.pixelFormat)) {
+        if (!decoder.decode(image, imageDecoded, decoderParams)) {
+            return false;
+        }
+    }
+#else
+    if (isETCFormat(image.pixelFormat) && image.textureType == MyMTLTextureType3D) {
+        if (!decoder.decode(image, imageDecoded, decoderParams)) {
+            return false;
+        }
+    }
+#endif
+    else {
+        assert(false);  // don't call this routine if decode not needed
+    }
+
+    // TODO: decode BC format on iOS when not supported, but viewer only on macOS
+    // for now
+
+    return true;
+}
+
 int32_t ShowSettings::totalChunks() const
 {
     int32_t one = 1;
@@ -678,9 +733,15 @@ Data::Data()
     _showSettings = new ShowSettings();
     
     _textSlots.resize(kTextSlotCount);
+    
+    // leave cores for the ui and gpu upload
+    _prefetchSystem = std::make_unique<task_system>(4);
 }
 Data::~Data()
 {
+    clearFileCache();
+    _prefetchSystem.reset();
+    
     delete _showSettings;
 }
 
@@ -775,8 +836,14 @@ bool Data::loadAtlasFile(const char* filename)
                 
             const char* verticalProp = "f"; // regionProps["rot"];
             bool isVertical = verticalProp && verticalProp[0] == 't';
-            
-            Atlas atlas = {(string)name, x,y, w,h, uPad,vPad, isVertical, (uint32_t)slice};
+
+            // 2d array atlases from kram atlas store the slice per region
+            uint64_t regionSlice = slice;
+            auto regionSliceProp = regionProps["slice"].get_uint64();
+            if (regionSliceProp.error() == SUCCESS)
+                regionSlice = regionSliceProp.value_unsafe();
+
+            Atlas atlas = {(string)name, x,y, w,h, uPad,vPad, isVertical, (uint32_t)regionSlice};
             _showSettings->atlas.emplace_back(std::move(atlas));
         }
     }
@@ -789,39 +856,18 @@ bool Data::loadAtlasFile(const char* filename)
     return true;
 }
 
-// opens archive
-bool Data::openArchive(const char * zipFilename, int32_t urlIndex)
+// Opens the archive, and lists the supported entries.  Can run on any thread.
+static bool openArchive(const char * zipFilename, FileContainer& container, vector<string>& names)
 {
-    // grow the array, ptrs so that existing mmaps aren't destroyed
-    if (urlIndex >= _containers.size()) {
-        _containers.resize(urlIndex + 1, nullptr);
-    }
-    
-    if (_containers[urlIndex] == nullptr)
-        _containers[urlIndex] = new FileContainer;
-    
-    FileContainer& container = *_containers[urlIndex];
     MmapHelper& zipMmap = container.zipMmap;
     ZipHelper& zip = container.zip;
     
-    // close any previous zip
-    zipMmap.close();
-    
-    // open the mmap again
     if (!zipMmap.open(zipFilename)) {
         return false;
     }
     if (!zip.openForRead(zipMmap.data(), zipMmap.dataLength())) {
         return false;
     }
-    return true;
-}
-
-// lists archive into _files
-bool Data::listFilesInArchive(int32_t urlIndex)
-{
-    FileContainer& container = *_containers[urlIndex];
-    ZipHelper& zip = container.zip;
     
     // filter out unsupported extensions
     vector<string> extensions = {
@@ -836,15 +882,16 @@ bool Data::listFilesInArchive(int32_t urlIndex)
 #endif
     };
     
-    container.zip.filterExtensions(extensions);
+    zip.filterExtensions(extensions);
     
     // don't switch to empty archive
     if (zip.zipEntrys().empty()) {
         return false;
     }
     
+    names.reserve(zip.zipEntrys().size());
     for (const auto& entry: zip.zipEntrys()) {
-        _files.emplace_back(File(entry.filename, urlIndex));
+        names.push_back(entry.filename);
     }
     
     return true;
@@ -927,43 +974,37 @@ bool Data::advanceFile(bool increment) {
     return _delegate.loadFile(true);
 }
 
-bool Data::findFilename(const string& filename)
+void Data::updateFileIndex()
 {
-    bool isFound = false;
+    _fileIndexByName.clear();
+    _fileIndexByNameShort.clear();
+    _fileIndexByName.reserve(_files.size());
+    _fileIndexByNameShort.reserve(_files.size());
     
-    // linear search
-    for (const auto& search : _files) {
-        if (search.name == filename) {
-            isFound = true;
-            break;
-        }
+    // emplace keeps the first in sorted order, if names repeat
+    for (int32_t i = 0; i < (int32_t)_files.size(); ++i) {
+        _fileIndexByName.emplace(_files[i].name, i);
+        _fileIndexByNameShort.emplace(_files[i].nameShort, i);
     }
-    return isFound;
+}
+
+bool Data::findFilename(const string& filename)
+{
+    return _fileIndexByName.find(filename) != _fileIndexByName.end();
 }
 
 bool Data::findFilenameShort(const string& filename)
 {
-    bool isFound = false;
-    
-    // linear search
-    for (const auto& search : _files) {
-        if (search.nameShort == filename) {
-            isFound = true;
-            break;
-        }
-    }
-    return isFound;
+    return _fileIndexByNameShort.find(filename) != _fileIndexByNameShort.end();
 }
 
 const File* Data::findFileShort(const string& filename)
 {
-    // linear search
-    for (const auto& search : _files) {
-        if (search.nameShort == filename) {
-            return &search;
-        }
+    auto it = _fileIndexByNameShort.find(filename);
+    if (it == _fileIndexByNameShort.end()) {
+        return nullptr;
     }
-    return nullptr;
+    return &_files[it->second];
 }
 
 // rect here is expect xy, wh
@@ -1130,8 +1171,13 @@ bool Data::loadFile()
     
     //-------------------------------
     
-    KTXImage image;
-    KTXImageData imageDataKTX;
+    // this requires decode and conversion to RGBA8u, usually already
+    // done by the prefetch
+    std::shared_ptr<FileCacheEntry> cachedFile = loadCachedFile(file, (double)timestamp);
+    if (!cachedFile) {
+        return false;
+    }
+    KTXImage& image = cachedFile->image;
     
     KTXImage imageNormal;
     KTXImageData imageNormalDataKTX;
@@ -1139,11 +1185,6 @@ bool Data::loadFile()
     KTXImage imageDiff;
     KTXImageData imageDiffDataKTX;
     
-    // this requires decode and conversion to RGBA8u
-    if (!imageDataKTX.open(fullFilename.c_str(), image)) {
-        return false;
-    }
-    
     // load up the diff, but would prefer to defer this
     if (hasDiff && !imageDiffDataKTX.open(diffFilename.c_str(), imageDiff)) {
         hasDiff = false;
@@ -1178,6 +1219,7 @@ bool Data::loadFile()
     
     if (!_delegate.loadTextureFromImage(fullFilename.c_str(), (double)timestamp,
         image,
+        cachedFile->isDecoded ? &cachedFile->imageDecoded : nullptr,
         hasNormal ? &imageNormal : nullptr,
         hasDiff ? &imageDiff : nullptr,
         false))
@@ -1189,6 +1231,8 @@ bool Data::loadFile()
     _showSettings->lastFilename = filename;
     _showSettings->lastTimestamp = timestamp;
     
+    prefetchFiles();
+    
     return true;
 }
 
@@ -1220,13 +1264,12 @@ bool Data::loadFileFromArchive()
         return false;
     }
     
-    const uint8_t* imageData = nullptr;
-    uint64_t imageDataLength = 0;
-
     // search for main file - can be albedo or normal
-    if (!zip.extractRaw(filename, &imageData, imageDataLength)) {
+    std::shared_ptr<FileCacheEntry> cachedFile = loadCachedFile(file, timestamp);
+    if (!cachedFile) {
         return false;
     }
+    KTXImage& image = cachedFile->image;
 
     const uint8_t* imageNormalData = nullptr;
     uint64_t imageNormalDataLength = 0;
@@ -1253,18 +1296,11 @@ bool Data::loadFileFromArchive()
 
     // files in archive are just offsets into the mmap
     // That's why we can't just pass filenames to the renderer
-    KTXImage image;
-    KTXImageData imageDataKTX;
-
     KTXImage imageNormal;
     KTXImageData imageNormalDataKTX;
 
     // TODO: do imageDiff here?
     
-    if (!imageDataKTX.open(imageData, imageDataLength, image)) {
-        return false;
-    }
-
     if (hasNormal && imageNormalDataKTX.open(
                          imageNormalData, imageNormalDataLength, imageNormal)) {
         // shaders only pull from albedo + normal on these texture types
@@ -1280,7 +1316,7 @@ bool Data::loadFileFromArchive()
 
     //---------------------------------
     
-    if (!_delegate.loadTextureFromImage(fullFilename.c_str(), (double)timestamp, image, hasNormal ? &imageNormal : nullptr, nullptr, true)) {
+    if (!_delegate.loadTextureFromImage(fullFilename.c_str(), (double)timestamp, image, cachedFile->isDecoded ? &cachedFile->imageDecoded : nullptr, hasNormal ? &imageNormal : nullptr, nullptr, true)) {
         return false;
     }
 
@@ -1290,18 +1326,239 @@ bool Data::loadFileFromArchive()
     string archiveURL = _urls[file.urlIndex];
     _archiveName = toFilenameShort(archiveURL.c_str());
     
+    prefetchFiles();
+    
     return true;
 }
 
+//--------------------------------
 
+// Loads on any thread.  Only touches the entry and the read-only archive.
+static void loadFileCacheEntry(FileCacheEntry& entry, const ZipHelper* zip)
+{
+    const char* filename = entry.name.c_str();
+    
+    if (zip) {
+        const auto* zipEntry = zip->zipEntry(filename);
+        if (!zipEntry) {
+            return;
+        }
+        
+        const uint8_t* fileData = nullptr;
+        uint64_t fileDataLength = 0;
+        
+        // stored entries alias the archive mmap, compressed ones are inflated
+        if (zipEntry->compressedSize == zipEntry->uncompressedSize) {
+            if (!zip->extractRaw(filename, &fileData, fileDataLength)) {
+                return;
+            }
+        }
+        else {
+            if (!zip->extract(filename, entry.data)) {
+                return;
+            }
+            fileData = entry.data.data();
+            fileDataLength = entry.data.size();
+        }
+        
+        if (!entry.imageData.open(fileData, fileDataLength, entry.image)) {
+            return;
+        }
+    }
+    else {
+        if (!entry.imageData.open(filename, entry.image)) {
+            return;
+        }
+    }
+    
+    if (isDecodeImageNeeded(entry.image.pixelFormat, entry.image.textureType)) {
+        if (!decodeImage(entry.image, entry.imageDecoded)) {
+            return;
+        }
+        entry.isDecoded = true;
+    }
+    
+    // KTX2 and png hold their mips in imageData, otherwise this is the mmap
+    auto imageMemorySize = [](const KTXImage& image) {
+        return image.imageData().empty() ? image.fileDataLength : image.imageData().size();
+    };
+    
+    entry.memorySize = entry.data.size() + imageMemorySize(entry.image);
+    if (entry.isDecoded) {
+        entry.memorySize += imageMemorySize(entry.imageDecoded);
+    }
+    entry.isLoaded = true;
+}
 
+static bool isEntryReady(const FileCacheEntry& entry)
+{
+    return entry.ready.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
 
-void Data::loadFilesFromUrls(vector<string>& urls, bool skipSubdirs)
+bool Data::isArchiveFile(const File& file) const
+{
+    return isSupportedArchiveFilename(_urls[file.urlIndex].c_str());
+}
+
+double Data::fileTimestamp(const File& file) const
+{
+    if (isArchiveFile(file)) {
+        const auto* entry = _containers[file.urlIndex]->zip.zipEntry(file.name.c_str());
+        return entry ? (double)entry->modificationDate : 0.0;
+    }
+    return (double)FileHelper::modificationTimestamp(file.name.c_str());
+}
+
+std::shared_ptr<FileCacheEntry> Data::findCachedFile(const File& file) const
+{
+    // cache only holds a few dozen files, so linear search
+    for (const auto& entry : _fileCache) {
+        if (entry->urlIndex == file.urlIndex && entry->name == file.name) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<FileCacheEntry> Data::startFileLoad(const File& file, double timestamp, bool isAsync)
+{
+    auto entry = std::make_shared<FileCacheEntry>();
+    entry->name = file.name;
+    entry->urlIndex = file.urlIndex;
+    entry->timestamp = timestamp;
+    
+    const ZipHelper* zip = isArchiveFile(file) ? &_containers[file.urlIndex]->zip : nullptr;
+    
+    auto promise = std::make_shared<std::promise<void>>();
+    entry->ready = promise->get_future().share();
+    
+    if (isAsync) {
+        _prefetchSystem->async_([entry, zip, promise]() {
+            loadFileCacheEntry(*entry, zip);
+            promise->set_value();
+        });
+    }
+    else {
+        loadFileCacheEntry(*entry, zip);
+        promise->set_value();
+    }
+    
+    _fileCache.push_back(entry);
+    return entry;
+}
+
+std::shared_ptr<FileCacheEntry> Data::loadCachedFile(const File& file, double timestamp)
+{
+    std::shared_ptr<FileCacheEntry> entry = findCachedFile(file);
+    if (entry) {
+        // may still be loading on the prefetch threads
+        entry->ready.wait();
+        
+        _fileCache.erase(std::find(_fileCache.begin(), _fileCache.end(), entry));
+        
+        // file was modified since prefetch, or failed, so load it again
+        if (entry->timestamp != timestamp || !entry->isLoaded) {
+            entry.reset();
+        }
+        else {
+            // now most recently used
+            _fileCache.push_back(entry);
+        }
+    }
+    
+    if (!entry) {
+        entry = startFileLoad(file, timestamp, false);
+    }
+    
+    if (!entry->isLoaded) {
+        return nullptr;
+    }
+    
+    trimFileCache();
+    return entry;
+}
+
+void Data::trimFileCache()
 {
-    // Using a member for archives, so limited to one archive in a drop
-    // but that's probably okay for now.  Add a separate array of open
-    // archives if want > 1.
+    size_t memorySize = 0;
+    for (const auto& entry : _fileCache) {
+        if (isEntryReady(*entry)) {
+            memorySize += entry->memorySize;
+        }
+    }
     
+    // evict least recently used, but keep the current file, and leave
+    // loading files to finish
+    const File* currentFile = _fileIndex < (int32_t)_files.size() ? &_files[_fileIndex] : nullptr;
+    
+    for (auto it = _fileCache.begin(); it != _fileCache.end() && memorySize > _fileCacheBudget; ) {
+        const FileCacheEntry& entry = **it;
+        bool isCurrent = currentFile && entry.urlIndex == currentFile->urlIndex && entry.name == currentFile->name;
+        if (isCurrent || !isEntryReady(entry)) {
+            ++it;
+            continue;
+        }
+        
+        memorySize -= entry.memorySize;
+        it = _fileCache.erase(it);
+    }
+}
+
+void Data::prefetchFiles()
+{
+    int32_t numFiles = (int32_t)_files.size();
+    if (numFiles <= 1) {
+        return;
+    }
+    
+    trimFileCache();
+    
+    size_t memorySize = 0;
+    for (const auto& entry : _fileCache) {
+        if (isEntryReady(*entry)) {
+            memorySize += entry->memorySize;
+        }
+    }
+    
+    // alternate next and previous, nearest first, so scrubbing either
+    // direction finds the next file already loaded
+    int32_t count = std::min(_prefetchCount, numFiles / 2);
+    for (int32_t i = 1; i <= count; ++i) {
+        for (int32_t direction = 1; direction >= -1; direction -= 2) {
+            if (memorySize >= _fileCacheBudget) {
+                return;
+            }
+            
+            int32_t fileIndex = (_fileIndex + direction * i + numFiles) % numFiles;
+            const File& file = _files[fileIndex];
+            
+            // models and atlas files aren't loaded as images
+            if (!isSupportedFilename(file.name.c_str())) {
+                continue;
+            }
+            if (findCachedFile(file)) {
+                continue;
+            }
+            
+            startFileLoad(file, fileTimestamp(file), true);
+        }
+    }
+}
+
+void Data::clearFileCache()
+{
+    // prefetch threads may reference archives, so wait for them before closing
+    for (const auto& entry : _fileCache) {
+        entry->ready.wait();
+    }
+    _fileCache.clear();
+}
+
+
+
+
+void Data::loadFilesFromUrls(vector<string>& urls, bool skipSubdirs)
+{
     // copy the existing files list
     string existingFilename;
     if (_fileIndex < (int32_t)_files.size())
@@ -1309,52 +1566,164 @@ void Data::loadFilesFromUrls(vector<string>& urls, bool skipSubdirs)
     
     // Fill this out again
     _files.clear();
+    clearFileCache();
     
     // clear pointers
     for (FileContainer* container: _containers)
         delete container;
     _containers.clear();
     
+    // Listing folders and opening archives is mostly waiting on io, so
+    // these run across threads.  Folders list their top level here, and then
+    // each subfolder is listed recursively on its own task.  Then all archives
+    // found are opened.  Results are merged in url order after each phase,
+    // so the urlIndex assignment doesn't depend on timing.
+    struct FolderListing {
+        vector<string> files;
+        vector<string> archiveFiles;
+    };
+    struct ArchiveListing {
+        string filename;
+        FileContainer* container = nullptr; // null if open failed
+        vector<string> names;
+    };
+    
+    vector<FolderListing> folderListings(urls.size());
+    vector<vector<string>> subfolders(urls.size());
+    vector<ArchiveListing> archiveListings;
+    
+    // url and the archives found in its folder, in order
+    vector<vector<uint32_t>> archiveIndices(urls.size());
+    
+    for (uint32_t i = 0; i < urls.size(); ++i) {
+        const char* filename = urls[i].c_str();
+        
+        if (isSupportedArchiveFilename(filename)) {
+            archiveIndices[i].push_back((uint32_t)archiveListings.size());
+            archiveListings.push_back({filename});
+        }
+        else if (isDirectory(filename)) {
+            listFilesInFolder(urls[i], folderListings[i].files, folderListings[i].archiveFiles,
+                              &subfolders[i]);
+            if (skipSubdirs) {
+                subfolders[i].clear();
+            }
+        }
+    }
+    
+    int32_t numJobs = (int32_t)std::max(1u, std::thread::hardware_concurrency());
+    
+    vector<FolderListing> subfolderListings;
+    vector<pair<uint32_t, uint32_t>> subfolderTasks; // url, subfolder
+    for (uint32_t i = 0; i < urls.size(); ++i) {
+        for (uint32_t j = 0; j < subfolders[i].size(); ++j) {
+            subfolderTasks.push_back({i, j});
+        }
+    }
+    subfolderListings.resize(subfolderTasks.size());
+    
+    if (!subfolderTasks.empty()) {
+        // destructor waits for the tasks
+        task_system system(numJobs);
+        
+        for (uint32_t t = 0; t < subfolderTasks.size(); ++t) {
+            system.async_([&, t]() {
+                const auto& task = subfolderTasks[t];
+                FolderListing& listing = subfolderListings[t];
+                listFilesInFolder(subfolders[task.first][task.second],
+                                  listing.files, listing.archiveFiles, nullptr);
+            });
+        }
+    }
+    
+    // merge subfolders into the listing of their url
+    for (uint32_t t = 0; t < subfolderTasks.size(); ++t) {
+        FolderListing& listing = folderListings[subfolderTasks[t].first];
+        FolderListing& subfolderListing = subfolderListings[t];
+        
+        listing.files.insert(listing.files.end(), subfolderListing.files.begin(), subfolderListing.files.end());
+        listing.archiveFiles.insert(listing.archiveFiles.end(), subfolderListing.archiveFiles.begin(), subfolderListing.archiveFiles.end());
+    }
+    
+    for (uint32_t i = 0; i < urls.size(); ++i) {
+        for (const string& archiveFilename : folderListings[i].archiveFiles) {
+            archiveIndices[i].push_back((uint32_t)archiveListings.size());
+            archiveListings.push_back({archiveFilename});
+        }
+    }
+    
+    if (!archiveListings.empty()) {
+        task_system system(numJobs);
+        
+        for (uint32_t a = 0; a < archiveListings.size(); ++a) {
+            system.async_([&, a]() {
+                ArchiveListing& archive = archiveListings[a];
+                
+                auto* container = new FileContainer;
+                if (openArchive(archive.filename.c_str(), *container, archive.names)) {
+                    archive.container = container;
+                }
+                else {
+                    delete container;
+                }
+            });
+        }
+    }
+    
+    //---------------------------------
+    
     // this will flatten the list
     int32_t urlIndex = 0;
     
     vector<string> urlsExtracted;
     
-    for (const auto& url: urls) {
+    auto addArchive = [&](ArchiveListing& archive) {
+        if (!archive.container) {
+            return;
+        }
+        
+        // ptrs so that existing mmaps aren't destroyed
+        _containers.resize(urlIndex + 1, nullptr);
+        _containers[urlIndex] = archive.container;
+        
+        for (const string& name : archive.names) {
+            _files.emplace_back(File(name.c_str(), urlIndex));
+        }
+        
+        urlsExtracted.push_back(archive.filename);
+        urlIndex++;
+    };
+    
+    size_t numFiles = 0;
+    for (const auto& listing : folderListings)
+        numFiles += listing.files.size();
+    for (const auto& archive : archiveListings)
+        numFiles += archive.names.size();
+    _files.reserve(numFiles + urls.size());
+    
+    for (uint32_t i = 0; i < urls.size(); ++i) {
+        const auto& url = urls[i];
+        
         // These will flatten out to a list of files
         const char* filename = url.c_str();
         
-        if (isSupportedArchiveFilename(filename) &&
-            openArchive(filename, urlIndex) &&
-            listFilesInArchive(urlIndex))
+        if (isSupportedArchiveFilename(filename))
         {
-            urlsExtracted.push_back(filename);
-            urlIndex++;
+            addArchive(archiveListings[archiveIndices[i][0]]);
         }
         else if (isDirectory(filename)) {
             
-            // this first loads only models, then textures if only those
-            listFilesInFolder(url, urlIndex, skipSubdirs);
+            for (const string& name : folderListings[i].files) {
+                _files.emplace_back(File(name.c_str(), urlIndex));
+            }
             
             // could skip if nothing added
             urlsExtracted.push_back(url);
             urlIndex++;
             
             // handle archives within folder
-            vector<File> archiveFiles;
-            listArchivesInFolder(url, archiveFiles, skipSubdirs);
-            
-            for (const File& archiveFile: archiveFiles) {
-                const char* archiveFilename = archiveFile.name.c_str();
-                if (openArchive(archiveFilename, urlIndex) &&
-                    listFilesInArchive(urlIndex)) {
-                    
-                    //NSURL* urlArchive = [NSURL fileURLWithPath:[NSString stringWithUTF8String:archiveFilename]];
-                    //[urlsExtracted addObject:urlArchive];
-                    urlsExtracted.push_back(archiveFilename);
-                    urlIndex++;
-                }
-                
+            for (uint32_t archiveIndex : archiveIndices[i]) {
+                addArchive(archiveListings[archiveIndex]);
             }
         }
         else if (isSupportedFilename(filename)
@@ -1385,15 +1754,15 @@ void Data::loadFilesFromUrls(vector<string>& urls, bool skipSubdirs)
     std::sort(_files.begin(), _files.end());
 #endif
     
+    updateFileIndex();
+    
     // preserve filename before load, and restore that index, by finding
     // that name in refreshed folder list
     _fileIndex = 0;
     if (!existingFilename.empty()) {
-        for (uint32_t i = 0; i < _files.size(); ++i) {
-            if (_files[i].name == existingFilename) {
-                _fileIndex = i;
-                break;
-            }
+        auto it = _fileIndexByName.find(existingFilename);
+        if (it != _fileIndexByName.end()) {
+            _fileIndex = it->second;
         }
     }
     
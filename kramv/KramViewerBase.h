@@ -3,6 +3,7 @@
 // in all copies or substantial portions of the Software.
 
 #include <cstdint>
+#include <future>
 
 #include "KramLib.h"  // for MyMTLPixelFormat
 //#include <string>
@@ -75,6 +76,8 @@ enum LightingMode {
     LightingModeCount,
 };
 
+class task_system;
+
 struct Atlas
 {
     string name;
@@ -443,6 +446,26 @@ public:
     string nameShort; // would alias name, but too risky
 };
 
+// A file or archive entry loaded and decoded off the main thread.  The image
+// can alias data, imageData, or the archive mmap, so these are only held
+// by shared_ptr and never copied.
+struct FileCacheEntry {
+    string name;
+    int32_t urlIndex = 0;
+    double timestamp = 0.0;
+    
+    vector<uint8_t> data;   // inflated archive entry
+    KTXImageData imageData; // mmap of the file, or png/dds conversion
+    KTXImage image;
+    KTXImage imageDecoded;  // when the format can't be displayed
+    bool isDecoded = false;
+    bool isLoaded = false;  // false if load failed
+    size_t memorySize = 0;
+    
+    // only read the fields above once this is ready
+    std::shared_future<void> ready;
+};
+
 // This allows wrapping all the ObjC stuff
 struct DataDelegate
 {
@@ -450,7 +473,7 @@ struct DataDelegate
     
     bool loadModelFile(const char* filename);
    
-    bool loadTextureFromImage(const char* fullFilename, double timestamp, KTXImage& image, KTXImage* imageNormal, KTXImage* imageDiff, bool isArchive);
+    bool loadTextureFromImage(const char* fullFilename, double timestamp, KTXImage& image, KTXImage* imageDecoded, KTXImage* imageNormal, KTXImage* imageDiff, bool isArchive);
     
 public:
     kram_id view; // MyMTKView*
@@ -461,8 +484,6 @@ struct Data {
     ~Data();
     
     bool loadAtlasFile(const char* filename);
-    bool listFilesInArchive(int32_t urlIndex);
-    bool openArchive(const char * zipFilename, int32_t urlIndex);
 
     bool hasCounterpart(bool increment);
     bool advanceCounterpart(bool increment);
@@ -493,8 +514,6 @@ struct Data {
     void setTextSlot(TextSlot slot, const char* text);
 
     void loadFilesFromUrls(vector<string>& urls, bool skipSubdirs);
-    void listArchivesInFolder(const string& archiveFilename, vector<File>& archiveFiles, bool skipSubdirs);
-    void listFilesInFolder(const string& folderFilename, int32_t urlIndex, bool skipSubdirs);
 
     // See these to split off ObjC code
     DataDelegate _delegate;
@@ -510,6 +529,20 @@ struct Data {
 
 private:
     bool loadFileFromArchive();
+    
+    // Loads go through the cache, and neighbors of the current file
+    // are prefetched after each load.
+    std::shared_ptr<FileCacheEntry> loadCachedFile(const File& file, double timestamp);
+    std::shared_ptr<FileCacheEntry> findCachedFile(const File& file) const;
+    std::shared_ptr<FileCacheEntry> startFileLoad(const File& file, double timestamp, bool isAsync);
+    void prefetchFiles();
+    void trimFileCache();
+    void clearFileCache();
+    bool isArchiveFile(const File& file) const;
+    double fileTimestamp(const File& file) const;
+    
+    // rebuild after _files is sorted
+    void updateFileIndex();
 
 public:
     void showEyedropperData(const float2& uv);
@@ -544,11 +577,22 @@ public:
     // folders and archives and multi-drop files are filled into this
     vector<File> _files;
     int32_t _fileIndex = 0;
+    
+    // index into _files of the first file with a given name
+    unordered_map<string, int32_t> _fileIndexByName;
+    unordered_map<string, int32_t> _fileIndexByNameShort;
    
     // One of these per url in _urlss
     vector<FileContainer*> _containers;
     vector<string> _urls;
     
+    // Neighbors of the current file are loaded on _prefetchSystem.  The cache
+    // is in least to most recently used order, and only touched on main thread.
+    std::unique_ptr<task_system> _prefetchSystem;
+    vector<std::shared_ptr<FileCacheEntry>> _fileCache;
+    size_t _fileCacheBudget = 512 * 1024 * 1024;
+    int32_t _prefetchCount = 4; // in each direction
+    
     Action* _actionPlay;
     Action* _actionShapeUVPreview;
     Action* _actionHelp;
@@ -593,6 +637,16 @@ public:
 };
 
 bool isSupportedModelFilename(const char* filename);
+
+// Lists supported files and archives under a folder, and can run on any thread.
+// If subfolders is passed, then this only lists the top level and returns the
+// subfolders, so that those can be listed in parallel.
+void listFilesInFolder(const string& folderFilename, vector<string>& files,
+                       vector<string>& archiveFiles, vector<string>* subfolders);
+
+// The platform can't display this format, so it must be decoded to rgba.
+bool isDecodeImageNeeded(MyMTLPixelFormat pixelFormat, MyMTLTextureType type);
+bool decodeImage(const KTXImage& image, KTXImage& imageDecoded);
 bool isSupportedArchiveFilename(const char* filename);
 bool isSupportedJsonFilename(const char* filename);
 
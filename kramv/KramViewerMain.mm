@@ -85,81 +85,65 @@ void Action::disableButton() {
 
 
 // These are using NSFileManager to list files, so must be ObjC
-void Data::listArchivesInFolder(const string& folderFilename, vector<File>& archiveFiles, bool skipSubdirs)
+void kram::listFilesInFolder(const string& folderFilename, vector<string>& files,
+                             vector<string>& archiveFiles, vector<string>* subfolders)
 {
-    NSURL* url = [NSURL fileURLWithPath:[NSString stringWithUTF8String:folderFilename.c_str()]];
-        
-    NSDirectoryEnumerationOptions options = NSDirectoryEnumerationSkipsHiddenFiles;
-    if (skipSubdirs)
-        options |= NSDirectoryEnumerationSkipsSubdirectoryDescendants;
-    
-    NSDirectoryEnumerator* directoryEnumerator =
-    [[NSFileManager defaultManager]
-     enumeratorAtURL:url
-     includingPropertiesForKeys:[NSArray array]
-     options:options
-     errorHandler:  // nil
-     ^BOOL(NSURL *urlArg, NSError *error) {
-        macroUnusedVar(urlArg);
-        macroUnusedVar(error);
-        
-        // handle error
-        return false;
-    }];
-    
-    // only display models in folder if found, ignore the png/jpg files
-    while (NSURL* fileOrDirectoryURL = [directoryEnumerator nextObject]) {
-        const char* name = fileOrDirectoryURL.fileSystemRepresentation;
-        
-        bool isArchive = isSupportedArchiveFilename(name);
-        if (isArchive)
-        {
-            archiveFiles.emplace_back(File(name,0));
-        }
-    }
-}
-
-void Data::listFilesInFolder(const string& archiveFilename, int32_t urlIndex, bool skipSubdirs)
-{
-    // Hope this hsas same permissions
-    NSURL* url = [NSURL fileURLWithPath:[NSString stringWithUTF8String:archiveFilename.c_str()]];
-    
-    NSDirectoryEnumerationOptions options = NSDirectoryEnumerationSkipsHiddenFiles;
-    if (skipSubdirs)
-        options |= NSDirectoryEnumerationSkipsSubdirectoryDescendants;
-    
-    NSDirectoryEnumerator* directoryEnumerator =
-    [[NSFileManager defaultManager]
-     enumeratorAtURL:url
-     includingPropertiesForKeys:[NSArray array]
-     options:options
-     errorHandler:  // nil
-     ^BOOL(NSURL *urlArg, NSError *error) {
-        macroUnusedVar(urlArg);
-        macroUnusedVar(error);
+    // called from task threads
+    @autoreleasepool {
+        // Hope this hsas same permissions
+        NSURL* url = [NSURL fileURLWithPath:[NSString stringWithUTF8String:folderFilename.c_str()]];
         
-        // handle error - don't change to folder if devoid of valid content
-        return false;
-    }];
-    
-    while (NSURL* fileOrDirectoryURL = [directoryEnumerator nextObject]) {
-        const char* name = fileOrDirectoryURL.fileSystemRepresentation;
+        NSDirectoryEnumerationOptions options = NSDirectoryEnumerationSkipsHiddenFiles;
+        if (subfolders)
+            options |= NSDirectoryEnumerationSkipsSubdirectoryDescendants;
         
-        bool isValid = isSupportedFilename(name);
+        NSDirectoryEnumerator* directoryEnumerator =
+        [[NSFileManager defaultManager]
+         enumeratorAtURL:url
+         includingPropertiesForKeys:subfolders ? @[NSURLIsDirectoryKey] : [NSArray array]
+         options:options
+         errorHandler:  // nil
+         ^BOOL(NSURL *urlArg, NSError *error) {
+            macroUnusedVar(urlArg);
+            macroUnusedVar(error);
+            
+            // handle error - don't change to folder if devoid of valid content
+            return false;
+        }];
         
+        while (NSURL* fileOrDirectoryURL = [directoryEnumerator nextObject]) {
+            const char* name = fileOrDirectoryURL.fileSystemRepresentation;
+            
+            if (subfolders) {
+                NSNumber* isDirectory = nil;
+                [fileOrDirectoryURL getResourceValue:&isDirectory forKey:NSURLIsDirectoryKey error:nil];
+                if (isDirectory.boolValue) {
+                    subfolders->push_back(name);
+                    continue;
+                }
+            }
+            
+            if (isSupportedArchiveFilename(name)) {
+                archiveFiles.push_back(name);
+                continue;
+            }
+            
+            bool isValid = isSupportedFilename(name);
+            
 #if USE_GLTF || USE_USD
-        // note: many gltf reference jpg which will load via GltfAsset, but
-        // kram and kramv do not import jpg files.
-        if (!isValid) {
-            isValid = isSupportedModelFilename(name);
-        }
+            // note: many gltf reference jpg which will load via GltfAsset, but
+            // kram and kramv do not import jpg files.
+            if (!isValid) {
+                isValid = isSupportedModelFilename(name);
+            }
 #endif
-        
-        if (!isValid) {
-            isValid = isSupportedJsonFilename(name);
-        }
-        if (isValid) {
-            _files.emplace_back(File(name,urlIndex));
+            
+            if (!isValid) {
+                isValid = isSupportedJsonFilename(name);
+            }
+            if (isValid) {
+                files.push_back(name);
+            }
         }
     }
 }
@@ -1828,7 +1812,7 @@ bool DataDelegate::loadModelFile(const char* filename)
     return [view_ loadModelFile:filename];
 }
 
-bool DataDelegate::loadTextureFromImage(const char* fullFilename, double timestamp, KTXImage& image, KTXImage* imageNormal, KTXImage* imageDiff, bool isArchive)
+bool DataDelegate::loadTextureFromImage(const char* fullFilename, double timestamp, KTXImage& image, KTXImage* imageDecoded, KTXImage* imageNormal, KTXImage* imageDiff, bool isArchive)
 {
     MyMTKView* view_ = (__bridge MyMTKView*)view;
     Renderer* renderer = (Renderer *)view_.delegate;
@@ -1837,6 +1821,7 @@ bool DataDelegate::loadTextureFromImage(const char* fullFilename, double timesta
     if (![renderer loadTextureFromImage:fullFilename
                               timestamp:timestamp
                                   image:image
+                           imageDecoded:imageDecoded
                             imageNormal:imageNormal
                               imageDiff:imageDiff
                               isArchive:isArchive]) {
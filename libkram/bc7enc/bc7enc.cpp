@@ -112,6 +112,9 @@ static const uint32_t BC7ENC_MODE_1_OPTIMAL_INDEX = 2;
 static endpoint_err g_bc7_mode_7_optimal_endpoints[256][2][2]; // [c][pbit][hp][lp]
 const uint32_t BC7E_MODE_7_OPTIMAL_INDEX = 1;
 
+static endpoint_err g_bc7_mode_5_optimal_endpoints[256]; // [c]
+const uint32_t BC7E_MODE_5_OPTIMAL_INDEX = 1;
+
 static float g_mode1_rgba_midpoints[64][2];
 static float g_mode5_rgba_midpoints[128];
 static float g_mode7_rgba_midpoints[32][2];
@@ -281,6 +284,39 @@ void bc7enc_compress_block_init()
 
 	} // c
 
+	// Mode 5: 777 2-bit color indices, used for solid blocks
+	for (int c = 0; c < 256; c++)
+	{
+		endpoint_err best;
+		best.m_error = (uint16_t)UINT16_MAX;
+		best.m_lo = 0;
+		best.m_hi = 0;
+
+		for (uint32_t l = 0; l < 128; l++)
+		{
+			uint32_t low = (l << 1);
+			low |= (low >> 7);
+
+			for (uint32_t h = 0; h < 128; h++)
+			{
+				uint32_t high = (h << 1);
+				high |= (high >> 7);
+
+				const int k = (low * (64 - g_bc7_weights2[BC7E_MODE_5_OPTIMAL_INDEX]) + high * g_bc7_weights2[BC7E_MODE_5_OPTIMAL_INDEX] + 32) >> 6;
+
+				const int err = (k - c) * (k - c);
+				if (err < best.m_error)
+				{
+					best.m_error = (uint16_t)err;
+					best.m_lo = (uint8_t)l;
+					best.m_hi = (uint8_t)h;
+				}
+			} // h
+		} // l
+
+		g_bc7_mode_5_optimal_endpoints[c] = best;
+	} // c
+
 	g_initialized = true;
 }
 
@@ -2399,6 +2435,41 @@ static void handle_opaque_block(void *pBlock, const color_rgba *pPixels, const b
 	encode_bc7_block(pBlock, &opt_results);
 }
 
+// kram - solid blocks skip the mode search, and pack to mode 5 with the optimal endpoint table.
+// Alpha has 8-bit endpoints in mode 5, so it's always exact.
+void bc7enc_compress_block_solid(void *pBlock, const color_rgba *pColor)
+{
+	assert(g_initialized);
+
+	uint8_t* pBytes = (uint8_t*)pBlock;
+	memset(pBytes, 0, BC7ENC_BLOCK_SIZE);
+
+	uint32_t cur_bit_ofs = 0;
+
+	// mode 5 is 5 zero bits then a 1, no rotation
+	set_block_bits(pBytes, 1 << 5, 6, &cur_bit_ofs);
+	set_block_bits(pBytes, 0, 2, &cur_bit_ofs);
+
+	for (uint32_t c = 0; c < 3; c++)
+	{
+		const endpoint_err& e = g_bc7_mode_5_optimal_endpoints[pColor->m_c[c]];
+		set_block_bits(pBytes, e.m_lo, 7, &cur_bit_ofs);
+		set_block_bits(pBytes, e.m_hi, 7, &cur_bit_ofs);
+	}
+
+	set_block_bits(pBytes, pColor->m_c[3], 8, &cur_bit_ofs);
+	set_block_bits(pBytes, pColor->m_c[3], 8, &cur_bit_ofs);
+
+	// color selectors, anchor index drops the msb
+	set_block_bits(pBytes, BC7E_MODE_5_OPTIMAL_INDEX, 1, &cur_bit_ofs);
+	for (uint32_t i = 1; i < 16; i++)
+		set_block_bits(pBytes, BC7E_MODE_5_OPTIMAL_INDEX, 2, &cur_bit_ofs);
+
+	// alpha selectors are all 0, and already cleared
+	cur_bit_ofs += 31;
+	assert(cur_bit_ofs == 128);
+}
+
 bool bc7enc_compress_block(void *pBlock, const void *pPixelsRGBA, const bc7enc_compress_block_params *pComp_params)
 {
 	assert(g_bc7_mode_1_optimal_endpoints[255][0].m_hi != 0);
@@ -120,4 +120,7 @@ void bc7enc_compress_block_init();
 // Returns true if the block had any pixels with alpha < 255, otherwise it return false. (This is not an error code - a block is always encoded.)
 bool bc7enc_compress_block(void *pBlock, const void *pPixelsRGBA, const bc7enc_compress_block_params *pComp_params);
 
+// Packs a block where all 16 pixels are pColor to mode 5, using the optimal endpoint table.  Much faster than above.
+void bc7enc_compress_block_solid(void *pBlock, const color_rgba *pColor);
+
 
@@ -1325,8 +1325,8 @@ float    BC6HBlockEncoder::EncodePattern(AMD_BC6H_Format &BC6H_data, float  erro
 
 //==================================================================================
 // CompressBlock
-// in[]  is half float32 data  [0..1] for unsigned and [-1..+1] for signed
-// it will be converted to 16 bit half CMP_HALFSHORT (short with signed component) for processing
+// in[]  is the 16 bit half bits of each channel stored as float (0..0x7BFF),
+// and the negated bits for negative values when signed.  See toHalf below.
 //
 // out is 128 bits BC6H Encoded data
 //==================================================================================
@@ -1426,8 +1426,9 @@ float BC6HBlockEncoder::CompressBlock(float in[MAX_SUBSET_SIZE][MAX_DIMENSION_BI
         BC6H_data.d_shape_index = bestShape;
     }
 
-    // now run through all two regions shapes to find the best pattern
-    for (int shape = 0; shape < MAX_BC6H_PARTITIONS; shape++) {
+    // now run through the two regions shapes to find the best pattern
+    int maxShapes = (m_maxPartitions < MAX_BC6H_PARTITIONS) ? m_maxPartitions : MAX_BC6H_PARTITIONS;
+    for (int shape = 0; shape < maxShapes; shape++) {
         error = FindBestPattern(BC6H_data, true, shape);
         if (error < bestError) {
             bestError = error;
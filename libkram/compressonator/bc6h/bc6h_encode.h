@@ -48,12 +48,17 @@
 #define DELTA_DOWN       2
 #define DELTA_LEFT       3
 
+// Alec added defaults, these were left uninitialized by callers.
 struct CMP_BC6H_BLOCK_PARAMETERS {
-    float quality;
-    bool usePatternRec;
-    bool isSigned;
-    DWORD modeMask;
-    float exposure;
+    float quality = 0.05f;
+    bool usePatternRec = false;
+    bool isSigned = false;
+    DWORD modeMask = 0xFFFF;
+    float exposure = 1.0f;
+    
+    // Alec added this, number of two region partitions searched.
+    // The lower partitions are the more common ones.
+    int maxPartitions = MAX_BC6H_PARTITIONS;
 };
 
 class BC6HBlockEncoder {
@@ -67,6 +72,7 @@ class BC6HBlockEncoder {
         m_isSigned                = user_options.isSigned;
         m_ModeMask                = user_options.modeMask;
         m_Exposure                = user_options.exposure;
+        m_maxPartitions           = user_options.maxPartitions;
         m_bAverageEndPoint        = true;
         m_DiffLevel               = 0.01f;
     };
@@ -129,6 +135,7 @@ private:
     DWORD   m_ModeMask;
     bool    m_isSigned;
     float  m_Exposure;
+    int     m_maxPartitions = MAX_BC6H_PARTITIONS;
     bool    m_bAverageEndPoint;         // Enables Averaging Endpoints for low bits modes
     float   m_DiffLevel;                // Threashhold for Channel diferance to set Averages value of channels on Endpoints
 };
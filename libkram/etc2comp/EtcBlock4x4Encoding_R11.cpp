@@ -168,8 +168,6 @@ namespace Etc
             return;
         }
     
-        m_uiEncodingIterations = lastIterationCount;
-        
         // everything is re-established from the encoded block and iteration count
         // since we already have to allocate the block storage, an iteration count per block is only additional
         // also encoders are now across all blocks, so could just allocate one block per thread and iterate until
@@ -209,6 +207,10 @@ namespace Etc
 
         // call this to continue encoding later iterations
         Encode(sourcePixels, encodingBits, isSnorm);
+        
+        // Encode starts over at the first iteration, so restore the count after it.
+        // Otherwise multipass repeats the same iterations and never finishes the block.
+        m_uiEncodingIterations = lastIterationCount;
     
         // recompute the block error by decoding each pixel
         // could save out error to SortedBlock avoid needing to compute all this
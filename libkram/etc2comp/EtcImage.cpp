@@ -48,6 +48,8 @@ Image is an array of 4x4 blocks that represent the encoding of the source image
 #include <assert.h>
 //#include <vector>
 
+#include "TaskSystem.h"
+
 #define ETCCOMP_MIN_EFFORT_LEVEL (0.0f)
 #define ETCCOMP_DEFAULT_EFFORT_LEVEL (40.0f)
 #define ETCCOMP_MAX_EFFORT_LEVEL (100.0f)
@@ -256,7 +258,8 @@ namespace Etc
 	// ----------------------------------------------------------------------------------------------------
 	Image::EncodingStatus Image::Encode(float blockPercent,
                                         float a_fEffort,
-                                        uint8_t* outputTexture)
+                                        uint8_t* outputTexture,
+                                        int numThreads)
 	{
 
 		auto start = std::chrono::steady_clock::now();
@@ -284,7 +287,6 @@ namespace Etc
             }
         };
         
-        int totalIterations = 0;
         int numberOfBlocks = GetNumberOfBlocks();
         
         vector<SortedBlock> sortedBlocks;
@@ -331,10 +333,6 @@ namespace Etc
         }
         
         // iterate on all blocks at least once and possible more iterations
-        
-        // setup for rgb/a
-        Block4x4 block;
-        Block4x4Encoding* encoder = nullptr;
        
         // setup for r/rg11
         bool isSnorm =
@@ -346,104 +344,143 @@ namespace Etc
         bool isRG =
             m_format == Image::Format::RG11 ||
             m_format == Image::Format::SIGNED_RG11;
-       
-        IBlockEncoding* encoderRG = nullptr;
-        if (isR)
-            encoderRG = new Block4x4Encoding_R11;
-        else if (isRG)
-            encoderRG = new Block4x4Encoding_RG11;
         
-        ColorFloatRGBA sourcePixels[16];
+        std::atomic<int> totalIterations(0);
         
         int pass = 0;
         
         while(true)
         {
+            // The first pass has the blocks in row order, so each thread takes the next row.
+            // Later passes only have the blocks with the largest errors, so take a span of those.
+            const int kSortedBlocksPerSpan = 64;
+            
+            int numSortedBlocks = (int)sortedBlocks.size();
+            int spanSize = (pass == 0) ? (int)m_uiBlockColumns : kSortedBlocksPerSpan;
+            int numSpans = (numSortedBlocks + spanSize - 1) / spanSize;
+            std::atomic<int> nextSpan(0);
+            
             // At the end of encode, blocks are encoded back to the outputTexture
             // that way no additional storage is needed, and only one block per thread
-            // is required.  This doesn't do threading, since a process works on one texture.
-            for (auto& it : sortedBlocks)
-            {
-                int srcX = it.srcX;
-                int srcY = it.srcY;
-            
-                uint8_t* outputBlock = outputTexture + (srcY * m_uiBlockColumns + srcX) * blockSize;
-    
-                if (!encoderRG) {
-                    // this block copies out a 4x4 tile from the source image
-                    if (pass == 0)
+            // is required.  Blocks only read the source image, so can encode in any order.
+            auto encodeSpans = [&]() {
+                // setup for rgb/a, encoder is owned by the block
+                Block4x4 block;
+                
+                IBlockEncoding* encoderRG = nullptr;
+                if (isR)
+                    encoderRG = new Block4x4Encoding_R11;
+                else if (isRG)
+                    encoderRG = new Block4x4Encoding_RG11;
+                
+                ColorFloatRGBA sourcePixels[16];
+                int iterations = 0;
+                
+                for (int span = nextSpan++; span < numSpans; span = nextSpan++)
+                {
+                    int spanEnd = std::min(numSortedBlocks, (span + 1) * spanSize);
+                    
+                    for (int i = span * spanSize; i < spanEnd; ++i)
                     {
-                        block.Encode(this, srcX * 4, srcY * 4, outputBlock);
+                        SortedBlock& it = sortedBlocks[i];
                         
-                        // encoder is allocated on first encode, then reused for the rest
-                        // to multithread, would need one block/encoder per therad
-                        if (!encoder)
-                        {
-                            encoder = block.GetEncoding();
-                        }
-                    }
-                    else
-                    {
-                        block.Decode(srcX * 4, srcY * 4, outputBlock, this, pass);
-                    }
-
-                    // this is one pass
-                    encoder->PerformIteration(m_fEffort);
-                    totalIterations++;
-                    
-                    // convert to etc block bits
-                    encoder->SetEncodingBits();
+                        int srcX = it.srcX;
+                        int srcY = it.srcY;
                     
-                    it.iterationData = pass;
-                    it.error = encoder->IsDone() ? 0.0f : encoder->GetError();
-                }
-                else {
-                    // different interface for r/rg11, but same logic as above
-                    int uiPixel = 0;
-                
-                    // this copy is a transpose of the block before encoding
-                    for (int xx = 0; xx < 4; xx++)
-                    {
-                        int srcXX = 4 * srcX + xx;
+                        uint8_t* outputBlock = outputTexture + (srcY * m_uiBlockColumns + srcX) * blockSize;
+            
+                        if (!encoderRG) {
+                            // this block copies out a 4x4 tile from the source image
+                            if (pass == 0)
+                            {
+                                block.Encode(this, srcX * 4, srcY * 4, outputBlock);
+                            }
+                            else
+                            {
+                                block.Decode(srcX * 4, srcY * 4, outputBlock, this, pass);
+                            }
+                            
+                            // encoder is allocated on first encode, then reused for the rest
+                            Block4x4Encoding* encoder = block.GetEncoding();
+                            
+                            // this is one pass
+                            encoder->PerformIteration(m_fEffort);
+                            iterations++;
+                            
+                            // convert to etc block bits
+                            encoder->SetEncodingBits();
+                            
+                            it.iterationData = pass;
+                            it.error = encoder->IsDone() ? 0.0f : encoder->GetError();
+                        }
+                        else {
+                            // different interface for r/rg11, but same logic as above
+                            int uiPixel = 0;
+                        
+                            // this copy is a transpose of the block before encoding
+                            for (int xx = 0; xx < 4; xx++)
+                            {
+                                int srcXX = 4 * srcX + xx;
 
-                        for (int yy = 0; yy < 4; yy++)
-                        {
-                            int srcYY = 4 * srcY + yy;
+                                for (int yy = 0; yy < 4; yy++)
+                                {
+                                    int srcYY = 4 * srcY + yy;
 
-                            ColorFloatRGBA sourcePixel = this->GetSourcePixel(srcXX, srcYY);
-                            sourcePixels[uiPixel++] = sourcePixel;
+                                    ColorFloatRGBA sourcePixel = this->GetSourcePixel(srcXX, srcYY);
+                                    sourcePixels[uiPixel++] = sourcePixel;
+                                }
+                            }
+                            
+                            // encode that block in as many iterations as it takes to finish
+                            if (pass == 0)
+                            {
+                                encoderRG->Encode(&sourcePixels[0].fR, outputBlock, isSnorm);
+                            }
+                            else
+                            {
+                                encoderRG->Decode(outputBlock, &sourcePixels[0].fR, isSnorm, it.iterationData);
+                            }
+                        
+                            encoderRG->PerformIteration(m_fEffort);
+                            iterations++;
+                            
+                            // store to etc block
+                            encoderRG->SetEncodingBits();
+                            
+                            it.iterationData = encoderRG->GetIterationCount();
+                            it.error = encoderRG->IsDone() ? 0.0f : encoderRG->GetError();
                         }
                     }
-                    
-                    // encode that block in as many iterations as it takes to finish
-                    if (pass == 0)
-                    {
-                        encoderRG->Encode(&sourcePixels[0].fR, outputBlock, isSnorm);
-                    }
-                    else
-                    {
-                        encoderRG->Decode(outputBlock, &sourcePixels[0].fR, isSnorm, it.iterationData);
-                    }
+                }
                 
-                    encoderRG->PerformIteration(m_fEffort);
-                    totalIterations++;
-                    
-                    // store to etc block
-                    encoderRG->SetEncodingBits();
-                    
-                    it.iterationData = encoderRG->GetIterationCount();
-                    it.error = encoderRG->IsDone() ? 0.0f : encoderRG->GetError();
+                // this encoder isn't created/held by a block, so must be deleted
+                delete encoderRG;
+                
+                totalIterations += iterations;
+            };
+            
+            int numPassThreads = std::min(numThreads, numSpans);
+            if (numPassThreads <= 1)
+            {
+                encodeSpans();
+            }
+            else
+            {
+                // waits for all spans in the destructor
+                kram::task_system system(numPassThreads);
+                for (int i = 0; i < system.num_threads(); ++i)
+                {
+                    system.async_(encodeSpans);
                 }
+            }
             
+            // Each pass processes all of its blocks, and then counts the finished ones.
+            // Stopping partway through a pass would depend on which thread finished first.
+            for (const auto& it : sortedBlocks)
+            {
                 if (it.error == 0.0f)
                 {
                     numBlocksToFinish--;
-                    
-                    // stop once block count reached, but can only stop once all blocks encoded at least once
-                    if (pass > 0 && numBlocksToFinish <= 0)
-                    {
-                        break;
-                    }
                 }
             }
             
@@ -479,11 +516,9 @@ namespace Etc
             pass++;
         }
         
-        delete encoderRG;
-        
         if (m_bVerboseOutput)
         {
-            KLOGI("EtcComp", "Total iterations %d in %d passes\n", totalIterations, pass + 1);
+            KLOGI("EtcComp", "Total iterations %d in %d passes\n", totalIterations.load(), pass + 1);
         }
         
         auto end = std::chrono::steady_clock::now();
@@ -74,8 +74,9 @@ namespace Etc
 
 		~Image(void);
 
-        // Multipass encoding.  Uses tons of memory but can thread even though it doesn't help.
-		EncodingStatus Encode(float blockPercent, float a_fEffort, uint8_t* outputTexture);
+        // Multipass encoding.  Iterates all blocks once, then the blocks with the largest errors.
+        // Each pass spreads its blocks across numThreads.
+		EncodingStatus Encode(float blockPercent, float a_fEffort, uint8_t* outputTexture, int numThreads = 1);
 
         // Single-pass encoding. One block at a time to not was so much memory and time as Encode does.
         EncodingStatus EncodeSinglepass(float a_fEffort, uint8_t* outputTexture);
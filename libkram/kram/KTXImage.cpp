@@ -82,7 +82,7 @@ enum MyDXGIFormat : uint32_t
     //DXGI_FORMAT_R10G10B10A2_TYPELESS                    = 23,
     //DXGI_FORMAT_R10G10B10A2_UNORM                       = 24,
     //DXGI_FORMAT_R10G10B10A2_UINT                        = 25,
-    //DXGI_FORMAT_R11G11B10_FLOAT                         = 26,
+    DXGI_FORMAT_R11G11B10_FLOAT                         = 26,
     
     //DXGI_FORMAT_R8G8B8A8_TYPELESS                       = 27,
     DXGI_FORMAT_R8G8B8A8_UNORM                          = 28,
@@ -129,7 +129,7 @@ enum MyDXGIFormat : uint32_t
     
     //DXGI_FORMAT_A8_UNORM                                = 65,
     //DXGI_FORMAT_R1_UNORM                                = 66,
-    //DXGI_FORMAT_R9G9B9E5_SHAREDEXP                      = 67,
+    DXGI_FORMAT_R9G9B9E5_SHAREDEXP                      = 67,
     
     //DXGI_FORMAT_R8G8_B8G8_UNORM                         = 68,
     //DXGI_FORMAT_G8R8_G8B8_UNORM                         = 69,
@@ -338,6 +338,9 @@ enum GLFormat : uint32_t {
     GL_RG32F = 0x8230,
     GL_RGBA32F = 0x8814,
 
+    GL_R11F_G11F_B10F = 0x8C3A,
+    GL_RGB9_E5 = 0x8C3D,
+
 #if SUPPORT_RGB
     GL_RGB8 = 0x8051,
     GL_SRGB8 = 0x8C41,
@@ -377,6 +380,10 @@ enum GLElementType {
     GL_HALF_FLOAT = 0x140B,
     GL_FLOAT = 0x1406,
     //GL_FIXED                          = 0x140C,
+
+    // packed types
+    GL_UNSIGNED_INT_10F_11F_11F_REV = 0x8C3B,
+    GL_UNSIGNED_INT_5_9_9_9_REV = 0x8C3E,
 };
 
 enum GLFormatBase {
@@ -409,6 +416,9 @@ enum MyVKFormat {
     VK_FORMAT_R32G32_SFLOAT = 103,
     VK_FORMAT_R32G32B32A32_SFLOAT = 109,
 
+    VK_FORMAT_B10G11R11_UFLOAT_PACK32 = 122,
+    VK_FORMAT_E5B9G9R9_UFLOAT_PACK32 = 123,
+
     // distinguish HDR from LDR formats
     // Provided by VK_EXT_texture_compression_astc_hdr
     VK_FORMAT_ASTC_4x4_SFLOAT_BLOCK_EXT = 1000066000,  // large decimal
@@ -508,6 +518,7 @@ enum KTXFormatFlag {
     FLAG_SIGNED = (1 << 2),
     FLAG_16F = (1 << 3),
     FLAG_32F = (1 << 4),
+    FLAG_PACKED = (1 << 8),  // one 32-bit texel, not a type per channel
 
     // compressed block forats
     FLAG_ENC_BC = (1 << 5),
@@ -603,6 +614,7 @@ public:
     bool isHDR() const { return flags & (FLAG_16F | FLAG_32F); }
     bool is16F() const { return flags & FLAG_16F; }
     bool is32F() const { return flags & FLAG_32F; }
+    bool isPacked() const { return flags & FLAG_PACKED; }
 
     bool isBC() const { return flags & FLAG_ENC_BC; }
     bool isASTC() const { return flags & FLAG_ENC_ASTC; }
@@ -711,6 +723,10 @@ static bool initFormatsIfNeeded()
     KTX_FORMAT(EXPrg32f, MyMTLPixelFormatRG32Float, VK_FORMAT_R32G32_SFLOAT, DXGI_FORMAT_R32G32_FLOAT, GL_RG32F, GL_RG, 1, 1, 8, 2, FLAG_32F)
     KTX_FORMAT(EXPrgba32f, MyMTLPixelFormatRGBA32Float, VK_FORMAT_R32G32B32A32_SFLOAT, DXGI_FORMAT_R32G32B32A32_FLOAT, GL_RGBA32F, GL_RGBA, 1, 1, 16, 4, FLAG_32F)
 
+    // these are unsigned, and decode to 16f
+    KTX_FORMAT(EXPrg11b10f, MyMTLPixelFormatRG11B10Float, VK_FORMAT_B10G11R11_UFLOAT_PACK32, DXGI_FORMAT_R11G11B10_FLOAT, GL_R11F_G11F_B10F, GL_RGB, 1, 1, 4, 3, FLAG_16F | FLAG_PACKED)
+    KTX_FORMAT(EXPrgb9e5f, MyMTLPixelFormatRGB9E5Float, VK_FORMAT_E5B9G9R9_UFLOAT_PACK32, DXGI_FORMAT_R9G9B9E5_SHAREDEXP, GL_RGB9_E5, GL_RGB, 1, 1, 4, 3, FLAG_16F | FLAG_PACKED)
+
 #if SUPPORT_RGB
     // these are import only formats
     // DX only has one of these as a valid type
@@ -752,6 +768,12 @@ bool isHalfFormat(MyMTLPixelFormat format)
     return it.is16F();
 }
 
+bool isPackedFloatFormat(MyMTLPixelFormat format)
+{
+    const auto& it = formatInfo(format);
+    return it.isPacked();
+}
+
 bool isBCFormat(MyMTLPixelFormat format)
 {
     const auto& it = formatInfo(format);
@@ -1108,7 +1130,11 @@ void KTXHeader::initFormatGL(MyMTLPixelFormat pixelFormat)
         glFormat = 0;
     }
     else {
-        if (info.is16F()) {
+        if (info.isPacked()) {
+            glType = (pixelFormat == MyMTLPixelFormatRGB9E5Float) ? GL_UNSIGNED_INT_5_9_9_9_REV : GL_UNSIGNED_INT_10F_11F_11F_REV;
+            glTypeSize = 4;
+        }
+        else if (info.is16F()) {
             glType = GL_HALF_FLOAT;
             glTypeSize = 2;
         }
@@ -100,8 +100,10 @@ enum MyMTLPixelFormat {
     MyMTLPixelFormatRG32Float = 105,
     MyMTLPixelFormatRGBA32Float = 125,
 
-// TODO: also need rgb9e5 for fallback if ASTC HDR/6H not supported
-// That is Unity's fallback if alpha not needed, otherwise RGBA16F.
+    // Packed 32-bit hdr formats.  Fallback if ASTC HDR/BC6H not supported.
+    // That is Unity's fallback if alpha not needed, otherwise RGBA16F.
+    MyMTLPixelFormatRG11B10Float = 92,
+    MyMTLPixelFormatRGB9E5Float = 93,
 
 #if SUPPORT_RGB
     // Can import files from KTX/KTX2 with RGB data, but convert right away to RGBA.
@@ -415,6 +417,7 @@ const char* supercompressionName(KTX2Supercompression type);
 // Generic format helpers.  All based on the ubiquitous type.
 bool isFloatFormat(MyMTLPixelFormat format);
 bool isHalfFormat(MyMTLPixelFormat format);
+bool isPackedFloatFormat(MyMTLPixelFormat format);
 bool isHdrFormat(MyMTLPixelFormat format);
 bool isSrgbFormat(MyMTLPixelFormat format);
 bool isColorFormat(MyMTLPixelFormat format);
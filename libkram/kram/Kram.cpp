@@ -19,8 +19,10 @@
 #include "KramDDSHelper.h"
 #include "KramFileHelper.h"
 #include "KramImage.h"  // has config defines, move them out
+#include "KramMemory.h"
 #include "KramMmapHelper.h"
 #include "KramTimer.h"
+#include "KramTrace.h"
 #include "KramVersion.h"
 #include "TaskSystem.h"
 #include "lodepng.h"
@@ -47,6 +49,14 @@ void* operator new[](size_t size, size_t alignment, size_t alignmentOffset, cons
 #define strtok_r strtok_s
 #endif
 
+// for peak memory use in bench
+#if KRAM_WIN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
 namespace kram {
 
 using namespace NAMESPACE_STL;
@@ -609,6 +619,8 @@ bool isIccProfileSrgb(const uint8_t* data, uint32_t dataSize) {
 
 bool LoadPng(const uint8_t* data, size_t dataSize, bool isPremulRgb, bool isGray, bool& isSrgb, Image& sourceImage)
 {
+    TraceScope traceScope("decodePng");
+
     uint32_t width = 0;
     uint32_t height = 0;
     uint32_t errorLode = 0;
@@ -874,6 +886,197 @@ bool SavePNG(Image& image, const char* filename)
     return true;
 }
 
+// write a chunk with length, type, data, and crc over type + data
+static void appendPNGChunk(vector<uint8_t>& dst, const char* type, const uint8_t* chunkData, uint32_t chunkLength)
+{
+    size_t start = dst.size();
+    dst.resize(start + 12 + chunkLength);
+
+    uint8_t* chunk = dst.data() + start;
+
+    // length is big-endian
+    chunk[0] = (uint8_t)(chunkLength >> 24);
+    chunk[1] = (uint8_t)(chunkLength >> 16);
+    chunk[2] = (uint8_t)(chunkLength >> 8);
+    chunk[3] = (uint8_t)(chunkLength);
+
+    memcpy(chunk + 4, type, 4);
+    if (chunkLength > 0) {
+        memcpy(chunk + 8, chunkData, chunkLength);
+    }
+
+    lodepng_chunk_generate_crc(chunk);
+}
+
+// This is a chunk-level version of SavePNG that doesn't decode/encode the pixels.
+// IDAT and all other chunks are copied byte-for-byte, and only the
+// iCCP/gAMA/cHRM/sRGB/bKGD chunks are stripped and replaced.  Returns false if the
+// png can't be rewritten this way, and caller should fallback to SavePNG.
+bool FixupPNGChunks(const uint8_t* data, size_t dataSize, bool isSrgb,
+                    vector<uint8_t>& dstData, bool& isUnchanged)
+{
+    isUnchanged = false;
+    dstData.clear();
+
+    if (!isPNGFile(data, dataSize)) {
+        return false;
+    }
+
+    const uint8_t* end = data + dataSize;
+    const uint8_t* chunk = data + 8;
+
+    // IHDR must be the first chunk
+    if (chunk + 12 + 13 > end || !lodepng_chunk_type_equals(chunk, "IHDR")) {
+        return false;
+    }
+
+    const uint8_t* header = lodepng_chunk_data_const(chunk);
+    uint8_t colorType = header[9];
+
+    bool hasNonSrgbBlocks = false;
+    bool hasSrgbBlock = false;
+    bool hasBlackBackground = false;
+
+    const uint8_t* palette = nullptr;
+    uint32_t paletteLength = 0;
+
+    // first pass to see what blocks are present, and if output would match input
+    for (const uint8_t* it = chunk; it + 12 <= end; it = lodepng_chunk_next_const(it, end)) {
+        uint32_t chunkLength = lodepng_chunk_length(it);
+        if (chunkLength > (size_t)(end - it) - 12) {
+            return false;  // corrupt
+        }
+
+        // only looking at blocks before the pixels
+        if (lodepng_chunk_type_equals(it, "IDAT")) {
+            break;
+        }
+
+        const uint8_t* chunkData = lodepng_chunk_data_const(it);
+
+        if (lodepng_chunk_type_equals(it, "iCCP") ||
+            lodepng_chunk_type_equals(it, "gAMA") ||
+            lodepng_chunk_type_equals(it, "cHRM")) {
+            hasNonSrgbBlocks = true;
+        }
+        else if (lodepng_chunk_type_equals(it, "sRGB")) {
+            hasSrgbBlock = true;
+        }
+        else if (lodepng_chunk_type_equals(it, "PLTE")) {
+            palette = chunkData;
+            paletteLength = chunkLength;
+        }
+        else if (lodepng_chunk_type_equals(it, "bKGD")) {
+            // palette is stored before the bKGD block
+            if (colorType == LCT_PALETTE) {
+                uint32_t index = (chunkLength >= 1) ? 3 * chunkData[0] : paletteLength;
+                hasBlackBackground = index + 3 <= paletteLength &&
+                                     palette[index] == 0 &&
+                                     palette[index + 1] == 0 &&
+                                     palette[index + 2] == 0;
+            }
+            else {
+                hasBlackBackground = true;
+                for (uint32_t i = 0; i < chunkLength; ++i) {
+                    if (chunkData[i] != 0) {
+                        hasBlackBackground = false;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    // Skip file if it has srgb block, and none of the other block types.
+    // This mirrors the test in SavePNG.
+    if (hasBlackBackground && isSrgb == hasSrgbBlock && !hasNonSrgbBlocks) {
+        isUnchanged = true;
+        return true;
+    }
+
+    // background is in same color depth as pixels, but 0 works for all bit-depths
+    uint8_t background[6] = {};
+    uint32_t backgroundLength = 0;
+
+    switch (colorType) {
+        case LCT_GREY:
+        case LCT_GREY_ALPHA:
+            backgroundLength = 2;
+            break;
+        case LCT_RGB:
+        case LCT_RGBA:
+            backgroundLength = 6;
+            break;
+        case LCT_PALETTE: {
+            // need a black entry in the palette to reference
+            bool hasBlackEntry = false;
+            for (uint32_t i = 0; i + 3 <= paletteLength; i += 3) {
+                if (palette[i] == 0 && palette[i + 1] == 0 && palette[i + 2] == 0) {
+                    background[0] = (uint8_t)(i / 3);
+                    hasBlackEntry = true;
+                    break;
+                }
+            }
+            if (!hasBlackEntry) {
+                return false;
+            }
+            backgroundLength = 1;
+            break;
+        }
+        default:
+            return false;
+    }
+
+    dstData.reserve(dataSize + 64);
+    dstData.insert(dstData.end(), data, data + 8);
+
+    bool isBeforeIDAT = true;
+
+    for (const uint8_t* it = chunk; it + 12 <= end; it = lodepng_chunk_next_const(it, end)) {
+        uint32_t chunkLength = lodepng_chunk_length(it);
+        if (chunkLength > (size_t)(end - it) - 12) {
+            return false;  // corrupt
+        }
+
+        if (lodepng_chunk_type_equals(it, "iCCP") ||
+            lodepng_chunk_type_equals(it, "gAMA") ||
+            lodepng_chunk_type_equals(it, "cHRM") ||
+            lodepng_chunk_type_equals(it, "sRGB") ||
+            lodepng_chunk_type_equals(it, "bKGD")) {
+            // strip these, they're replaced below
+            continue;
+        }
+
+        // bKGD must follow PLTE, and precede the first IDAT
+        if (isBeforeIDAT && lodepng_chunk_type_equals(it, "IDAT")) {
+            isBeforeIDAT = false;
+
+            // always redefine background to black, so Finder thumbnails are not white
+            appendPNGChunk(dstData, "bKGD", background, backgroundLength);
+        }
+
+        // copy the chunk and crc as is
+        dstData.insert(dstData.end(), it, it + 12 + chunkLength);
+
+        // sRGB must precede PLTE and IDAT, so place right after IHDR
+        if (isSrgb && it == chunk) {
+            uint8_t renderingIntent = 0;
+            appendPNGChunk(dstData, "sRGB", &renderingIntent, 1);
+        }
+
+        if (lodepng_chunk_type_equals(it, "IEND")) {
+            break;
+        }
+    }
+
+    // no pixels found
+    if (isBeforeIDAT) {
+        return false;
+    }
+
+    return true;
+}
+
 bool SetupTmpFile(FileHelper& tmpFileHelper, const char* suffix)
 {
     return tmpFileHelper.openTemporaryFile(suffix, "w+b");
@@ -882,6 +1085,8 @@ bool SetupTmpFile(FileHelper& tmpFileHelper, const char* suffix)
 bool SetupSourceImage(const string& srcFilename, Image& sourceImage,
                       bool isPremulSrgb = false, bool isGray = false)
 {
+    TraceScope traceScope("loadSource", srcFilename.c_str());
+
     bool isKTX = isKTXFilename(srcFilename);
     bool isKTX2 = isKTX2Filename(srcFilename);
     bool isPNG = isPNGFilename(srcFilename);
@@ -1117,6 +1322,13 @@ static const char* formatFormat(MyMTLPixelFormat format)
             fmt = " -format rgba32f";
             break;
 
+        case MyMTLPixelFormatRG11B10Float:
+            fmt = " -format rg11b10f";
+            break;
+        case MyMTLPixelFormatRGB9E5Float:
+            fmt = " -format rgb9e5";
+            break;
+
         default:
             assert(false);  // unknown format
             break;
@@ -1601,20 +1813,93 @@ void kramFixupUsage(bool showVersion = true)
     KLOGI("Kram",
           "%s\n"
           "Usage: kram fixup\n"
-          "\t -i/nput <.png>\n"
+          "\t -i/nput <.png | dir>\n"
           "\t -srgb\n"
+          "\t [-j/obs numJobs]\n"
+          "\n",
+          showVersion ? usageName : "");
+}
+
+
+void kramTileUsage(bool showVersion = true)
+{
+    KLOGI("Kram",
+          "%s\n"
+          "Usage: kram tile\n"
+          "\t -f/ormat (bc1 | bc7 | astc4x4 | etc2rgba ..) [-quality 0-100]\n"
+          "\t [-srgb] [-e/ncoder (bcenc | astcenc | ..)]\n"
+          "\t -i/nput <source.png | .ktx | .ktx2>\n"
+          "\t -o/utput <target.ktiles>\n"
+          "\t [-pagesize 64]\tpage size in KB, each tile fills one page\n"
+          "\t [-border 4]\ttexels copied from neighbors on each side of a tile\n"
+          "\t [-j/obs numJobs]\n"
+          "\t [-v/erbose]\n"
+          "\n",
+          showVersion ? usageName : "");
+}
+
+void kramAtlasUsage(bool showVersion = true)
+{
+    KLOGI("Kram",
+          "%s\n"
+          "Usage: kram atlas\n"
+          "\t -f/ormat (bc1 | bc7 | astc4x4 | etc2rgba ..) [-quality 0-100]\n"
+          "\t [-srgb] [-e/ncoder (bcenc | astcenc | ..)]\n"
+          "\t -i/nput <dir | .png> (repeat -i for more sprites)\n"
+          "\t -o/utput <target.ktx | .ktx2>\twrites target-atlas.json table\n"
+          "\t [-type 2d|2darray]\t2darray spills to more slices\n"
+          "\t [-size 2048x2048]\n"
+          "\t [-pad 2]\ttexels extruded around each sprite\n"
+          "\t [-mipnone]\n"
+          "\t [-j/obs numJobs]\n"
+          "\t [-v/erbose]\n"
+          "\n",
+          showVersion ? usageName : "");
+}
+
+void kramMergeUsage(bool showVersion = true)
+{
+    KLOGI("Kram",
+          "%s\n"
+          "Usage: kram merge\n"
+          "\t -f/ormat (bc1 | bc7 | astc4x4 | etc2rgba ..) [-quality 0-100]\n"
+          "\t [-srgb] [-e/ncoder (bcenc | astcenc | ..)]\n"
+          "\t -r <source.png:r | 0 | 1> [-g ..] [-b ..] [-a ..]\tchannel selectors\n"
+          "\t -o/utput <target.ktx | .ktx2>\n"
+          "\t [-mipnone]\n"
+          "\t [-j/obs numJobs]\n"
+          "\t [-v/erbose]\n"
           "\n",
           showVersion ? usageName : "");
 }
 
+void kramBenchUsage(bool showVersion = true)
+{
+    KLOGI("Kram",
+          "%s\n"
+          "Usage: kram bench\n"
+          "\t [-i/nput <source.png | folder>]\tdefaults to no sources\n"
+          "\t [-synthetic 2048,4096]\tgenerated images of each size\n"
+          "\t [-f/ormats bc1,bc7,etc2rgba,astc4x4]\n"
+          "\t [-e/ncoders squish,bcenc,..]\tdefaults to all encoders of each format\n"
+          "\t [-quality 10,49,90]\n"
+          "\t [-threads 1,4]\n"
+          "\t [-reps 3]\ttimed encodes of each case, reports min and median\n"
+          "\t [-o/utput bench.json]\n"
+          "\t [-v/erbose]\n"
+          "\n",
+          showVersion ? usageName : "");
+}
 
 void kramInfoUsage(bool showVersion = true)
 {
     KLOGI("Kram",
           "%s\n"
           "Usage: kram info\n"
-          "\t -i/nput <.png | .ktx | .ktx2 | .dds>\n"
+          "\t -i/nput <.png | .ktx | .ktx2 | .dds> or -r/ecursive <dir>\n"
           "\t [-o/utput info.txt]\n"
+          "\t [-j/obs numJobs]\n"
+          "\t [-json]\tone json record per line\n"
           "\t [-v/erbose]\n"
           "\n",
           showVersion ? usageName : "");
@@ -1629,6 +1914,7 @@ void kramScriptUsage(bool showVersion = true)
           "\t [-v/erbose]\n"
           "\t [-j/obs numJobs]\n"
           "\t [-c/ontinue]\tcontinue on errors\n"
+          "\t [-maxmem 16G]\tonly start commands whose estimated memory fits, K/M/G suffix\n"
           "\n",
           showVersion ? usageName : "");
 }
@@ -1661,7 +1947,7 @@ void kramEncodeUsage(bool showVersion = true)
     KLOGI("Kram",
           "%s\n"
           "Usage: kram encode\n"
-          "\t -f/ormat (bc1 | astc4x4 | etc2rgba | rgba16f) [-quality 0-100]\n"
+          "\t -f/ormat (bc1 | astc4x4 | etc2rgba | rgba16f) [-quality 0-100] [-threads count]\n"
           "\t [-zstd 0] or [-zlib 0] (for .ktx2 output)\n"
           "\t [-srgb] [-srcsrgb] [-srclin] [-srcsrgbflag]\n"
           "\t [-signed] [-normal]\n"
@@ -1683,6 +1969,9 @@ void kramEncodeUsage(bool showVersion = true)
           "\t [-premul] [-prezero] [-premulrgb]\n"
           "\t [-gray]\n"
           "\t [-optopaque]\n"
+          "\t [-etcmultipass]\n"
+          "\t [-metrics]\n"
+          "\t [-targetpsnr 40] [-candidates astc4x4,astc6x6,astc8x8]\n"
           "\t [-v]\n"
           "\n"
           "\t [-testall]\n"
@@ -1697,8 +1986,12 @@ void kramEncodeUsage(bool showVersion = true)
 
           "\t-format [r|rg|rgba| 8|16f|32f]"
           "\tExplicit format to build mips and for hdr.\n"
-          "\t-format bc[1,3,4,5,7]"
-          "\tBC compression\n"
+          "\t-format [rg11b10f|rgb9e5]"
+          "\tPacked 32-bit hdr, rgb only and clamps negative values to 0\n"
+          "\t-format bc[1,3,4,5,6,7]"
+          "\tBC compression, bc6 encodes hdr from the float source\n"
+          "\t-threads count"
+          "\tThreads used to encode the blocks of each mip (bc6, squish, and etcenc multipass)\n"
           "\t-format etc2[r|rg|rgb|rgba]"
           "\tETC2 compression - r11sn, rg11sn, rgba, rgba\n"
           "\t-format astc[4x4|5x5|6x6|8x8]"
@@ -1723,9 +2016,11 @@ void kramEncodeUsage(bool showVersion = true)
 
           "\t-encoder etcenc"
           "\tetc2[r,rg,rgb,rgba] %s\n"  // can be disabled
+          "\t-etcmultipass"
+          "\tetcenc encodes all blocks, then refines the blocks with the largest errors\n"
 
           "\t-encoder explicit"
-          "\tr|rg|rgba[8|16f|32f]\n"
+          "\tr|rg|rgba[8|16f|32f], rg11b10f, rgb9e5\n"
           "\n"
 
           // Mips
@@ -1813,6 +2108,12 @@ void kramEncodeUsage(bool showVersion = true)
           "\t-avg [rgba]"
           "\tPost-swizzle, average channels per block (f.e. normals) lrgb astc/bc3/etc2rgba\n"
 
+          "\t-metrics"
+          "\tDecode each mip and write psnr/ssim/mse per channel to output.metrics.json\n"
+          "\t-targetpsnr 40"
+          "\tPick the smallest candidate format whose psnr meets the target on sampled tiles\n"
+          "\t-candidates astc4x4,astc6x6,astc8x8"
+          "\tFormats to search with -targetpsnr, defaults to the family of -format\n"
           "\t-v"
           "\tVerbose encoding output\n"
           "\n",
@@ -1831,13 +2132,19 @@ void kramUsage()
     KLOGI("Kram",
           usageName
           "\n"
-          "SYNTAX\nkram [encode | decode | info | script | fixup | ...]\n");
+          "SYNTAX\nkram [-trace trace.json] [-logjson log.jsonl] [encode | decode | info | script | fixup | tile | atlas | merge | bench | ...]\n"
+          "\t-trace trace.json\tRecord where the command spends time on each thread, view in ui.perfetto.dev or chrome://tracing\n"
+          "\t-logjson log.jsonl\tAlso write each log message as a line of json with time, thread, command, and file\n");
 
     kramEncodeUsage(false);
     kramInfoUsage(false);
     kramDecodeUsage(false);
     kramScriptUsage(false);
     kramFixupUsage(false);
+    kramTileUsage(false);
+    kramAtlasUsage(false);
+    kramMergeUsage(false);
+    kramBenchUsage(false);
 }
 
 static int32_t kramAppInfo(vector<const char*>& args)
@@ -1850,9 +2157,12 @@ static int32_t kramAppInfo(vector<const char*>& args)
     }
 
     string srcFilename;
+    string srcFolder;
     string dstFilename;
 
     bool isVerbose = false;
+    bool isJson = false;
+    int32_t numJobs = 1;
 
     bool error = false;
     for (int32_t i = 0; i < argc; ++i) {
@@ -1886,10 +2196,35 @@ static int32_t kramAppInfo(vector<const char*>& args)
 
             srcFilename = args[i];
         }
+        else if (isStringEqual(word, "-r") ||
+                 isStringEqual(word, "-recursive")) {
+            ++i;
+            if (i >= argc) {
+                error = true;
+                KLOGE("Kram", "no input folder defined");
+                break;
+            }
+
+            srcFolder = args[i];
+        }
+        else if (isStringEqual(word, "-jobs") ||
+                 isStringEqual(word, "-j")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "no job count defined");
+                error = true;
+                break;
+            }
+
+            numJobs = atoi(args[i]);
+        }
         else if (isStringEqual(word, "-v") ||
                  isStringEqual(word, "-verbose")) {
             isVerbose = true;
         }
+        else if (isStringEqual(word, "-json")) {
+            isJson = true;
+        }
         else {
             KLOGE("Kram", "unexpected argument \"%s\"\n",
                   word);
@@ -1898,19 +2233,44 @@ static int32_t kramAppInfo(vector<const char*>& args)
         }
     }
 
-    if (srcFilename.empty()) {
+    vector<string> srcFilenames;
+
+    if (!srcFolder.empty()) {
+        if (!srcFilename.empty()) {
+            KLOGE("Kram", "info takes either input file or folder");
+            error = true;
+        }
+
+        vector<string> files;
+        if (!error && !FileHelper::listFilesInFolder(srcFolder.c_str(), files)) {
+            KLOGE("Kram", "info couldn't list folder %s", srcFolder.c_str());
+            error = true;
+        }
+
+        // skip anything that isn't a texture
+        for (const auto& file : files) {
+            if (isPNGFilename(file) || isKTXFilename(file) ||
+                isKTX2Filename(file) || isDDSFilename(file)) {
+                srcFilenames.push_back(file);
+            }
+        }
+    }
+    else if (srcFilename.empty()) {
         KLOGE("Kram", "no input file supplied");
         error = true;
     }
+    else {
+        bool isPNG = isPNGFilename(srcFilename);
+        bool isKTX = isKTXFilename(srcFilename);
+        bool isKTX2 = isKTX2Filename(srcFilename);
+        bool isDDS = isDDSFilename(srcFilename);
 
-    bool isPNG = isPNGFilename(srcFilename);
-    bool isKTX = isKTXFilename(srcFilename);
-    bool isKTX2 = isKTX2Filename(srcFilename);
-    bool isDDS = isDDSFilename(srcFilename);
+        if (!(isPNG || isKTX || isKTX2 || isDDS)) {
+            KLOGE("Kram", "info only supports png, ktx, ktx2, dds inputs");
+            error = true;
+        }
 
-    if (!(isPNG || isKTX || isKTX2 || isDDS)) {
-        KLOGE("Kram", "info only supports png, ktx, ktx2, dds inputs");
-        error = true;
+        srcFilenames.push_back(srcFilename);
     }
 
     if (error) {
@@ -1918,9 +2278,23 @@ static int32_t kramAppInfo(vector<const char*>& args)
         return -1;
     }
 
-    string info = kramInfoToString(srcFilename, isVerbose);
-    if (info.empty()) {
-        return -1;
+    // each file only reads headers, so this is mostly waiting on io
+    vector<string> infos;
+    infos.resize(srcFilenames.size());
+
+    if (numJobs <= 1 || srcFilenames.size() <= 1) {
+        for (uint32_t i = 0; i < srcFilenames.size(); ++i) {
+            infos[i] = kramInfoToString(srcFilenames[i], isVerbose, isJson);
+        }
+    }
+    else {
+        task_system system(numJobs);
+
+        for (uint32_t i = 0; i < srcFilenames.size(); ++i) {
+            system.async_([&, i]() {
+                infos[i] = kramInfoToString(srcFilenames[i], isVerbose, isJson);
+            });
+        }
     }
 
     // now write the string to output (always appends for scripting purposes, so caller must wipe output file)
@@ -1936,13 +2310,33 @@ static int32_t kramAppInfo(vector<const char*>& args)
         fp = dstFileHelper.pointer();
     }
 
-    fprintf(fp, "%s", info.c_str());
+    // output in file order, so results can be diffed across runs
+    int32_t errorCounter = 0;
+    for (const auto& info : infos) {
+        if (info.empty()) {
+            errorCounter++;
+            continue;
+        }
+
+        // blank line between text records, json is one record per line
+        if (!isJson && srcFilenames.size() > 1) {
+            fprintf(fp, "%s\n", info.c_str());
+        }
+        else {
+            fprintf(fp, "%s", info.c_str());
+        }
+    }
+
+    if (errorCounter > 0) {
+        KLOGE("Kram", "info %d/%d files failed", errorCounter, (int32_t)srcFilenames.size());
+        return -1;
+    }
 
     return 0;
 }
 
 // this is the main chunk of info generation, can be called without writing result to stdio
-string kramInfoToString(const string& srcFilename, bool isVerbose)
+string kramInfoToString(const string& srcFilename, bool isVerbose, bool isJson)
 {
     bool isPNG = isPNGFilename(srcFilename);
     bool isKTX = isKTXFilename(srcFilename);
@@ -1997,13 +2391,14 @@ string kramInfoToString(const string& srcFilename, bool isVerbose)
             dataSize = srcFileBuffer.size();
         }
 
-        info = kramInfoPNGToString(srcFilename, data, dataSize, isVerbose);
+        info = kramInfoPNGToString(srcFilename, data, dataSize, isVerbose, isJson);
     }
     else if (isKTX || isKTX2 || isDDS) {
         KTXImage srcImage;
         KTXImageData srcImageData;
 
-        // TODO: pass isInfoOnly = true to this
+        // isInfoOnly skips decompressing ktx2 levels, and only the header
+        // and level index pages of the mmap are touched
         bool success = SetupSourceKTX(srcImageData, srcFilename, srcImage, true);
         if (!success) {
             KLOGE("Kram", "File input \"%s\" could not be opened for info read.\n",
@@ -2011,13 +2406,13 @@ string kramInfoToString(const string& srcFilename, bool isVerbose)
             return "";
         }
 
-        info = kramInfoKTXToString(srcFilename, srcImage, isVerbose);
+        info = kramInfoKTXToString(srcFilename, srcImage, isVerbose, isJson);
     }
 
     return info;
 }
 
-string kramInfoPNGToString(const string& srcFilename, const uint8_t* data, uint64_t dataSize, bool /* isVerbose */)
+string kramInfoPNGToString(const string& srcFilename, const uint8_t* data, uint64_t dataSize, bool /* isVerbose */, bool isJson)
 {
     // vector<uint8_t> pixels;
     uint32_t width = 0;
@@ -2147,6 +2542,47 @@ string kramInfoPNGToString(const string& srcFilename, const uint8_t* data, uint6
             break;
     }
 
+    // optional block with ppi
+    bool hasPPI = false;
+    const float metersToInches = 39.37;
+    chunkData = lodepng_chunk_find_const(data, end, "pHYs");
+    if (chunkData) {
+        lodepng_inspect_chunk(&state, chunkData - data, data, end-data);
+    
+        // TODO: there is info_pgn.phys_unit (0 - unknown, 1 - meters)
+        hasPPI = state.info_png.phys_defined && state.info_png.phys_unit == 1;
+    }
+    
+    if (isJson) {
+        info += "{\"file\":";
+        appendJsonString(info, srcFilename.c_str());
+        append_sprintf(info,
+                       ",\"size\":%" PRIu64
+                       ",\"type\":\"%s\""
+                       ",\"width\":%u,\"height\":%u"
+                       ",\"bitdepth\":%u"
+                       ",\"color\":%s,\"alpha\":%s,\"palette\":%s"
+                       ",\"srgb\":%s,\"bkgd\":%s",
+                       dataSize,
+                       textureTypeName(MyMTLTextureType2D),
+                       width, height,
+                       state.info_png.color.bitdepth,
+                       hasColor ? "true" : "false",
+                       hasAlpha ? "true" : "false",
+                       hasPalette ? "true" : "false",
+                       isSrgb ? "true" : "false",
+                       hasBackground ? "true" : "false");
+        
+        if (hasPPI) {
+            append_sprintf(info,
+                           ",\"ppix\":%d,\"ppiy\":%d",
+                           (int32_t)(state.info_png.phys_x / metersToInches),
+                           (int32_t)(state.info_png.phys_y / metersToInches));
+        }
+        info += "}\n";
+        return info;
+    }
+
     string tmp;
     bool isMB = (dataSize > (512 * 1024));
     sprintf(tmp,
@@ -2182,28 +2618,85 @@ string kramInfoPNGToString(const string& srcFilename, const uint8_t* data, uint6
             );
     info += tmp;
 
-    // optional block with ppi
-    chunkData = lodepng_chunk_find_const(data, end, "pHYs");
-    if (chunkData) {
-        lodepng_inspect_chunk(&state, chunkData - data, data, end-data);
-    
-        if (state.info_png.phys_defined && state.info_png.phys_unit == 1) {
-            float metersToInches = 39.37;
-            // TODO: there is info_pgn.phys_unit (0 - unknown, 1 - meters)
-            sprintf(tmp,
-                    "ppix: %d\n"
-                    "ppiy: %d\n",
-                    (int32_t)(state.info_png.phys_x / metersToInches),
-                    (int32_t)(state.info_png.phys_y / metersToInches));
-            info += tmp;
+    if (hasPPI) {
+        sprintf(tmp,
+                "ppix: %d\n"
+                "ppiy: %d\n",
+                (int32_t)(state.info_png.phys_x / metersToInches),
+                (int32_t)(state.info_png.phys_y / metersToInches));
+        info += tmp;
+    }
+
+    return info;
+}
+
+// one record per file with all levels, for dashboards that scan many files
+static string kramInfoKTXToJson(const string& srcFilename, const KTXImage& srcImage)
+{
+    string info;
+
+    MyMTLPixelFormat metalFormat = srcImage.pixelFormat;
+    int32_t numChunks = srcImage.totalChunks();
+
+    info += "{\"file\":";
+    appendJsonString(info, srcFilename.c_str());
+    append_sprintf(info,
+                   ",\"size\":%" PRIu64
+                   ",\"type\":\"%s\""
+                   ",\"width\":%u,\"height\":%u,\"depth\":%u"
+                   ",\"mips\":%u,\"arry\":%u,\"chunks\":%d"
+                   ",\"format\":\"%s\",\"vkformat\":%d"
+                   ",\"comp\":\"%s\"",
+                   (uint64_t)srcImage.fileDataLength,
+                   textureTypeName(srcImage.textureType),
+                   srcImage.width, srcImage.height, srcImage.depth,
+                   srcImage.mipCount(), max(1u, srcImage.header.numberOfArrayElements), numChunks,
+                   formatTypeName(metalFormat), vulkanType(metalFormat),
+                   supercompressionName(srcImage.supercompressionType));
+
+    if (!srcImage.props.empty()) {
+        info += ",\"props\":{";
+        bool isFirst = true;
+        for (const auto& prop : srcImage.props) {
+            if (!isFirst) {
+                info += ',';
+            }
+            isFirst = false;
+
+            appendJsonString(info, prop.first.c_str());
+            info += ':';
+            appendJsonString(info, prop.second.c_str());
         }
+        info += '}';
+    }
+
+    info += ",\"levels\":[";
+    for (uint32_t mipLevel = 0; mipLevel < srcImage.mipLevels.size(); ++mipLevel) {
+        const auto& mip = srcImage.mipLevels[mipLevel];
+
+        uint32_t w, h, d;
+        srcImage.mipDimensions(mipLevel, w, h, d);
+
+        append_sprintf(info,
+                       "%s{\"w\":%u,\"h\":%u,\"d\":%u"
+                       ",\"offset\":%" PRIu64 ",\"length\":%" PRIu64 ",\"lengthCompressed\":%" PRIu64 "}",
+                       mipLevel > 0 ? "," : "",
+                       w, h, d,
+                       mip.offset,
+                       mip.length * numChunks,
+                       mip.lengthCompressed);
     }
+    info += "]}\n";
 
     return info;
 }
 
-string kramInfoKTXToString(const string& srcFilename, const KTXImage& srcImage, bool isVerbose)
+string kramInfoKTXToString(const string& srcFilename, const KTXImage& srcImage, bool isVerbose, bool isJson)
 {
+    if (isJson) {
+        return kramInfoKTXToJson(srcFilename, srcImage);
+    }
+
     string info;
 
     // for now driving everything off metal type, but should switch to neutral
@@ -2546,33 +3039,116 @@ static int32_t kramAppDecode(vector<const char*>& args)
     return success ? 0 : -1;
 }
 
-int32_t kramAppFixup(vector<const char*>& args)
+// rewrite the srgb blocks of a single png in place
+static bool fixupPNGSrgb(const string& srcFilename)
 {
-    // this is help
-    int32_t argc = (int32_t)args.size();
-    if (argc == 0) {
-        kramFixupUsage();
-        return 0;
-    }
+    // stuff srgb block based on filename to content conversion for now
+    TexContentType contentType = findContentTypeFromFilename(srcFilename.c_str());
+    bool isSrgb = contentType == TexContentTypeAlbedo;
 
-    string srcFilename;
-    bool doFixupSrgb = false;
-    bool error = false;
-    
-    for (int32_t i = 0; i < argc; ++i) {
-        // check for options
-        const char* word = args[i];
-        if (word[0] != '-') {
-            KLOGE("Kram", "unexpected argument \"%s\"\n",
-                  word);
-            error = true;
-            break;
-        }
-        
-        // TDOO: may want to add output command too
-        
-        if (isStringEqual(word, "-srgb")) {
-            doFixupSrgb = true;
+    MmapHelper mmapHelper;
+    vector<uint8_t> fileData;
+
+    // first try mmap, and then use file -> buffer
+    bool isMmap = true;
+    if (!mmapHelper.open(srcFilename.c_str())) {
+        isMmap = false;
+
+        FileHelper fileHelper;
+        if (!fileHelper.open(srcFilename.c_str(), "rb")) {
+            KLOGE("Kram", "File input \"%s\" could not be opened for read.\n",
+                  srcFilename.c_str());
+            return false;
+        }
+
+        size_t size = fileHelper.size();
+        if (size == (size_t)-1) {
+            return false;
+        }
+
+        fileData.resize(size);
+        if (!fileHelper.read(fileData.data(), size)) {
+            return false;
+        }
+    }
+
+    const uint8_t* data = isMmap ? mmapHelper.data() : fileData.data();
+    size_t dataSize = isMmap ? mmapHelper.dataLength() : fileData.size();
+
+    vector<uint8_t> dstData;
+    bool isUnchanged = false;
+    if (!FixupPNGChunks(data, dataSize, isSrgb, dstData, isUnchanged)) {
+        // fallback to the full decode and encode of the pixels
+        mmapHelper.close();
+        releaseVector(fileData);
+
+        Image srcImage;
+        if (!SetupSourceImage(srcFilename, srcImage)) {
+            return false;
+        }
+
+        if (!SavePNG(srcImage, srcFilename.c_str())) {
+            KLOGE("Kram", "fixup srgb could not save to file");
+            return false;
+        }
+        return true;
+    }
+
+    if (isUnchanged) {
+        KLOGI("Kram", "skipping srgb correction %s", srcFilename.c_str());
+        return true;
+    }
+
+    // write to tmp, and then copy over the original, so a failure
+    // doesn't destroy the source png
+    FileHelper tmpFileHelper;
+    if (!SetupTmpFile(tmpFileHelper, ".png") ||
+        !tmpFileHelper.write(dstData.data(), dstData.size())) {
+        KLOGE("Kram", "fixup srgb could not write tmp file");
+        return false;
+    }
+
+    // can't overwrite the file while it's still mapped
+    mmapHelper.close();
+
+    if (!tmpFileHelper.copyTemporaryFileTo(srcFilename.c_str())) {
+        KLOGE("Kram", "fixup srgb could not save to file");
+        return false;
+    }
+
+    KLOGI("Kram", "saved %s %s sRGB block", srcFilename.c_str(), isSrgb ? "with" : "without");
+
+    return true;
+}
+
+int32_t kramAppFixup(vector<const char*>& args)
+{
+    // this is help
+    int32_t argc = (int32_t)args.size();
+    if (argc == 0) {
+        kramFixupUsage();
+        return 0;
+    }
+
+    string srcFilename;
+    bool doFixupSrgb = false;
+    bool error = false;
+    int32_t numJobs = 1;
+    
+    for (int32_t i = 0; i < argc; ++i) {
+        // check for options
+        const char* word = args[i];
+        if (word[0] != '-') {
+            KLOGE("Kram", "unexpected argument \"%s\"\n",
+                  word);
+            error = true;
+            break;
+        }
+        
+        // TDOO: may want to add output command too
+        
+        if (isStringEqual(word, "-srgb")) {
+            doFixupSrgb = true;
         }
         else if (isStringEqual(word, "-input") ||
                  isStringEqual(word, "-i")) {
@@ -2585,6 +3161,17 @@ int32_t kramAppFixup(vector<const char*>& args)
 
             srcFilename = args[i];
         }
+        else if (isStringEqual(word, "-jobs") ||
+                 isStringEqual(word, "-j")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "no job count defined");
+                error = true;
+                break;
+            }
+
+            numJobs = atoi(args[i]);
+        }
         else {
             KLOGE("Kram", "unexpected argument \"%s\"\n",
                   word);
@@ -2599,37 +3186,362 @@ int32_t kramAppFixup(vector<const char*>& args)
     }
         
     if (doFixupSrgb) {
-        bool isPNG = isPNGFilename(srcFilename);
+        // batch mode walks all png in the folder and subfolders
+        vector<string> srcFilenames;
 
-        if (!isPNG) {
-            KLOGE("Kram", "fixup srgb only supports png input");
-            error = true;
+        FileHelper fileHelper;
+        if (!error && fileHelper.isDirectory(srcFilename.c_str())) {
+            vector<string> files;
+            if (!FileHelper::listFilesInFolder(srcFilename.c_str(), files)) {
+                KLOGE("Kram", "fixup srgb couldn't list folder %s", srcFilename.c_str());
+                error = true;
+            }
+
+            for (const auto& file : files) {
+                if (isPNGFilename(file)) {
+                    srcFilenames.push_back(file);
+                }
+            }
         }
-        
-        bool success = !error;
-        
-        Image srcImage;
-        
-        // load the png, this doesn't return srgb state of original png
-        if (success)
-            success = SetupSourceImage(srcFilename, srcImage);
+        else {
+            bool isPNG = isPNGFilename(srcFilename);
 
-        // stuff srgb block based on filename to content conversion for now
-        if (success) {
-            success = SavePNG(srcImage, srcFilename.c_str());
-            
-            if (!success) {
-                KLOGE("Kram", "fixup srgb could not save to file");
+            if (!isPNG) {
+                KLOGE("Kram", "fixup srgb only supports png input");
+                error = true;
+            }
+
+            srcFilenames.push_back(srcFilename);
+        }
+
+        if (!error) {
+            std::atomic<int32_t> errorCounter(0);
+
+            if (numJobs <= 1 || srcFilenames.size() <= 1) {
+                for (const auto& filename : srcFilenames) {
+                    if (!fixupPNGSrgb(filename)) {
+                        errorCounter++;
+                    }
+                }
+            }
+            else {
+                // each file is independent, so spread them across the threads
+                task_system system(numJobs);
+
+                for (const auto& filename : srcFilenames) {
+                    system.async_([&errorCounter, filename]() {
+                        if (!fixupPNGSrgb(filename)) {
+                            errorCounter++;
+                        }
+                    });
+                }
+            }
+
+            if (errorCounter > 0) {
+                KLOGE("Kram", "fixup srgb %d/%d files failed",
+                      int32_t(errorCounter), (int32_t)srcFilenames.size());
+                error = true;
             }
         }
-        
-        if (!success)
-            error = true;
     }
     
     return error ? -1 : 0;
 }
 
+// write the per-mip error from -metrics as a json sidecar next to the output
+static bool writeMetricsJson(const string& dstFilename, const ImageInfo& info)
+{
+    string json;
+    json += "{\"file\":";
+    appendJsonString(json, dstFilename.c_str());
+    append_sprintf(json, ",\"format\":\"%s\",\"encoder\":\"%s\",\"quality\":%d,\"mips\":[",
+                   formatTypeName(info.pixelFormat),
+                   encoderName(info.textureEncoder),
+                   info.quality);
+
+    for (uint32_t i = 0; i < info.metrics.size(); ++i) {
+        const ImageMetrics& m = info.metrics[i];
+
+        append_sprintf(json, "%s\n{\"chunk\":%d,\"mip\":%d,\"width\":%d,\"height\":%d,"
+                             "\"mse\":[%0.4f,%0.4f,%0.4f,%0.4f],"
+                             "\"psnr\":[%0.3f,%0.3f,%0.3f,%0.3f],"
+                             "\"psnrAll\":%0.3f,\"ssim\":%0.5f",
+                       i ? "," : "",
+                       m.chunk, m.mipLevel, m.width, m.height,
+                       m.mse[0], m.mse[1], m.mse[2], m.mse[3],
+                       m.psnr[0], m.psnr[1], m.psnr[2], m.psnr[3],
+                       m.psnrAll, m.ssim);
+
+        if (info.isNormal) {
+            append_sprintf(json, ",\"normalAngleAvg\":%0.4f,\"normalAngleMax\":%0.4f",
+                           m.normalAngleAvg, m.normalAngleMax);
+        }
+        json += "}";
+    }
+    json += "\n]}\n";
+
+    string metricsFilename = dstFilename;
+    metricsFilename += ".metrics.json";
+
+    FileHelper fileHelper;
+    if (!fileHelper.open(metricsFilename.c_str(), "w")) {
+        KLOGE("Kram", "metrics couldn't open %s", metricsFilename.c_str());
+        return false;
+    }
+
+    if (!fileHelper.write((const uint8_t*)json.c_str(), json.size())) {
+        KLOGE("Kram", "metrics couldn't write %s", metricsFilename.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// Build a small mosaic of tiles spread across the source, so that candidate
+// formats can be scored without encoding the entire image.
+static void buildSampleImage(const Image& srcImage, Image& sampleImage)
+{
+    const int32_t tileDim = 32;
+    const int32_t maxTiles = 4;  // per axis
+
+    int32_t w = srcImage.width();
+    int32_t h = srcImage.height();
+    const vector<Color>& srcPixels = srcImage.pixels();
+
+    int32_t tilesX = std::min(maxTiles, std::max(1, w / tileDim));
+    int32_t tilesY = std::min(maxTiles, std::max(1, h / tileDim));
+    int32_t tileW = std::min(tileDim, w);
+    int32_t tileH = std::min(tileDim, h);
+
+    int32_t sampleW = tilesX * tileW;
+    int32_t sampleH = tilesY * tileH;
+
+    vector<Color> samplePixels;
+    samplePixels.resize(sampleW * sampleH);
+
+    for (int32_t ty = 0; ty < tilesY; ++ty) {
+        // spread tiles evenly from edge to edge
+        int32_t y0 = tilesY > 1 ? (ty * (h - tileH)) / (tilesY - 1) : 0;
+
+        for (int32_t tx = 0; tx < tilesX; ++tx) {
+            int32_t x0 = tilesX > 1 ? (tx * (w - tileW)) / (tilesX - 1) : 0;
+
+            for (int32_t y = 0; y < tileH; ++y) {
+                const Color* srcRow = &srcPixels[(y0 + y) * w + x0];
+                Color* dstRow = &samplePixels[(ty * tileH + y) * sampleW + tx * tileW];
+                memcpy(dstRow, srcRow, tileW * sizeof(Color));
+            }
+        }
+    }
+
+    sampleImage.loadImageFromPixels(samplePixels, sampleW, sampleH,
+                                    srcImage.hasColor(), srcImage.hasAlpha());
+    sampleImage.setSrgbState(srcImage.isSrgb(), srcImage.hasSrgbBlock(), srcImage.hasNonSrgbBlocks());
+}
+
+// Walk all of the source pixels a row at a time with the swizzle applied,
+// to see if the requested format needs alpha.  The sample tiles would miss
+// alpha that's only in a small part of the source.
+static bool hasAlphaAfterSwizzle(const Image& srcImage, const ImageInfoArgs& infoArgs)
+{
+    ImageInfo info;
+    info.initWithArgs(infoArgs);
+    if (!info.hasAlpha || !srcImage.hasAlpha()) {
+        return false;
+    }
+
+    int32_t w = srcImage.width();
+    int32_t h = srcImage.height();
+    const vector<Color>& srcPixels = srcImage.pixels();
+
+    vector<Color> rowPixels;
+    rowPixels.resize(w);
+
+    for (int32_t y = 0; y < h; ++y) {
+        memcpy(rowPixels.data(), &srcPixels[y * w], w * sizeof(Color));
+        if (!info.swizzleText.empty()) {
+            ImageInfo::swizzleTextureLDR(w, 1, rowPixels.data(), info.swizzleText.c_str());
+        }
+
+        for (const Color& c : rowPixels) {
+            if (c.a != 255) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// encode the sample image with a candidate format and return psnr of the top mip
+static bool encodeSampleForPSNR(const Image& sampleImage, const ImageInfoArgs& infoArgs,
+                                const char* formatString, int32_t quality, float& psnr)
+{
+    ImageInfoArgs trialArgs = infoArgs;
+    trialArgs.formatString = formatString;
+    trialArgs.pixelFormat = MyMTLPixelFormatInvalid;
+    trialArgs.textureEncoder = kTexEncoderUnknown;  // best encoder for each candidate
+    trialArgs.textureType = MyMTLTextureType2D;
+    trialArgs.chunksX = 0;
+    trialArgs.chunksY = 0;
+    trialArgs.chunksCount = 0;
+    trialArgs.doMipmaps = false;
+    trialArgs.isKTX2 = false;
+    trialArgs.isVerbose = false;
+    trialArgs.doMetrics = true;
+    trialArgs.quality = quality;
+
+    if (!validateFormatAndEncoder(trialArgs)) {
+        KLOGE("Kram", "targetpsnr candidate %s not supported\n", formatString);
+        return false;
+    }
+
+    // info setup swizzles the source in place, so work from a copy
+    Image trialImage = sampleImage;
+
+    ImageInfo trialInfo;
+    trialInfo.initWithArgs(trialArgs);
+    trialInfo.initWithSourceImage(trialImage);
+
+    KramEncoder encoder;
+    KTXImage dstImage;
+    if (!encoder.encode(trialInfo, trialImage, dstImage) || trialInfo.metrics.empty()) {
+        return false;
+    }
+
+    psnr = trialInfo.metrics[0].psnrAll;
+    return true;
+}
+
+static float bitsPerPixelOfFormat(MyMTLPixelFormat format)
+{
+    Int2 blockDims = blockDimsOfFormat(format);
+    return (8.0f * blockSizeOfFormat(format)) / (blockDims.x * blockDims.y);
+}
+
+// Walk candidate formats from smallest to largest, and pick the first one that
+// meets the psnr target.  A cheap low quality encode of sampled tiles accepts a
+// candidate early, otherwise the sample is encoded at the requested quality.
+// The full encode then only runs on the winner.
+static bool searchFormatForTargetPSNR(const Image& srcImage, ImageInfoArgs& infoArgs,
+                                      const string& candidatesText, float targetPSNR)
+{
+    // parse the candidates, or pick a family from the requested format
+    vector<string> candidates;
+    if (!candidatesText.empty()) {
+        string text = candidatesText;
+        char* rest = (char*)text.c_str();
+        const char* token;
+        while ((token = strtok_r(rest, ",", &rest))) {
+            candidates.push_back(token);
+        }
+    }
+    else if (isASTCFormat(infoArgs.pixelFormat)) {
+        candidates = {"astc8x8", "astc6x6", "astc5x5", "astc4x4"};
+    }
+    else if (isBCFormat(infoArgs.pixelFormat) && numChannelsOfFormat(infoArgs.pixelFormat) >= 3) {
+        candidates = {"bc1", "bc3", "bc7"};
+    }
+    else if (isETCFormat(infoArgs.pixelFormat) && numChannelsOfFormat(infoArgs.pixelFormat) >= 3) {
+        candidates = {"etc2rgb", "etc2rgba"};
+    }
+    else {
+        candidates = {infoArgs.formatString};
+    }
+
+    Image sampleImage;
+    buildSampleImage(srcImage, sampleImage);
+
+    // Psnr only covers the channels of each format, so a format without alpha
+    // would score well on a source with alpha, and then drop the alpha.
+    bool hasAlpha = hasAlphaAfterSwizzle(srcImage, infoArgs);
+
+    // order by memory size, stable so equal sizes keep the listed order
+    vector<pair<float, string>> orderedCandidates;
+    vector<pair<float, string>> noAlphaCandidates;
+    for (const auto& candidate : candidates) {
+        ImageInfoArgs trialArgs = infoArgs;
+        trialArgs.formatString = candidate;
+        trialArgs.pixelFormat = MyMTLPixelFormatInvalid;
+        trialArgs.textureEncoder = kTexEncoderUnknown;
+        if (!validateFormatAndEncoder(trialArgs) || !isBlockFormat(trialArgs.pixelFormat)) {
+            KLOGE("Kram", "targetpsnr candidate %s must be a supported block format\n", candidate.c_str());
+            return false;
+        }
+
+        auto orderedCandidate = make_pair(bitsPerPixelOfFormat(trialArgs.pixelFormat), candidate);
+        if (hasAlpha && !isAlphaFormat(trialArgs.pixelFormat)) {
+            noAlphaCandidates.push_back(orderedCandidate);
+        }
+        else {
+            orderedCandidates.push_back(orderedCandidate);
+        }
+    }
+
+    if (orderedCandidates.empty()) {
+        // only formats without alpha were listed, so honor that
+        orderedCandidates = noAlphaCandidates;
+    }
+    else if (infoArgs.isVerbose) {
+        for (const auto& candidate : noAlphaCandidates) {
+            KLOGI("Kram", "targetpsnr skipped %s, it drops the alpha of the source\n",
+                  candidate.second.c_str());
+        }
+    }
+
+    stable_sort(orderedCandidates.begin(), orderedCandidates.end(),
+                [](const pair<float, string>& lhs, const pair<float, string>& rhs) {
+                    return lhs.first < rhs.first;
+                });
+
+    const int32_t lowQuality = 10;
+
+    // if nothing meets the target, fall back to the largest candidate
+    string winner = orderedCandidates.back().second;
+
+    for (const auto& candidate : orderedCandidates) {
+        const char* formatString = candidate.second.c_str();
+
+        float psnr = 0.0f;
+        if (!encodeSampleForPSNR(sampleImage, infoArgs, formatString, lowQuality, psnr)) {
+            return false;
+        }
+
+        bool isMatch = psnr >= targetPSNR;
+
+        if (!isMatch && infoArgs.quality > lowQuality) {
+            if (!encodeSampleForPSNR(sampleImage, infoArgs, formatString, infoArgs.quality, psnr)) {
+                return false;
+            }
+            isMatch = psnr >= targetPSNR;
+        }
+
+        if (infoArgs.isVerbose) {
+            KLOGI("Kram", "targetpsnr %s %0.2fbpp psnr %0.2f\n",
+                  formatString, candidate.first, psnr);
+        }
+
+        if (isMatch) {
+            winner = candidate.second;
+            break;
+        }
+    }
+
+    if (winner != infoArgs.formatString) {
+        infoArgs.formatString = winner;
+        infoArgs.pixelFormat = MyMTLPixelFormatInvalid;
+        infoArgs.textureEncoder = kTexEncoderUnknown;
+        if (!validateFormatAndEncoder(infoArgs)) {
+            return false;
+        }
+    }
+
+    if (infoArgs.isVerbose) {
+        KLOGI("Kram", "targetpsnr %0.2f picked %s\n", targetPSNR, winner.c_str());
+    }
+
+    return true;
+}
+
 static int32_t kramAppEncode(vector<const char*>& args)
 {
     // this is help
@@ -2646,6 +3558,10 @@ static int32_t kramAppEncode(vector<const char*>& args)
 
     ImageInfoArgs infoArgs;
 
+    // search candidate formats for smallest that meets this
+    float targetPSNR = 0.0f;
+    string candidatesText;
+
     bool isPremulRgb = false;
     bool isGray = false;
 
@@ -2738,6 +3654,9 @@ static int32_t kramAppEncode(vector<const char*>& args)
         else if (isStringEqual(word, "-mipflood")) {
             infoArgs.doMipflood = true;
         }
+        else if (isStringEqual(word, "-etcmultipass")) {
+            infoArgs.doEtcMultipass = true;
+        }
 
         else if (isStringEqual(word, "-heightScale")) {
             ++i;
@@ -2849,6 +3768,21 @@ static int32_t kramAppEncode(vector<const char*>& args)
 
             infoArgs.quality = atoi(args[i]);
         }
+        else if (isStringEqual(word, "-threads")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "threads arg invalid");
+                error = true;
+                break;
+            }
+
+            infoArgs.numThreads = atoi(args[i]);
+            if (infoArgs.numThreads < 1) {
+                KLOGE("Kram", "threads arg invalid");
+                error = true;
+                break;
+            }
+        }
 
         else if (isStringEqual(word, "-output") ||
                  isStringEqual(word, "-o")) {
@@ -2939,22 +3873,50 @@ static int32_t kramAppEncode(vector<const char*>& args)
                  isStringEqual(word, "-verbose")) {
             infoArgs.isVerbose = true;
         }
-        else if (isStringEqual(word, "-f") ||
-                 isStringEqual(word, "-format")) {
+        else if (isStringEqual(word, "-metrics")) {
+            infoArgs.doMetrics = true;
+        }
+        else if (isStringEqual(word, "-targetpsnr")) {
             ++i;
             if (i >= argc) {
-                KLOGE("Kram", "format arg invalid");
+                KLOGE("Kram", "targetpsnr arg invalid");
                 error = true;
                 break;
             }
 
-            infoArgs.formatString = args[i];
+            targetPSNR = atof(args[i]);
+            if (targetPSNR <= 0.0f) {
+                KLOGE("Kram", "targetpsnr arg invalid");
+                error = true;
+                break;
+            }
         }
-
-        // compressor for ktx2 mips
-        // TODO: need level control
-        else if (isStringEqual(word, "-zstd")) {
-            infoArgs.compressor.compressorType = KTX2SupercompressionZstd;
+        else if (isStringEqual(word, "-candidates")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "candidates arg invalid");
+                error = true;
+                break;
+            }
+
+            candidatesText = args[i];
+        }
+        else if (isStringEqual(word, "-f") ||
+                 isStringEqual(word, "-format")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "format arg invalid");
+                error = true;
+                break;
+            }
+
+            infoArgs.formatString = args[i];
+        }
+
+        // compressor for ktx2 mips
+        // TODO: need level control
+        else if (isStringEqual(word, "-zstd")) {
+            infoArgs.compressor.compressorType = KTX2SupercompressionZstd;
             ++i;
             if (i >= argc) {
                 KLOGE("Kram", "zstd level arg invalid");
@@ -3135,7 +4097,7 @@ static int32_t kramAppEncode(vector<const char*>& args)
     // so now can complete validation knowing hdr vs. ldr input
     // this checks the dst format
     else if (success) {
-        bool isHDR = !srcImage.pixelsFloat().empty();
+        bool isHDR = srcImage.isHDR();
 
         if (isHDR) {
             MyMTLPixelFormat format = info.pixelFormat;
@@ -3168,6 +4130,22 @@ static int32_t kramAppEncode(vector<const char*>& args)
             // allows explicit output
         }
 
+        if (targetPSNR > 0.0f) {
+            if (isHDR) {
+                KLOGE("Kram", "targetpsnr only supports ldr input");
+                return -1;
+            }
+
+            // this may change the format and encoder, so rebuild info
+            if (!searchFormatForTargetPSNR(srcImage, infoArgs, candidatesText, targetPSNR)) {
+                KLOGE("Kram", "targetpsnr search failed");
+                return -1;
+            }
+
+            info = ImageInfo();
+            info.initWithArgs(infoArgs);
+        }
+
         info.initWithSourceImage(srcImage);
 
         if (success && ((wResize && hResize) || resizePow2)) {
@@ -3222,6 +4200,15 @@ static int32_t kramAppEncode(vector<const char*>& args)
                 KLOGE("Kram", "rename of temp file failed");
             }
         }
+
+        if (success && info.doMetrics) {
+            for (const auto& m : info.metrics) {
+                KLOGI("Kram", "Metrics chunk %d mip %d %dx%d psnr %0.2f ssim %0.4f\n",
+                      m.chunk, m.mipLevel, m.width, m.height, m.psnrAll, m.ssim);
+            }
+
+            success = writeMetricsJson(dstFilename, info);
+        }
     }
 
     // done
@@ -3231,6 +4218,46 @@ static int32_t kramAppEncode(vector<const char*>& args)
 
                    
                    
+// Peek at the dimensions of the -input of a script command.  Png has them in
+// the IHDR chunk right after the signature.  Other sources fall back to assuming
+// 4 bytes per texel, since they're usually uncompressed.
+static uint64_t estimateCommandTexels(const string& commandAndArgs)
+{
+    string text = commandAndArgs;
+    char* rest = (char*)text.c_str();
+    const char* srcFilename = nullptr;
+    const char* token;
+    while ((token = strtok_r(rest, " ", &rest))) {
+        if (isStringEqual(token, "-i") || isStringEqual(token, "-input")) {
+            srcFilename = strtok_r(rest, " ", &rest);
+            break;
+        }
+    }
+
+    if (!srcFilename) {
+        return 0;
+    }
+
+    FileHelper fileHelper;
+    if (!fileHelper.open(srcFilename, "rb")) {
+        return 0;
+    }
+
+    if (isPNGFilename(srcFilename)) {
+        uint8_t header[24];
+        if (!fileHelper.read(header, sizeof(header))) {
+            return 0;
+        }
+
+        uint32_t width = (header[16] << 24) | (header[17] << 16) | (header[18] << 8) | header[19];
+        uint32_t height = (header[20] << 24) | (header[21] << 16) | (header[22] << 8) | header[23];
+        return (uint64_t)width * height;
+    }
+
+    size_t fileSize = fileHelper.size();
+    return fileSize == (size_t)-1 ? 0 : fileSize / 4;
+}
+
 int32_t kramAppScript(vector<const char*>& args)
 {
     // this is help
@@ -3248,6 +4275,7 @@ int32_t kramAppScript(vector<const char*>& args)
     bool isHaltedOnError = true;
 
     int32_t numJobs = 1;
+    uint64_t maxMemory = 0;  // no limit
 
     for (int32_t i = 0; i < argc; ++i) {
         // check for options
@@ -3270,6 +4298,14 @@ int32_t kramAppScript(vector<const char*>& args)
 
             srcFilename = args[i];
         }
+        else if (isStringEqual(word, "-maxmem")) {
+            ++i;
+            if (i >= argc || (maxMemory = parseMemorySize(args[i])) == 0) {
+                KLOGE("Kram", "maxmem arg invalid");
+                error = true;
+                break;
+            }
+        }
         else if (isStringEqual(word, "-jobs") ||
                  isStringEqual(word, "-j")) {
             ++i;
@@ -3327,6 +4363,22 @@ int32_t kramAppScript(vector<const char*>& args)
     std::atomic<int32_t> skippedCounter(0);
     int32_t commandCounter = 0;
 
+    // With -maxmem, each command reserves its estimated memory before it's
+    // queued, and script waits for running commands to release enough.
+    // The estimate starts at 48 bytes per source texel (source, mips, half/float
+    // copies, and output), and grows if a command measures more than that.
+    MemoryBudget memoryBudget(maxMemory);
+    std::atomic<uint64_t> bytesPerTexel(48);
+
+    // only pay for counting allocations when the peaks are used
+    bool isMemoryTracked = maxMemory > 0 || isVerbose;
+    if (isMemoryTracked) {
+        memoryStartTracking();
+    }
+
+    // workers queue their log messages, and one thread writes them out
+    logStartAsync();
+
     {
         task_system system(numJobs);
 
@@ -3353,23 +4405,30 @@ int32_t kramAppScript(vector<const char*>& args)
                 commandAndArgs.pop_back();
             }
 
+            uint64_t commandTexels = 0;
+            uint64_t commandMemory = 0;
+            if (maxMemory > 0) {
+                commandTexels = estimateCommandTexels(commandAndArgs);
+                commandMemory = commandTexels * bytesPerTexel;
+                memoryBudget.acquire(commandMemory);
+            }
+
             // async execute the command across the provided threads
             // this works for symmetric an asymmetric cores.  Work
             // stealing will happen on low perf cores that can't keep up.
             // Could peek at src images to determine dimensions and mem
             // usage estimates.  But then would need hard/easy queues.
 
-            system.async_([&, commandAndArgs]() mutable {
+            system.async_([&, commandAndArgs, commandTexels, commandMemory]() mutable {
                 // stop any new work when not "continue on error"
                 if (isHaltedOnError && int32_t(errorCounter) > 0) {
+                    memoryBudget.release(commandMemory);
                     skippedCounter++;
                     return 0;  // not really success, just skipping command
                 }
 
+                MemoryScope memoryScope;
                 Timer commandTimer;
-                if (isVerbose) {
-                    KLOGI("Kram", "running %s", commandAndArgs.c_str());
-                }
 
                 string commandAndArgsCopy = commandAndArgs;
 
@@ -3386,14 +4445,43 @@ int32_t kramAppScript(vector<const char*>& args)
                 }
                 const char* command = args[0];
 
+                // tag the log messages of the command with its output file
+                const char* dstFilename = nullptr;
+                for (uint32_t i = 1; i + 1 < args.size(); ++i) {
+                    if (isStringEqual(args[i], "-o") || isStringEqual(args[i], "-output")) {
+                        dstFilename = args[i + 1];
+                        break;
+                    }
+                }
+                LogContextScope logContext(command, dstFilename);
+
+                if (isVerbose) {
+                    KLOGI("Kram", "running %s", commandAndArgsCopy.c_str());
+                }
+
+                TraceScope traceScope("scriptCommand", commandAndArgsCopy.c_str());
                 int32_t errorCode = kramAppCommand(args);
+                traceScope.close();
+
+                uint64_t peakBytes = memoryScope.peakBytes();
+
+                // raise the estimate for later commands if this one used more
+                if (commandTexels > 0) {
+                    uint64_t commandBytesPerTexel = (peakBytes + commandTexels - 1) / commandTexels;
+                    uint64_t oldBytesPerTexel = bytesPerTexel;
+                    while (commandBytesPerTexel > oldBytesPerTexel &&
+                           !bytesPerTexel.compare_exchange_weak(oldBytesPerTexel, commandBytesPerTexel)) {
+                    }
+                }
+                memoryBudget.release(commandMemory);
 
                 if (isVerbose) {
                     auto timeElapsed = commandTimer.timeElapsed();
                     if (timeElapsed > 1.0) {
-                        // TODO: extract output filename
                         // TODO: task sys passes threadIndex into this, so can report which thread completed work
-                        KLOGI("Kram", "perf: %s %s took %0.3fs", command, "file", timeElapsed);
+                        KLOGI("Kram", "perf: %s %s took %0.3fs peak %0.1fMB", command,
+                              dstFilename ? dstFilename : "", timeElapsed,
+                              peakBytes / (1024.0 * 1024.0));
                     }
                 }
 
@@ -3409,6 +4497,12 @@ int32_t kramAppScript(vector<const char*>& args)
         }
     }
 
+    logStopAsync();
+
+    if (isMemoryTracked) {
+        memoryStopTracking();
+    }
+
     // There are joins done at close of scope above before task system shuts down.
     // This makes sure that return value is accurate if there are errors.  Most task
     // systems don't have this, and shutting down the entire task system isn't ideal.
@@ -3420,135 +4514,1861 @@ int32_t kramAppScript(vector<const char*>& args)
     }
 
     if (isVerbose) {
-        KLOGI("Kram", "script completed %d commands in %0.3fs", commandCounter, scriptTimer.timeElapsed());
+        KLOGI("Kram", "script completed %d commands in %0.3fs peak %0.1fMB", commandCounter, scriptTimer.timeElapsed(),
+              memoryPeakBytes() / (1024.0 * 1024.0));
     }
 
     return 0;
 }
 
-enum CommandType {
-    kCommandTypeUnknown,
+// Pagefile written by kram tile.  The header and tables are padded out to a page,
+// then every tile is one page, and the mip tail is packed into the last pages.
+// Tile i is at tilesOffset + i * pageSize, and tiles are row major within a mip.
+struct KramTileFileHeader {
+    char magic[4] = {'K', 'T', 'I', 'L'};
+    uint32_t version = 1;
 
-    kCommandTypeEncode,
-    kCommandTypeDecode,
-    kCommandTypeInfo,
-    kCommandTypeScript,
-    kCommandTypeFixup,
-    // TODO: more commands, but scripting doesn't deal with failure or dependency
-    //    kCommandTypeMerge, // combine channels from multiple png/ktx into one ktx
-    //    kCommandTypeAtlas, // combine images into a single texture + atlas table (atlas to 2d or 2darray)
-    //    kCommandTypeTile, // split up zip of ktx into zip of aligned compressed tiles for SVT, 16k vs 64k tile size
+    uint32_t pixelFormat = 0;  // MyMTLPixelFormat
+    uint32_t width = 0;        // of mip 0
+    uint32_t height = 0;
+
+    uint32_t pageSize = 0;    // bytes in a tile
+    uint32_t tileWidth = 0;   // texels in a tile including the border
+    uint32_t tileHeight = 0;
+    uint32_t border = 0;      // texels on each side of the tile content
+
+    uint32_t numTiledMips = 0;  // followed by this many KramTileMipEntry
+    uint32_t numTailMips = 0;   // followed by this many KramTileTailEntry
+    uint32_t numTiles = 0;
+    uint32_t reserved = 0;
+    uint32_t reserved2 = 0;  // keeps tilesOffset 8 byte aligned without padding
+
+    uint64_t tilesOffset = 0;  // page aligned
+    uint64_t tailOffset = 0;   // page aligned
+    uint64_t tailLength = 0;
 };
+static_assert(sizeof(KramTileFileHeader) == 80, "invalid KramTileFileHeader");
 
-CommandType parseCommandType(const char* command)
-{
-    CommandType commandType = kCommandTypeUnknown;
+struct KramTileMipEntry {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t tilesX = 0;
+    uint32_t tilesY = 0;
+    uint32_t firstTile = 0;
+    uint32_t reserved = 0;
+};
+static_assert(sizeof(KramTileMipEntry) == 24, "invalid KramTileMipEntry");
 
-    if (isStringEqual(command, "encode")) {
-        commandType = kCommandTypeEncode;
-    }
-    else if (isStringEqual(command, "decode")) {
-        commandType = kCommandTypeDecode;
-    }
-    else if (isStringEqual(command, "info")) {
-        commandType = kCommandTypeInfo;
-    }
-    else if (isStringEqual(command, "script")) {
-        commandType = kCommandTypeScript;
-    }
-    else if (isStringEqual(command, "fixup")) {
-        commandType = kCommandTypeFixup;
-    }
-    return commandType;
+struct KramTileTailEntry {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint64_t offset = 0;  // from tailOffset
+    uint64_t length = 0;
+};
+static_assert(sizeof(KramTileTailEntry) == 24, "invalid KramTileTailEntry");
+
+static bool writeBytesAtOffset(FILE* fp, const void* data, size_t dataSize, uint64_t offset)
+{
+#if KRAM_WIN
+    if (_fseeki64(fp, (int64_t)offset, SEEK_SET) != 0)
+        return false;
+#else
+    if (fseeko(fp, (off_t)offset, SEEK_SET) != 0)
+        return false;
+#endif
+    return FileHelper::writeBytes(fp, (const uint8_t*)data, dataSize);
 }
 
-void PSTest()
+// encode 8-bit pixels as a single level, and return only the block data
+static bool encodeLevelBlocks(const ImageInfoArgs& infoArgs,
+                              const vector<Color>& pixels, int32_t w, int32_t h,
+                              bool hasColor, bool hasAlpha,
+                              vector<uint8_t>& blockData)
 {
-    static bool doTest = false;
-    if (!doTest) {
-        return;
+    ImageInfoArgs levelArgs = infoArgs;
+    levelArgs.textureType = MyMTLTextureType2D;
+    levelArgs.doMipmaps = false;
+    levelArgs.isKTX2 = false;
+    levelArgs.isVerbose = false;
+    levelArgs.optimizeFormatForOpaque = false;  // all levels must share the format
+    levelArgs.chunksX = 0;
+    levelArgs.chunksY = 0;
+    levelArgs.chunksCount = 0;
+
+    Image levelImage;
+    levelImage.loadImageFromPixels(pixels, w, h, hasColor, hasAlpha);
+
+    ImageInfo levelInfo;
+    levelInfo.initWithArgs(levelArgs);
+    levelInfo.initWithSourceImage(levelImage);
+
+    KramEncoder encoder;
+    KTXImage dstImage;
+    if (!encoder.encode(levelInfo, levelImage, dstImage)) {
+        return false;
     }
 
-    // So it looks like Photoshop is doing srgb * alpha right away on PNG import. This results in dimmer colors
-    // when they are read on the GPU, since then the gpu does srgb to linear conversion.  values2
-    // is that case below.  Also note that the Photoshop color picker shows only srgb intensities, not the linear.
-    // color value.  This lets it line up with screen color pickers like Apple DCM.  Apple Preview also shows
-    // images with the same dim colors, so it's replicating what Photoshop does.
-    //
-    // Gimp and kramv do what is in values3 resulting in brighter intensities. One question with formats like
-    // astc that interpolate the endpoints in srgb space off the selectors is how to encode colors.
-    // Almost makes sense to drop srgb when premul alpha is involved and store linear color instead.
-    // Figma follows that convention.
-
-    // Here's kramv's srgb flow:
-    // PNG unmul alpha -> srbToLinear(rgb) * alpha -> build mips in linear -> linearToSrgb(lin.rgb)
-    //   -> encode endpoints/colors -> BC/ASTC/ETC2
-    //
-    // Here's Photoshop I think:
-    // PNG unmul alpha -> srgbToLinear(rgb * alpha) -> linarToSrgb( c ) -> toUnmul( c/alpha ) -> Png
-
-    Mipper mipper;
-
-    // 1. srgb 8-bit values
-    uint8_t alpha = 200;
-    float alphaF = mipper.toAlphaFloat(alpha);
+    const KTXImageLevel& level = dstImage.mipLevels[0];
+    blockData.assign(dstImage.fileData + level.offset,
+                     dstImage.fileData + level.offset + level.length);
+    return true;
+}
 
-    uint8_t values1[256];
-    uint8_t values2[256];
-    uint8_t values3[256];
+static uint64_t alignToPage(uint64_t offset, uint64_t pageSize)
+{
+    return ((offset + pageSize - 1) / pageSize) * pageSize;
+}
 
-    for (int32_t i = 0; i < 256; ++i) {
-        // premul and then snap back to store
-        values1[i] = ((uint32_t)i * (uint32_t)alpha) / 255;
+static int32_t kramAppTile(vector<const char*>& args)
+{
+    // this is help
+    int32_t argc = (int32_t)args.size();
+    if (argc == 0) {
+        kramTileUsage();
+        return 0;
     }
 
-    // now convert those values to linear color (float)
-    for (int32_t i = 0; i < 256; ++i) {
-        float value = mipper.toLinear(values1[i]);
-
-        values2[i] = uint8_t(roundf(value * 255.0f));
+    string srcFilename;
+    string dstFilename;
 
-        //KLOGI("srgb", "[%d] = %g\n", i, value);
-    }
+    ImageInfoArgs infoArgs;
 
-    // convert srgb to linear and then do premul
-    for (int32_t i = 0; i < 256; ++i) {
-        float value = mipper.toLinear(i);
-        value *= alphaF;
+    int32_t pageSizeKB = 64;
+    int32_t border = 4;
+    int32_t numJobs = 1;
+    bool isVerbose = false;
+    bool error = false;
 
-        values3[i] = uint8_t(roundf(value * 255.0));
-    }
+    for (int32_t i = 0; i < argc; ++i) {
+        // check for options
+        const char* word = args[i];
+        if (word[0] != '-') {
+            KLOGE("Kram", "unexpected argument \"%s\"\n",
+                  word);
+            error = true;
+            break;
+        }
 
-    // log them side-by-side for comparison
-    KLOGI("srgb", "premul by %0.3f", 200.0 / 255.0);
-    for (int32_t i = 0; i < 256; ++i) {
-        KLOGI("srgb", "[%d] = %u, %u, %u",
-              i, values1[i], values2[i], values3[i]);
-    }
-}
+        if (isStringEqual(word, "-input") ||
+            isStringEqual(word, "-i")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "no input file defined");
+                error = true;
+                break;
+            }
 
-int32_t kramAppCommand(vector<const char*>& args)
-{
-    PSTest();
+            srcFilename = args[i];
+        }
+        else if (isStringEqual(word, "-output") ||
+                 isStringEqual(word, "-o")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "no output file defined");
+                error = true;
+                break;
+            }
 
-    // make sure next arg is a valid command type
-    CommandType commandType = kCommandTypeUnknown;
-    if (args.size() >= 1) {
-        const char* command = args[0];
-        commandType = parseCommandType(command);
+            dstFilename = args[i];
+        }
+        else if (isStringEqual(word, "-f") ||
+                 isStringEqual(word, "-format")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "format arg invalid");
+                error = true;
+                break;
+            }
 
-        if (commandType == kCommandTypeUnknown) {
-            KLOGE("Kram", "Unknown command\n");
+            infoArgs.formatString = args[i];
         }
-    }
+        else if (isStringEqual(word, "-e") ||
+                 isStringEqual(word, "-encoder")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "encoder arg invalid");
+                error = true;
+                break;
+            }
 
-    // remove command before parsing it
-    switch (commandType) {
-        case kCommandTypeEncode:
-            args.erase(args.begin());
-            return kramAppEncode(args);
-        case kCommandTypeDecode:
-            args.erase(args.begin());
+            infoArgs.textureEncoder = parseEncoder(args[i]);
+        }
+        else if (isStringEqual(word, "-quality")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "quality arg invalid");
+                error = true;
+                break;
+            }
+
+            infoArgs.quality = atoi(args[i]);
+        }
+        else if (isStringEqual(word, "-srgb")) {
+            infoArgs.isSRGBSrc = true;
+            infoArgs.isSRGBDst = true;
+        }
+        else if (isStringEqual(word, "-pagesize")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "pagesize arg invalid");
+                error = true;
+                break;
+            }
+
+            pageSizeKB = atoi(args[i]);
+            if (pageSizeKB < 1 || (pageSizeKB & (pageSizeKB - 1)) != 0) {
+                KLOGE("Kram", "pagesize must be a power of two in KB");
+                error = true;
+                break;
+            }
+        }
+        else if (isStringEqual(word, "-border")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "border arg invalid");
+                error = true;
+                break;
+            }
+
+            border = atoi(args[i]);
+            if (border < 0) {
+                KLOGE("Kram", "border arg invalid");
+                error = true;
+                break;
+            }
+        }
+        else if (isStringEqual(word, "-jobs") ||
+                 isStringEqual(word, "-j")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "no job count defined");
+                error = true;
+                break;
+            }
+
+            numJobs = atoi(args[i]);
+        }
+        else if (isStringEqual(word, "-v") ||
+                 isStringEqual(word, "-verbose")) {
+            isVerbose = true;
+        }
+        else {
+            KLOGE("Kram", "unexpected argument \"%s\"\n",
+                  word);
+            error = true;
+            break;
+        }
+    }
+
+    if (srcFilename.empty()) {
+        KLOGE("Kram", "no input file given\n");
+        error = true;
+    }
+    if (dstFilename.empty()) {
+        KLOGE("Kram", "no output file given\n");
+        error = true;
+    }
+
+    if (!error && !validateFormatAndEncoder(infoArgs)) {
+        KLOGE("Kram", "encoder not validated for format\n");
+        error = true;
+    }
+
+    if (!error && !isBlockFormat(infoArgs.pixelFormat)) {
+        KLOGE("Kram", "tile only supports block formats\n");
+        error = true;
+    }
+
+    if (error) {
+        kramTileUsage();
+        return -1;
+    }
+
+    MyMTLPixelFormat format = infoArgs.pixelFormat;
+    Int2 blockDims = blockDimsOfFormat(format);
+    uint32_t blockSize = blockSizeOfFormat(format);
+    uint32_t pageSize = pageSizeKB * 1024;
+
+    // Each tile fills one page.  Lay out the blocks in a square or a 2:1 rect,
+    // matching the standard sparse tile shapes (f.e. 64k bc7 is 256x256, bc1 is 512x256).
+    uint32_t blocksPerPage = pageSize / blockSize;
+    uint32_t tileBlocksX = 1;
+    while (tileBlocksX * tileBlocksX < blocksPerPage) {
+        tileBlocksX *= 2;
+    }
+    uint32_t tileBlocksY = blocksPerPage / tileBlocksX;
+
+    int32_t tileW = tileBlocksX * blockDims.x;
+    int32_t tileH = tileBlocksY * blockDims.y;
+    int32_t contentW = tileW - 2 * border;
+    int32_t contentH = tileH - 2 * border;
+
+    if (contentW <= 0 || contentH <= 0) {
+        KLOGE("Kram", "tile border %d too large for %dx%d tiles", border, tileW, tileH);
+        return -1;
+    }
+
+    Image srcImage;
+    if (!SetupSourceImage(srcFilename, srcImage)) {
+        return -1;
+    }
+
+    if (srcImage.isHDR()) {
+        KLOGE("Kram", "tile only supports ldr input");
+        return -1;
+    }
+
+    bool hasColor = srcImage.hasColor();
+    bool hasAlpha = srcImage.hasAlpha();
+
+    // build the full mip chain in 8-bit, srgb is mipped in linear space
+    vector<vector<Color>> mipPixels;
+    vector<Int2> mipDims;
+    {
+        Mipper mipper;
+
+        mipPixels.push_back(srcImage.pixels());
+        mipDims.push_back(Int2{srcImage.width(), srcImage.height()});
+
+        ImageData srcData;
+        srcData.pixels = mipPixels[0].data();
+        srcData.width = srcImage.width();
+        srcData.height = srcImage.height();
+        srcData.depth = 1;
+        srcData.isSRGB = infoArgs.isSRGBSrc;
+
+        vector<half4> halfImage;
+        vector<half4> halfMip;
+        if (srcData.isSRGB) {
+            halfImage.resize(srcData.width * srcData.height);
+            srcData.pixelsHalf = halfImage.data();
+            mipper.initPixelsHalfIfNeeded(srcData, false, false, halfImage);
+        }
+
+        while (srcData.width > 1 || srcData.height > 1) {
+            int32_t w = srcData.width;
+            int32_t h = srcData.height;
+            int32_t d = 1;
+            mipDown(w, h, d);
+
+            mipPixels.push_back(vector<Color>(w * h));
+
+            ImageData dstData;
+            dstData.pixels = mipPixels.back().data();
+            dstData.isSRGB = srcData.isSRGB;
+
+            // mips are in place in the half buffer, since each is smaller
+            if (srcData.pixelsHalf) {
+                halfMip.resize(w * h);
+                dstData.pixelsHalf = halfMip.data();
+            }
+
+            mipper.mipmap(srcData, dstData);
+            mipDims.push_back(Int2{dstData.width, dstData.height});
+
+            if (srcData.pixelsHalf) {
+                swap(halfImage, halfMip);
+                dstData.pixelsHalf = halfImage.data();
+            }
+            srcData = dstData;
+        }
+    }
+
+    // mips larger than the tile content are split into tiles, the rest go to the tail
+    KramTileFileHeader header;
+    header.pixelFormat = format;
+    header.width = srcImage.width();
+    header.height = srcImage.height();
+    header.pageSize = pageSize;
+    header.tileWidth = tileW;
+    header.tileHeight = tileH;
+    header.border = border;
+
+    vector<KramTileMipEntry> mipEntries;
+    for (uint32_t mipLevel = 0; mipLevel < mipDims.size(); ++mipLevel) {
+        Int2 dims = mipDims[mipLevel];
+        if (dims.x <= contentW && dims.y <= contentH) {
+            break;
+        }
+
+        KramTileMipEntry entry;
+        entry.width = dims.x;
+        entry.height = dims.y;
+        entry.tilesX = (dims.x + contentW - 1) / contentW;
+        entry.tilesY = (dims.y + contentH - 1) / contentH;
+        entry.firstTile = header.numTiles;
+        header.numTiles += entry.tilesX * entry.tilesY;
+        mipEntries.push_back(entry);
+    }
+    header.numTiledMips = (uint32_t)mipEntries.size();
+    header.numTailMips = (uint32_t)(mipDims.size() - mipEntries.size());
+
+    size_t tablesSize = sizeof(KramTileFileHeader) +
+                        header.numTiledMips * sizeof(KramTileMipEntry) +
+                        header.numTailMips * sizeof(KramTileTailEntry);
+    header.tilesOffset = alignToPage(tablesSize, pageSize);
+    header.tailOffset = header.tilesOffset + (uint64_t)header.numTiles * pageSize;
+
+    FileHelper tmpFileHelper;
+    if (!SetupTmpFile(tmpFileHelper, ".ktiles")) {
+        KLOGE("Kram", "tile couldn't generate tmp file for output");
+        return -1;
+    }
+    FILE* fp = tmpFileHelper.pointer();
+
+    Timer timer;
+
+    // encode all tiles across the threads, they are written out as each finishes
+    std::mutex writeMutex;
+    std::atomic<int32_t> errorCounter(0);
+    {
+        task_system system(std::max(1, numJobs));
+
+        for (uint32_t mipLevel = 0; mipLevel < mipEntries.size(); ++mipLevel) {
+            const KramTileMipEntry& entry = mipEntries[mipLevel];
+
+            for (uint32_t ty = 0; ty < entry.tilesY; ++ty) {
+                for (uint32_t tx = 0; tx < entry.tilesX; ++tx) {
+                    system.async_([&, mipLevel, tx, ty]() {
+                        const vector<Color>& pixels = mipPixels[mipLevel];
+                        const KramTileMipEntry& mipEntry = mipEntries[mipLevel];
+                        int32_t w = mipEntry.width;
+                        int32_t h = mipEntry.height;
+
+                        // copy content plus border, clamping at the edges of the mip
+                        vector<Color> tilePixels(tileW * tileH);
+                        int32_t x0 = tx * contentW - border;
+                        int32_t y0 = ty * contentH - border;
+                        for (int32_t y = 0; y < tileH; ++y) {
+                            int32_t yy = std::clamp(y0 + y, 0, h - 1);
+                            for (int32_t x = 0; x < tileW; ++x) {
+                                int32_t xx = std::clamp(x0 + x, 0, w - 1);
+                                tilePixels[y * tileW + x] = pixels[yy * w + xx];
+                            }
+                        }
+
+                        vector<uint8_t> blockData;
+                        if (!encodeLevelBlocks(infoArgs, tilePixels, tileW, tileH,
+                                               hasColor, hasAlpha, blockData) ||
+                            blockData.size() != pageSize) {
+                            errorCounter++;
+                            return;
+                        }
+
+                        uint32_t tileIndex = mipEntry.firstTile + ty * mipEntry.tilesX + tx;
+                        uint64_t offset = header.tilesOffset + (uint64_t)tileIndex * pageSize;
+
+                        lock_guard<mutex> lock(writeMutex);
+                        if (!writeBytesAtOffset(fp, blockData.data(), blockData.size(), offset)) {
+                            errorCounter++;
+                        }
+                    });
+                }
+            }
+        }
+    }
+
+    if (errorCounter > 0) {
+        KLOGE("Kram", "tile %d/%d tiles failed to encode", int32_t(errorCounter), header.numTiles);
+        return -1;
+    }
+
+    // pack the small mips one after another at the end of the file
+    vector<KramTileTailEntry> tailEntries;
+    for (uint32_t mipLevel = header.numTiledMips; mipLevel < mipDims.size(); ++mipLevel) {
+        Int2 dims = mipDims[mipLevel];
+
+        vector<uint8_t> blockData;
+        if (!encodeLevelBlocks(infoArgs, mipPixels[mipLevel], dims.x, dims.y,
+                               hasColor, hasAlpha, blockData)) {
+            KLOGE("Kram", "tile mip tail failed to encode");
+            return -1;
+        }
+
+        KramTileTailEntry entry;
+        entry.width = dims.x;
+        entry.height = dims.y;
+        entry.offset = header.tailLength;
+        entry.length = blockData.size();
+
+        if (!writeBytesAtOffset(fp, blockData.data(), blockData.size(), header.tailOffset + entry.offset)) {
+            KLOGE("Kram", "tile couldn't write mip tail");
+            return -1;
+        }
+
+        header.tailLength += entry.length;
+        tailEntries.push_back(entry);
+    }
+
+    // pad the tail out to a full page
+    uint64_t fileSize = alignToPage(header.tailOffset + header.tailLength, pageSize);
+    vector<uint8_t> padding(fileSize - (header.tailOffset + header.tailLength), 0);
+
+    bool success =
+        writeBytesAtOffset(fp, &header, sizeof(header), 0) &&
+        writeBytesAtOffset(fp, mipEntries.data(), mipEntries.size() * sizeof(KramTileMipEntry), sizeof(header)) &&
+        writeBytesAtOffset(fp, tailEntries.data(), tailEntries.size() * sizeof(KramTileTailEntry),
+                           sizeof(header) + mipEntries.size() * sizeof(KramTileMipEntry)) &&
+        writeBytesAtOffset(fp, padding.data(), padding.size(), header.tailOffset + header.tailLength);
+
+    if (!success) {
+        KLOGE("Kram", "tile couldn't write tables");
+        return -1;
+    }
+
+    if (!tmpFileHelper.copyTemporaryFileTo(dstFilename.c_str())) {
+        KLOGE("Kram", "rename of temp file failed");
+        return -1;
+    }
+
+    if (isVerbose) {
+        KLOGI("Kram", "Tiled %dx%d into %u %dx%d tiles over %u mips, %u tail mips in %0.3fms\n",
+              header.width, header.height, header.numTiles, tileW, tileH,
+              header.numTiledMips, header.numTailMips, timer.timeElapsedMillis());
+    }
+
+    return 0;
+}
+
+// Skyline bottom-left packer.  All sizes are multiples of the block dimensions,
+// so every placement lands on the block grid.
+class SkylinePacker {
+public:
+    SkylinePacker(int32_t width, int32_t height)
+        : _width(width), _height(height)
+    {
+        _nodes.push_back({0, 0, width});
+    }
+
+    bool insert(int32_t w, int32_t h, Int2& pos)
+    {
+        int32_t bestIndex = -1;
+        int32_t bestY = INT32_MAX;
+        int32_t bestWidth = INT32_MAX;
+
+        for (int32_t i = 0; i < (int32_t)_nodes.size(); ++i) {
+            int32_t y = 0;
+            if (!fit(i, w, h, y)) {
+                continue;
+            }
+
+            // lowest top edge, then the narrowest skyline segment to reduce waste
+            if (y + h < bestY || (y + h == bestY && _nodes[i].width < bestWidth)) {
+                bestIndex = i;
+                bestY = y + h;
+                bestWidth = _nodes[i].width;
+                pos = Int2{_nodes[i].x, y};
+            }
+        }
+
+        if (bestIndex < 0) {
+            return false;
+        }
+
+        // raise the skyline over the placed rect
+        _nodes.insert(_nodes.begin() + bestIndex, {pos.x, pos.y + h, w});
+
+        for (int32_t i = bestIndex + 1; i < (int32_t)_nodes.size(); ++i) {
+            Node& prev = _nodes[i - 1];
+            Node& node = _nodes[i];
+            int32_t prevRight = prev.x + prev.width;
+            if (node.x >= prevRight) {
+                break;
+            }
+
+            int32_t shrink = prevRight - node.x;
+            node.x += shrink;
+            node.width -= shrink;
+            if (node.width > 0) {
+                break;
+            }
+            _nodes.erase(_nodes.begin() + i);
+            --i;
+        }
+
+        // merge neighbors at the same height
+        for (int32_t i = 0; i + 1 < (int32_t)_nodes.size(); ++i) {
+            if (_nodes[i].y == _nodes[i + 1].y) {
+                _nodes[i].width += _nodes[i + 1].width;
+                _nodes.erase(_nodes.begin() + i + 1);
+                --i;
+            }
+        }
+
+        return true;
+    }
+
+private:
+    bool fit(int32_t index, int32_t w, int32_t h, int32_t& y) const
+    {
+        int32_t x = _nodes[index].x;
+        if (x + w > _width) {
+            return false;
+        }
+
+        // rect sits on the highest node under its width
+        y = 0;
+        int32_t widthLeft = w;
+        for (int32_t i = index; widthLeft > 0; ++i) {
+            if (i >= (int32_t)_nodes.size()) {
+                return false;
+            }
+            y = std::max(y, _nodes[i].y);
+            if (y + h > _height) {
+                return false;
+            }
+            widthLeft -= _nodes[i].width;
+        }
+        return true;
+    }
+
+    struct Node {
+        int32_t x;
+        int32_t y;
+        int32_t width;
+    };
+
+    int32_t _width;
+    int32_t _height;
+    vector<Node> _nodes;
+};
+
+struct AtlasSprite {
+    string name;
+    Image image;
+
+    // placement of the padded rect
+    int32_t slice = 0;
+    Int2 pos = {0, 0};
+};
+
+static int32_t kramAppAtlas(vector<const char*>& args)
+{
+    // this is help
+    int32_t argc = (int32_t)args.size();
+    if (argc == 0) {
+        kramAtlasUsage();
+        return 0;
+    }
+
+    vector<string> srcFilenames;
+    string dstFilename;
+
+    ImageInfoArgs infoArgs;
+
+    int32_t atlasW = 2048;
+    int32_t atlasH = 2048;
+    int32_t pad = 2;
+    int32_t numJobs = 1;
+    bool isVerbose = false;
+    bool error = false;
+
+    for (int32_t i = 0; i < argc; ++i) {
+        // check for options
+        const char* word = args[i];
+        if (word[0] != '-') {
+            KLOGE("Kram", "unexpected argument \"%s\"\n",
+                  word);
+            error = true;
+            break;
+        }
+
+        if (isStringEqual(word, "-input") ||
+            isStringEqual(word, "-i")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "no input file defined");
+                error = true;
+                break;
+            }
+
+            // folders are walked for png files
+            FileHelper fileHelper;
+            if (fileHelper.isDirectory(args[i])) {
+                vector<string> files;
+                if (!FileHelper::listFilesInFolder(args[i], files)) {
+                    KLOGE("Kram", "atlas couldn't list folder %s", args[i]);
+                    error = true;
+                    break;
+                }
+
+                // sort so the atlas is the same across runs
+                sort(files.begin(), files.end());
+                for (const auto& file : files) {
+                    if (isPNGFilename(file)) {
+                        srcFilenames.push_back(file);
+                    }
+                }
+            }
+            else {
+                srcFilenames.push_back(args[i]);
+            }
+        }
+        else if (isStringEqual(word, "-output") ||
+                 isStringEqual(word, "-o")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "no output file defined");
+                error = true;
+                break;
+            }
+
+            dstFilename = args[i];
+        }
+        else if (isStringEqual(word, "-f") ||
+                 isStringEqual(word, "-format")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "format arg invalid");
+                error = true;
+                break;
+            }
+
+            infoArgs.formatString = args[i];
+        }
+        else if (isStringEqual(word, "-e") ||
+                 isStringEqual(word, "-encoder")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "encoder arg invalid");
+                error = true;
+                break;
+            }
+
+            infoArgs.textureEncoder = parseEncoder(args[i]);
+        }
+        else if (isStringEqual(word, "-type")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "type arg invalid");
+                error = true;
+                break;
+            }
+
+            infoArgs.textureType = parseTextureType(args[i]);
+            if (infoArgs.textureType != MyMTLTextureType2D &&
+                infoArgs.textureType != MyMTLTextureType2DArray) {
+                KLOGE("Kram", "atlas type must be 2d or 2darray");
+                error = true;
+                break;
+            }
+        }
+        else if (isStringEqual(word, "-quality")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "quality arg invalid");
+                error = true;
+                break;
+            }
+
+            infoArgs.quality = atoi(args[i]);
+        }
+        else if (isStringEqual(word, "-srgb")) {
+            infoArgs.isSRGBSrc = true;
+            infoArgs.isSRGBDst = true;
+        }
+        else if (isStringEqual(word, "-size")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "size arg invalid");
+                error = true;
+                break;
+            }
+
+            if (sscanf(args[i], "%dx%d", &atlasW, &atlasH) != 2 ||
+                atlasW <= 0 || atlasH <= 0) {
+                KLOGE("Kram", "size argument must be wxh form\n");
+                error = true;
+                break;
+            }
+        }
+        else if (isStringEqual(word, "-pad")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "pad arg invalid");
+                error = true;
+                break;
+            }
+
+            pad = atoi(args[i]);
+            if (pad < 0) {
+                KLOGE("Kram", "pad arg invalid");
+                error = true;
+                break;
+            }
+        }
+        else if (isStringEqual(word, "-mipnone")) {
+            infoArgs.doMipmaps = false;
+        }
+        else if (isStringEqual(word, "-jobs") ||
+                 isStringEqual(word, "-j")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "no job count defined");
+                error = true;
+                break;
+            }
+
+            numJobs = atoi(args[i]);
+        }
+        else if (isStringEqual(word, "-v") ||
+                 isStringEqual(word, "-verbose")) {
+            isVerbose = true;
+            infoArgs.isVerbose = true;
+        }
+        else {
+            KLOGE("Kram", "unexpected argument \"%s\"\n",
+                  word);
+            error = true;
+            break;
+        }
+    }
+
+    if (srcFilenames.empty()) {
+        KLOGE("Kram", "no input files given\n");
+        error = true;
+    }
+    if (dstFilename.empty()) {
+        KLOGE("Kram", "no output file given\n");
+        error = true;
+    }
+    else if (!(isKTXFilename(dstFilename) || isKTX2Filename(dstFilename))) {
+        KLOGE("Kram", "atlas output must be ktx or ktx2\n");
+        error = true;
+    }
+
+    if (!error && !validateFormatAndEncoder(infoArgs)) {
+        KLOGE("Kram", "encoder not validated for format\n");
+        error = true;
+    }
+
+    if (error) {
+        kramAtlasUsage();
+        return -1;
+    }
+
+    bool isArray = infoArgs.textureType == MyMTLTextureType2DArray;
+    infoArgs.isKTX2 = isKTX2Filename(dstFilename);
+
+    // pad sprites out to whole blocks, so no block is shared across sprites
+    Int2 blockDims = blockDimsOfFormat(infoArgs.pixelFormat);
+
+    // load all the sprites across the threads
+    vector<AtlasSprite> sprites(srcFilenames.size());
+    std::atomic<int32_t> errorCounter(0);
+    {
+        task_system system(std::max(1, numJobs));
+
+        for (uint32_t i = 0; i < srcFilenames.size(); ++i) {
+            system.async_([&, i]() {
+                AtlasSprite& sprite = sprites[i];
+
+                // name is the filename without folder or extension
+                const string& filename = srcFilenames[i];
+                const char* slashPos = strrchr(filename.c_str(), '/');
+                sprite.name = slashPos ? slashPos + 1 : filename.c_str();
+                const char* dotPos = strrchr(sprite.name.c_str(), '.');
+                if (dotPos) {
+                    sprite.name = sprite.name.substr(0, dotPos - sprite.name.c_str());
+                }
+
+                if (!SetupSourceImage(filename, sprite.image) ||
+                    sprite.image.isHDR()) {
+                    KLOGE("Kram", "atlas couldn't load ldr sprite %s", filename.c_str());
+                    errorCounter++;
+                }
+            });
+        }
+    }
+
+    if (errorCounter > 0) {
+        return -1;
+    }
+
+    auto paddedSize = [&](const Image& image) {
+        int32_t w = image.width() + 2 * pad;
+        int32_t h = image.height() + 2 * pad;
+        w = ((w + blockDims.x - 1) / blockDims.x) * blockDims.x;
+        h = ((h + blockDims.y - 1) / blockDims.y) * blockDims.y;
+        return Int2{w, h};
+    };
+
+    // pack tallest first, this keeps the skyline flatter
+    vector<uint32_t> packOrder(sprites.size());
+    for (uint32_t i = 0; i < packOrder.size(); ++i) {
+        packOrder[i] = i;
+    }
+    stable_sort(packOrder.begin(), packOrder.end(), [&](uint32_t lhs, uint32_t rhs) {
+        return sprites[lhs].image.height() > sprites[rhs].image.height();
+    });
+
+    vector<SkylinePacker> packers;
+    packers.emplace_back(atlasW, atlasH);
+
+    for (uint32_t index : packOrder) {
+        AtlasSprite& sprite = sprites[index];
+        Int2 size = paddedSize(sprite.image);
+
+        bool isPacked = false;
+        for (int32_t slice = 0; slice < (int32_t)packers.size(); ++slice) {
+            if (packers[slice].insert(size.x, size.y, sprite.pos)) {
+                sprite.slice = slice;
+                isPacked = true;
+                break;
+            }
+        }
+
+        // a 2darray spills over to a new slice
+        if (!isPacked && isArray) {
+            packers.emplace_back(atlasW, atlasH);
+            if (packers.back().insert(size.x, size.y, sprite.pos)) {
+                sprite.slice = (int32_t)packers.size() - 1;
+                isPacked = true;
+            }
+        }
+
+        if (!isPacked) {
+            KLOGE("Kram", "atlas sprite %s %dx%d doesn't fit in %dx%d",
+                  sprite.name.c_str(), sprite.image.width(), sprite.image.height(),
+                  atlasW, atlasH);
+            return -1;
+        }
+    }
+
+    int32_t numSlices = (int32_t)packers.size();
+
+    // slices are stacked in a vertical strip for the chunk encode
+    vector<Color> atlasPixels;
+    atlasPixels.resize(atlasW * atlasH * numSlices);
+    memset(atlasPixels.data(), 0, vsizeof(atlasPixels));
+
+    bool hasColor = false;
+    bool hasAlpha = false;
+
+    for (const auto& sprite : sprites) {
+        const Image& image = sprite.image;
+        const vector<Color>& srcPixels = image.pixels();
+        int32_t w = image.width();
+        int32_t h = image.height();
+        Int2 size = paddedSize(image);
+
+        hasColor |= image.hasColor();
+        hasAlpha |= image.hasAlpha();
+
+        // extrude the edge texels into the padding, so filtering doesn't pull in neighbors
+        int32_t y0 = sprite.slice * atlasH + sprite.pos.y;
+        for (int32_t y = 0; y < size.y; ++y) {
+            int32_t yy = std::clamp(y - pad, 0, h - 1);
+            Color* dstRow = &atlasPixels[(y0 + y) * atlasW + sprite.pos.x];
+            for (int32_t x = 0; x < size.x; ++x) {
+                int32_t xx = std::clamp(x - pad, 0, w - 1);
+                dstRow[x] = srcPixels[yy * w + xx];
+            }
+        }
+    }
+
+    Image atlasImage;
+    atlasImage.loadImageFromPixels(atlasPixels, atlasW, atlasH * numSlices, hasColor, hasAlpha);
+
+    if (isArray) {
+        infoArgs.chunksX = 1;
+        infoArgs.chunksY = numSlices;
+        infoArgs.chunksCount = numSlices;
+    }
+
+    ImageInfo info;
+    info.initWithArgs(infoArgs);
+    info.initWithSourceImage(atlasImage);
+
+    FileHelper tmpFileHelper;
+    if (!SetupTmpFile(tmpFileHelper, infoArgs.isKTX2 ? ".ktx2" : ".ktx")) {
+        KLOGE("Kram", "atlas couldn't generate tmp file for output");
+        return -1;
+    }
+
+    KramEncoder encoder;
+    if (!encoder.encode(info, atlasImage, tmpFileHelper.pointer())) {
+        KLOGE("Kram", "atlas encode failed");
+        return -1;
+    }
+
+    if (!tmpFileHelper.copyTemporaryFileTo(dstFilename.c_str())) {
+        KLOGE("Kram", "rename of temp file failed");
+        return -1;
+    }
+
+    // write the table that kramv reads, name-atlas.json next to name-suffix.ktx
+    string atlasName = dstFilename;
+    const char* dotPos = strrchr(atlasName.c_str(), '.');
+    if (dotPos) {
+        atlasName = atlasName.substr(0, dotPos - atlasName.c_str());
+    }
+    const char* dashPos = strrchr(atlasName.c_str(), '-');
+    const char* slashPos = strrchr(atlasName.c_str(), '/');
+    if (dashPos && (!slashPos || dashPos > slashPos)) {
+        atlasName = atlasName.substr(0, dashPos - atlasName.c_str());
+    }
+    string atlasFilename = atlasName + "-atlas.json";
+
+    const char* shortName = strrchr(atlasName.c_str(), '/');
+    shortName = shortName ? shortName + 1 : atlasName.c_str();
+
+    string json;
+    json += "{\"name\":";
+    appendJsonString(json, shortName);
+    append_sprintf(json, ",\"width\":%d,\"height\":%d,\"slice\":0,\"padpx\":[%d,%d],\"regions\":[",
+                   atlasW, atlasH, pad, pad);
+
+    for (uint32_t i = 0; i < sprites.size(); ++i) {
+        const AtlasSprite& sprite = sprites[i];
+        json += i ? ",\n" : "\n";
+        json += "{\"name\":";
+        appendJsonString(json, sprite.name.c_str());
+        append_sprintf(json, ",\"rpx\":[%d,%d,%d,%d]",
+                       sprite.pos.x + pad, sprite.pos.y + pad,
+                       sprite.image.width(), sprite.image.height());
+        if (isArray) {
+            append_sprintf(json, ",\"slice\":%d", sprite.slice);
+        }
+        json += "}";
+    }
+    json += "\n]}\n";
+
+    FileHelper atlasFileHelper;
+    if (!atlasFileHelper.open(atlasFilename.c_str(), "w") ||
+        !atlasFileHelper.write((const uint8_t*)json.c_str(), json.size())) {
+        KLOGE("Kram", "atlas couldn't write %s", atlasFilename.c_str());
+        return -1;
+    }
+
+    if (isVerbose) {
+        KLOGI("Kram", "Atlas packed %d sprites into %d %dx%d slices\n",
+              (int32_t)sprites.size(), numSlices, atlasW, atlasH);
+    }
+
+    return 0;
+}
+
+// where one channel of the merged image comes from
+struct MergeChannel {
+    int32_t sourceIndex = -1;  // -1 uses the constant
+    int32_t channel = 0;       // rgba = 0123 in the source
+    uint8_t constant = 0;
+};
+
+static bool parseMergeChannel(const char* text, vector<string>& sourceFilenames,
+                              MergeChannel& mergeChannel)
+{
+    // constant channels
+    if (isStringEqual(text, "0") || isStringEqual(text, "1")) {
+        mergeChannel.sourceIndex = -1;
+        mergeChannel.constant = text[0] == '1' ? 255 : 0;
+        return true;
+    }
+
+    // filename:channel, the filename may have a drive letter so take the last colon
+    const char* colonPos = strrchr(text, ':');
+    if (!colonPos || strlen(colonPos) != 2) {
+        return false;
+    }
+
+    const char* channelNames = "rgba";
+    const char* channelPos = strchr(channelNames, colonPos[1]);
+    if (!channelPos) {
+        return false;
+    }
+    mergeChannel.channel = (int32_t)(channelPos - channelNames);
+
+    // each unique source is only loaded once
+    string filename(text, colonPos - text);
+    auto it = find(sourceFilenames.begin(), sourceFilenames.end(), filename);
+    if (it == sourceFilenames.end()) {
+        sourceFilenames.push_back(filename);
+        it = sourceFilenames.end() - 1;
+    }
+    mergeChannel.sourceIndex = (int32_t)(it - sourceFilenames.begin());
+    return true;
+}
+
+static int32_t kramAppMerge(vector<const char*>& args)
+{
+    // this is help
+    int32_t argc = (int32_t)args.size();
+    if (argc == 0) {
+        kramMergeUsage();
+        return 0;
+    }
+
+    string dstFilename;
+    vector<string> srcFilenames;
+
+    // unspecified channels are 0, and alpha is 1
+    MergeChannel mergeChannels[4];
+    mergeChannels[3].constant = 255;
+
+    ImageInfoArgs infoArgs;
+
+    int32_t numJobs = 1;
+    bool isVerbose = false;
+    bool error = false;
+
+    for (int32_t i = 0; i < argc; ++i) {
+        // check for options
+        const char* word = args[i];
+        if (word[0] != '-') {
+            KLOGE("Kram", "unexpected argument \"%s\"\n",
+                  word);
+            error = true;
+            break;
+        }
+
+        if (isStringEqual(word, "-r") ||
+            isStringEqual(word, "-g") ||
+            isStringEqual(word, "-b") ||
+            isStringEqual(word, "-a")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "channel arg invalid");
+                error = true;
+                break;
+            }
+
+            const char* channelNames = "rgba";
+            int32_t channel = (int32_t)(strchr(channelNames, word[1]) - channelNames);
+            if (!parseMergeChannel(args[i], srcFilenames, mergeChannels[channel])) {
+                KLOGE("Kram", "channel arg \"%s\" must be file:[rgba] or 0 or 1", args[i]);
+                error = true;
+                break;
+            }
+        }
+        else if (isStringEqual(word, "-output") ||
+                 isStringEqual(word, "-o")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "no output file defined");
+                error = true;
+                break;
+            }
+
+            dstFilename = args[i];
+        }
+        else if (isStringEqual(word, "-f") ||
+                 isStringEqual(word, "-format")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "format arg invalid");
+                error = true;
+                break;
+            }
+
+            infoArgs.formatString = args[i];
+        }
+        else if (isStringEqual(word, "-e") ||
+                 isStringEqual(word, "-encoder")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "encoder arg invalid");
+                error = true;
+                break;
+            }
+
+            infoArgs.textureEncoder = parseEncoder(args[i]);
+        }
+        else if (isStringEqual(word, "-quality")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "quality arg invalid");
+                error = true;
+                break;
+            }
+
+            infoArgs.quality = atoi(args[i]);
+        }
+        else if (isStringEqual(word, "-srgb")) {
+            infoArgs.isSRGBSrc = true;
+            infoArgs.isSRGBDst = true;
+        }
+        else if (isStringEqual(word, "-mipnone")) {
+            infoArgs.doMipmaps = false;
+        }
+        else if (isStringEqual(word, "-jobs") ||
+                 isStringEqual(word, "-j")) {
+            ++i;
+            if (i >= argc) {
+                KLOGE("Kram", "no job count defined");
+                error = true;
+                break;
+            }
+
+            numJobs = atoi(args[i]);
+        }
+        else if (isStringEqual(word, "-v") ||
+                 isStringEqual(word, "-verbose")) {
+            isVerbose = true;
+            infoArgs.isVerbose = true;
+        }
+        else {
+            KLOGE("Kram", "unexpected argument \"%s\"\n",
+                  word);
+            error = true;
+            break;
+        }
+    }
+
+    if (srcFilenames.empty()) {
+        KLOGE("Kram", "no source channels given\n");
+        error = true;
+    }
+    if (dstFilename.empty()) {
+        KLOGE("Kram", "no output file given\n");
+        error = true;
+    }
+    else if (!(isKTXFilename(dstFilename) || isKTX2Filename(dstFilename))) {
+        KLOGE("Kram", "merge output must be ktx or ktx2\n");
+        error = true;
+    }
+
+    if (!error && !validateFormatAndEncoder(infoArgs)) {
+        KLOGE("Kram", "encoder not validated for format\n");
+        error = true;
+    }
+
+    if (error) {
+        kramMergeUsage();
+        return -1;
+    }
+
+    infoArgs.isKTX2 = isKTX2Filename(dstFilename);
+
+    // decode the sources concurrently
+    vector<Image> srcImages(srcFilenames.size());
+    std::atomic<int32_t> errorCounter(0);
+    {
+        task_system system(std::max(1, numJobs));
+
+        for (uint32_t i = 0; i < srcFilenames.size(); ++i) {
+            system.async_([&, i]() {
+                if (!SetupSourceImage(srcFilenames[i], srcImages[i]) ||
+                    srcImages[i].isHDR()) {
+                    KLOGE("Kram", "merge couldn't load ldr source %s", srcFilenames[i].c_str());
+                    errorCounter++;
+                }
+            });
+        }
+    }
+
+    if (errorCounter > 0) {
+        return -1;
+    }
+
+    int32_t w = srcImages[0].width();
+    int32_t h = srcImages[0].height();
+    for (uint32_t i = 1; i < srcImages.size(); ++i) {
+        if (srcImages[i].width() != w || srcImages[i].height() != h) {
+            KLOGE("Kram", "merge source %s is %dx%d, expected %dx%d",
+                  srcFilenames[i].c_str(), srcImages[i].width(), srcImages[i].height(), w, h);
+            return -1;
+        }
+    }
+
+    // combine in a single pass, and hand the pixels straight to the encoder
+    vector<Color> mergedPixels;
+    mergedPixels.resize(w * h);
+
+    for (int32_t channel = 0; channel < 4; ++channel) {
+        const MergeChannel& mergeChannel = mergeChannels[channel];
+        uint8_t* dst = (uint8_t*)mergedPixels.data() + channel;
+
+        if (mergeChannel.sourceIndex < 0) {
+            for (int32_t i = 0, iEnd = w * h; i < iEnd; ++i) {
+                dst[i * 4] = mergeChannel.constant;
+            }
+        }
+        else {
+            const uint8_t* src = (const uint8_t*)srcImages[mergeChannel.sourceIndex].pixels().data() +
+                                 mergeChannel.channel;
+            for (int32_t i = 0, iEnd = w * h; i < iEnd; ++i) {
+                dst[i * 4] = src[i * 4];
+            }
+        }
+    }
+
+    // release sources before the encode
+    srcImages.clear();
+
+    // color and alpha are determined by walking the pixels in initWithSourceImage
+    Image mergedImage;
+    mergedImage.loadImageFromPixels(mergedPixels, w, h, true, true);
+    mergedPixels.clear();
+
+    ImageInfo info;
+    info.initWithArgs(infoArgs);
+    info.initWithSourceImage(mergedImage);
+
+    FileHelper tmpFileHelper;
+    if (!SetupTmpFile(tmpFileHelper, infoArgs.isKTX2 ? ".ktx2" : ".ktx")) {
+        KLOGE("Kram", "merge couldn't generate tmp file for output");
+        return -1;
+    }
+
+    KramEncoder encoder;
+    if (!encoder.encode(info, mergedImage, tmpFileHelper.pointer())) {
+        KLOGE("Kram", "merge encode failed");
+        return -1;
+    }
+
+    if (!tmpFileHelper.copyTemporaryFileTo(dstFilename.c_str())) {
+        KLOGE("Kram", "rename of temp file failed");
+        return -1;
+    }
+
+    if (isVerbose) {
+        KLOGI("Kram", "Merged %d sources into %s\n",
+              (int32_t)srcFilenames.size(), dstFilename.c_str());
+    }
+
+    return 0;
+}
+
+// split "a,b,c" into the strings
+static void parseCommaList(const char* text, vector<string>& values)
+{
+    values.clear();
+
+    string textCopy = text;
+    char* rest = (char*)textCopy.c_str();
+    const char* token;
+    while ((token = strtok_r(rest, ",", &rest))) {
+        values.push_back(token);
+    }
+}
+
+static bool parseCommaList(const char* text, vector<int32_t>& values)
+{
+    vector<string> strings;
+    parseCommaList(text, strings);
+
+    values.clear();
+    for (const auto& str : strings) {
+        int32_t value = atoi(str.c_str());
+        if (value <= 0 && str != "0") {
+            return false;
+        }
+        values.push_back(value);
+    }
+    return !values.empty();
+}
+
+// This is the peak of the whole process, so it only increases across bench cases.
+static uint64_t peakResidentMemory()
+{
+#if KRAM_WIN
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if KRAM_MAC || KRAM_IOS
+    return usage.ru_maxrss;  // bytes
+#else
+    return usage.ru_maxrss * 1024ull;  // kilobytes
+#endif
+#endif
+}
+
+// Same pixels on every run, so results can be compared across commits.  Has smooth
+// gradients, hard edges, and noise to exercise the different block modes.
+static void buildSyntheticImage(int32_t dim, Image& image)
+{
+    vector<Color> pixels;
+    pixels.resize(dim * dim);
+
+    uint32_t seed = 0x1234567;
+    for (int32_t y = 0; y < dim; ++y) {
+        for (int32_t x = 0; x < dim; ++x) {
+            seed = seed * 1664525u + 1013904223u;
+            uint8_t noise = (uint8_t)(seed >> 24);
+
+            // 64 texel cells alternate between gradients, edges, and noise
+            int32_t cell = ((x >> 6) + (y >> 6)) % 3;
+
+            Color& c = pixels[y * dim + x];
+            if (cell == 0) {
+                c.r = (uint8_t)((x * 255) / dim);
+                c.g = (uint8_t)((y * 255) / dim);
+                c.b = (uint8_t)(((x + y) * 255) / (2 * dim));
+            }
+            else if (cell == 1) {
+                bool isOn = ((x >> 3) ^ (y >> 3)) & 1;
+                c.r = isOn ? 230 : 20;
+                c.g = isOn ? 40 : 200;
+                c.b = (uint8_t)(x & 0xFF);
+            }
+            else {
+                c.r = noise;
+                c.g = (uint8_t)(noise ^ 0x5A);
+                c.b = (uint8_t)((noise >> 1) + 64);
+            }
+            c.a = (uint8_t)((y * 255) / dim);
+        }
+    }
+
+    image.loadImageFromPixels(pixels, dim, dim, true, true);
+}
+
+struct BenchSource {
+    string name;
+    Image image;
+};
+
+static int32_t kramAppBench(vector<const char*>& args)
+{
+    int32_t argc = (int32_t)args.size();
+
+    string srcFilename;
+    string dstFilename;
+
+    vector<int32_t> syntheticDims;
+    vector<string> formats = {"bc1", "bc3", "bc4", "bc5", "bc7",
+                              "etc2r", "etc2rg", "etc2rgb", "etc2rgba",
+                              "astc4x4", "astc8x8"};
+    vector<string> encoders;  // empty is all encoders of each format
+    vector<int32_t> qualities = {10, 49, 90};
+    vector<int32_t> threadCounts = {1};
+    int32_t numReps = 3;
+
+    bool isVerbose = false;
+    bool error = false;
+
+    for (int32_t i = 0; i < argc; ++i) {
+        // check for options
+        const char* word = args[i];
+        if (word[0] != '-') {
+            KLOGE("Kram", "unexpected argument \"%s\"\n",
+                  word);
+            error = true;
+            break;
+        }
+
+        // all the other options take a value
+        if (isStringEqual(word, "-v") ||
+            isStringEqual(word, "-verbose")) {
+            isVerbose = true;
+            continue;
+        }
+
+        ++i;
+        if (i >= argc) {
+            KLOGE("Kram", "bench %s needs a value", word);
+            error = true;
+            break;
+        }
+        const char* value = args[i];
+
+        if (isStringEqual(word, "-input") ||
+            isStringEqual(word, "-i")) {
+            srcFilename = value;
+        }
+        else if (isStringEqual(word, "-output") ||
+                 isStringEqual(word, "-o")) {
+            dstFilename = value;
+        }
+        else if (isStringEqual(word, "-synthetic")) {
+            if (!parseCommaList(value, syntheticDims)) {
+                KLOGE("Kram", "bench synthetic sizes invalid");
+                error = true;
+                break;
+            }
+        }
+        else if (isStringEqual(word, "-formats") ||
+                 isStringEqual(word, "-f")) {
+            parseCommaList(value, formats);
+        }
+        else if (isStringEqual(word, "-encoders") ||
+                 isStringEqual(word, "-e")) {
+            parseCommaList(value, encoders);
+        }
+        else if (isStringEqual(word, "-quality")) {
+            if (!parseCommaList(value, qualities)) {
+                KLOGE("Kram", "bench quality invalid");
+                error = true;
+                break;
+            }
+        }
+        else if (isStringEqual(word, "-threads")) {
+            if (!parseCommaList(value, threadCounts)) {
+                KLOGE("Kram", "bench threads invalid");
+                error = true;
+                break;
+            }
+        }
+        else if (isStringEqual(word, "-reps")) {
+            numReps = atoi(value);
+            if (numReps < 1) {
+                KLOGE("Kram", "bench reps invalid");
+                error = true;
+                break;
+            }
+        }
+        else {
+            KLOGE("Kram", "unexpected argument \"%s\"\n",
+                  word);
+            error = true;
+            break;
+        }
+    }
+
+    if (!error && srcFilename.empty() && syntheticDims.empty()) {
+        KLOGE("Kram", "bench needs an input or synthetic sizes");
+        error = true;
+    }
+
+    if (error) {
+        kramBenchUsage();
+        return -1;
+    }
+
+    // load all of the sources first, so file reads aren't timed
+    vector<BenchSource> sources;
+
+    if (!srcFilename.empty()) {
+        vector<string> srcFilenames;
+
+        FileHelper fileHelper;
+        if (fileHelper.isDirectory(srcFilename.c_str())) {
+            vector<string> files;
+            if (!FileHelper::listFilesInFolder(srcFilename.c_str(), files)) {
+                KLOGE("Kram", "bench couldn't list folder %s", srcFilename.c_str());
+                return -1;
+            }
+
+            for (const auto& file : files) {
+                if (isPNGFilename(file)) {
+                    srcFilenames.push_back(file);
+                }
+            }
+
+            // same order on every platform
+            std::sort(srcFilenames.begin(), srcFilenames.end());
+        }
+        else {
+            srcFilenames.push_back(srcFilename);
+        }
+
+        for (const auto& filename : srcFilenames) {
+            BenchSource source;
+            source.name = filename;
+            if (!SetupSourceImage(filename, source.image)) {
+                KLOGE("Kram", "bench couldn't load %s", filename.c_str());
+                return -1;
+            }
+            sources.push_back(std::move(source));
+        }
+    }
+
+    for (int32_t dim : syntheticDims) {
+        BenchSource source;
+        sprintf(source.name, "synthetic%d", dim);
+        buildSyntheticImage(dim, source.image);
+        sources.push_back(std::move(source));
+    }
+
+    string json;
+    append_sprintf(json, "{\"version\":\"%s\",\"reps\":%d,\"results\":[", KRAM_VERSION, numReps);
+
+    int32_t numCases = 0;
+
+    for (const auto& format : formats) {
+        // run the requested encoders, or every one that supports the format
+        ImageInfoArgs formatArgs;
+        formatArgs.formatString = format;
+        if (!validateFormatAndEncoder(formatArgs)) {
+            KLOGE("Kram", "bench format %s not supported", format.c_str());
+            return -1;
+        }
+
+        vector<TexEncoder> formatEncoders;
+        if (!encoders.empty()) {
+            for (const auto& encoder : encoders) {
+                TexEncoder textureEncoder = parseEncoder(encoder.c_str());
+                if (isSupportedFormat(textureEncoder, formatArgs.pixelFormat)) {
+                    formatEncoders.push_back(textureEncoder);
+                }
+            }
+        }
+        else {
+            const TexEncoder allEncoders[] = {
+                kTexEncoderExplicit,
+                kTexEncoderATE,
+                kTexEncoderSquish,
+                kTexEncoderBcenc,
+                kTexEncoderEtcenc,
+                kTexEncoderAstcenc,
+            };
+            for (TexEncoder textureEncoder : allEncoders) {
+                if (isSupportedFormat(textureEncoder, formatArgs.pixelFormat)) {
+                    formatEncoders.push_back(textureEncoder);
+                }
+            }
+        }
+
+        for (TexEncoder textureEncoder : formatEncoders) {
+            for (int32_t quality : qualities) {
+                for (int32_t numThreads : threadCounts) {
+                    ImageInfoArgs infoArgs;
+                    infoArgs.formatString = format;
+                    infoArgs.textureEncoder = textureEncoder;
+                    infoArgs.quality = quality;
+                    infoArgs.numThreads = numThreads;
+                    infoArgs.doMipmaps = false;
+
+                    if (!validateFormatAndEncoder(infoArgs)) {
+                        return -1;
+                    }
+
+                    for (const auto& source : sources) {
+                        int32_t w = source.image.width();
+                        int32_t h = source.image.height();
+
+                        // first encode is untimed, and measures the error
+                        // after that, time the encodes without metrics
+                        vector<double> times;
+                        float psnr = 0.0f;
+                        size_t outputSize = 0;
+
+                        for (int32_t rep = 0; rep <= numReps; ++rep) {
+                            bool isTimed = rep > 0;
+
+                            ImageInfoArgs repArgs = infoArgs;
+                            repArgs.doMetrics = !isTimed;
+
+                            // info setup swizzles the source in place, so work from a copy
+                            Image repImage = source.image;
+
+                            ImageInfo info;
+                            info.initWithArgs(repArgs);
+                            info.initWithSourceImage(repImage);
+
+                            KramEncoder encoder;
+                            KTXImage dstImage;
+
+                            Timer timer;
+                            bool success = encoder.encode(info, repImage, dstImage);
+                            timer.stop();
+
+                            if (!success) {
+                                KLOGE("Kram", "bench encode %s %s failed on %s",
+                                      format.c_str(), encoderName(textureEncoder), source.name.c_str());
+                                return -1;
+                            }
+
+                            if (isTimed) {
+                                times.push_back(timer.timeElapsed());
+                            }
+                            else {
+                                if (!info.metrics.empty()) {
+                                    psnr = info.metrics[0].psnrAll;
+                                }
+                                outputSize = dstImage.imageData().size();
+                            }
+                        }
+
+                        std::sort(times.begin(), times.end());
+                        double minTime = times[0];
+                        double medianTime = times[times.size() / 2];
+                        double mpixPerSec = (double)w * h / std::max(minTime, 1e-9) * 1e-6;
+
+                        uint64_t peakMemory = peakResidentMemory();
+
+                        if (isVerbose) {
+                            KLOGI("Kram", "bench %s %s q%d t%d %s %dx%d %0.3fms %0.2fMPix/s psnr %0.2f",
+                                  format.c_str(), encoderName(textureEncoder), quality, numThreads,
+                                  source.name.c_str(), w, h, minTime * 1e3, mpixPerSec, psnr);
+                        }
+
+                        append_sprintf(json, "%s\n{\"source\":", numCases ? "," : "");
+                        appendJsonString(json, source.name.c_str());
+                        append_sprintf(json, ",\"width\":%d,\"height\":%d,\"format\":\"%s\",\"encoder\":\"%s\","
+                                             "\"quality\":%d,\"threads\":%d,"
+                                             "\"secondsMin\":%0.6f,\"secondsMedian\":%0.6f,\"mpixPerSec\":%0.3f,"
+                                             "\"psnr\":%0.3f,\"outputBytes\":%" PRIu64 ",\"peakResidentBytes\":%" PRIu64 "}",
+                                       w, h, format.c_str(), encoderName(textureEncoder),
+                                       quality, numThreads,
+                                       minTime, medianTime, mpixPerSec,
+                                       psnr, (uint64_t)outputSize, peakMemory);
+                        numCases++;
+                    }
+                }
+            }
+        }
+    }
+
+    json += "\n]}\n";
+
+    if (dstFilename.empty()) {
+        KLOGI("Kram", "%s", json.c_str());
+    }
+    else {
+        FileHelper fileHelper;
+        if (!fileHelper.open(dstFilename.c_str(), "w")) {
+            KLOGE("Kram", "bench couldn't open %s", dstFilename.c_str());
+            return -1;
+        }
+
+        if (!fileHelper.write((const uint8_t*)json.c_str(), json.size())) {
+            KLOGE("Kram", "bench couldn't write %s", dstFilename.c_str());
+            return -1;
+        }
+    }
+
+    if (isVerbose) {
+        KLOGI("Kram", "bench ran %d cases", numCases);
+    }
+
+    return 0;
+}
+
+enum CommandType {
+    kCommandTypeUnknown,
+
+    kCommandTypeEncode,
+    kCommandTypeDecode,
+    kCommandTypeInfo,
+    kCommandTypeScript,
+    kCommandTypeFixup,
+    kCommandTypeTile,  // split up a texture into page aligned compressed tiles for SVT, 16k vs 64k tile size
+    kCommandTypeAtlas, // combine images into a single texture + atlas table (atlas to 2d or 2darray)
+    kCommandTypeMerge, // combine channels from multiple png/ktx into one ktx
+    kCommandTypeBench, // time encoders across formats, quality, and threads
+    // TODO: more commands, but scripting doesn't deal with failure or dependency
+};
+
+CommandType parseCommandType(const char* command)
+{
+    CommandType commandType = kCommandTypeUnknown;
+
+    if (isStringEqual(command, "encode")) {
+        commandType = kCommandTypeEncode;
+    }
+    else if (isStringEqual(command, "decode")) {
+        commandType = kCommandTypeDecode;
+    }
+    else if (isStringEqual(command, "info")) {
+        commandType = kCommandTypeInfo;
+    }
+    else if (isStringEqual(command, "script")) {
+        commandType = kCommandTypeScript;
+    }
+    else if (isStringEqual(command, "fixup")) {
+        commandType = kCommandTypeFixup;
+    }
+    else if (isStringEqual(command, "tile")) {
+        commandType = kCommandTypeTile;
+    }
+    else if (isStringEqual(command, "atlas")) {
+        commandType = kCommandTypeAtlas;
+    }
+    else if (isStringEqual(command, "merge")) {
+        commandType = kCommandTypeMerge;
+    }
+    else if (isStringEqual(command, "bench")) {
+        commandType = kCommandTypeBench;
+    }
+    return commandType;
+}
+
+void PSTest()
+{
+    static bool doTest = false;
+    if (!doTest) {
+        return;
+    }
+
+    // So it looks like Photoshop is doing srgb * alpha right away on PNG import. This results in dimmer colors
+    // when they are read on the GPU, since then the gpu does srgb to linear conversion.  values2
+    // is that case below.  Also note that the Photoshop color picker shows only srgb intensities, not the linear.
+    // color value.  This lets it line up with screen color pickers like Apple DCM.  Apple Preview also shows
+    // images with the same dim colors, so it's replicating what Photoshop does.
+    //
+    // Gimp and kramv do what is in values3 resulting in brighter intensities. One question with formats like
+    // astc that interpolate the endpoints in srgb space off the selectors is how to encode colors.
+    // Almost makes sense to drop srgb when premul alpha is involved and store linear color instead.
+    // Figma follows that convention.
+
+    // Here's kramv's srgb flow:
+    // PNG unmul alpha -> srbToLinear(rgb) * alpha -> build mips in linear -> linearToSrgb(lin.rgb)
+    //   -> encode endpoints/colors -> BC/ASTC/ETC2
+    //
+    // Here's Photoshop I think:
+    // PNG unmul alpha -> srgbToLinear(rgb * alpha) -> linarToSrgb( c ) -> toUnmul( c/alpha ) -> Png
+
+    Mipper mipper;
+
+    // 1. srgb 8-bit values
+    uint8_t alpha = 200;
+    float alphaF = mipper.toAlphaFloat(alpha);
+
+    uint8_t values1[256];
+    uint8_t values2[256];
+    uint8_t values3[256];
+
+    for (int32_t i = 0; i < 256; ++i) {
+        // premul and then snap back to store
+        values1[i] = ((uint32_t)i * (uint32_t)alpha) / 255;
+    }
+
+    // now convert those values to linear color (float)
+    for (int32_t i = 0; i < 256; ++i) {
+        float value = mipper.toLinear(values1[i]);
+
+        values2[i] = uint8_t(roundf(value * 255.0f));
+
+        //KLOGI("srgb", "[%d] = %g\n", i, value);
+    }
+
+    // convert srgb to linear and then do premul
+    for (int32_t i = 0; i < 256; ++i) {
+        float value = mipper.toLinear(i);
+        value *= alphaF;
+
+        values3[i] = uint8_t(roundf(value * 255.0));
+    }
+
+    // log them side-by-side for comparison
+    KLOGI("srgb", "premul by %0.3f", 200.0 / 255.0);
+    for (int32_t i = 0; i < 256; ++i) {
+        KLOGI("srgb", "[%d] = %u, %u, %u",
+              i, values1[i], values2[i], values3[i]);
+    }
+}
+
+int32_t kramAppCommand(vector<const char*>& args)
+{
+    PSTest();
+
+    // make sure next arg is a valid command type
+    CommandType commandType = kCommandTypeUnknown;
+    if (args.size() >= 1) {
+        const char* command = args[0];
+        commandType = parseCommandType(command);
+
+        if (commandType == kCommandTypeUnknown) {
+            KLOGE("Kram", "Unknown command\n");
+        }
+    }
+
+    // remove command before parsing it
+    switch (commandType) {
+        case kCommandTypeEncode:
+            args.erase(args.begin());
+            return kramAppEncode(args);
+        case kCommandTypeDecode:
+            args.erase(args.begin());
             return kramAppDecode(args);
         case kCommandTypeInfo:
             args.erase(args.begin());
@@ -3559,6 +6379,18 @@ int32_t kramAppCommand(vector<const char*>& args)
         case kCommandTypeFixup:
             args.erase(args.begin());
             return kramAppFixup(args);
+        case kCommandTypeTile:
+            args.erase(args.begin());
+            return kramAppTile(args);
+        case kCommandTypeAtlas:
+            args.erase(args.begin());
+            return kramAppAtlas(args);
+        case kCommandTypeMerge:
+            args.erase(args.begin());
+            return kramAppMerge(args);
+        case kCommandTypeBench:
+            args.erase(args.begin());
+            return kramAppBench(args);
         default:
             break;
     }
@@ -3585,9 +6417,42 @@ int32_t kramAppMain(int32_t argc, char* argv[])
         return 0;
     }
 
+    // these apply to any command, and all the threads that it runs on
+    const char* traceFilename = nullptr;
+    const char* logFilename = nullptr;
+    while (args.size() >= 2) {
+        if (isStringEqual(args[0], "-trace")) {
+            traceFilename = args[1];
+        }
+        else if (isStringEqual(args[0], "-logjson")) {
+            logFilename = args[1];
+        }
+        else {
+            break;
+        }
+        args.erase(args.begin(), args.begin() + 2);
+    }
+
+    if (logFilename && !setLogJsonFile(logFilename)) {
+        KLOGE("Kram", "logjson couldn't open %s", logFilename);
+        return -1;
+    }
+
     setupTestArgs(args);
 
-    return kramAppCommand(args);
+    if (traceFilename) {
+        traceStart();
+    }
+
+    int32_t errorCode = kramAppCommand(args);
+
+    if (traceFilename && !traceStopAndWrite(traceFilename)) {
+        errorCode = -1;
+    }
+    if (logFilename) {
+        setLogJsonFile(nullptr);
+    }
+    return errorCode;
 }
 
 bool isSupportedFilename(const char* filename) {
@@ -65,11 +65,12 @@ bool LoadKtx(const uint8_t* data, size_t dataSize, Image& sourceImage);
 bool LoadPng(const uint8_t* data, size_t dataSize, bool isPremulSrgb, bool isGray, bool& isSrgb, Image& sourceImage);
 
 // can call these with data instead of needing a file
-string kramInfoPNGToString(const string& srcFilename, const uint8_t* data, uint64_t dataSize, bool isVerbose);
-string kramInfoKTXToString(const string& srcFilename, const KTXImage& srcImage, bool isVerbose);
+// isJson returns a single line json record instead of the text form
+string kramInfoPNGToString(const string& srcFilename, const uint8_t* data, uint64_t dataSize, bool isVerbose, bool isJson = false);
+string kramInfoKTXToString(const string& srcFilename, const KTXImage& srcImage, bool isVerbose, bool isJson = false);
 
-// return string with data about png/ktx srcFilename
-string kramInfoToString(const string& srcFilename, bool isVerbose);
+// return string with data about png/ktx srcFilename, only reads headers/chunks/levels
+string kramInfoToString(const string& srcFilename, bool isVerbose, bool isJson = false);
 
 // this is entry point to library for cli app
 int32_t kramAppMain(int32_t argc, char* argv[]);
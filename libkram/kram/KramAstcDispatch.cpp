@@ -0,0 +1,205 @@
+// kram - Copyright 2020-2023 by Alec Miller. - MIT License
+// The license and copyright notice shall be included
+// in all copies or substantial portions of the Software.
+
+#if COMPILE_ASTCENC
+
+#include "KramAstcDispatch.h"
+
+#ifndef COMPILE_ASTCENC_AVX2
+#define COMPILE_ASTCENC_AVX2 0
+#endif
+#ifndef COMPILE_ASTCENC_SSE41
+#define COMPILE_ASTCENC_SSE41 0
+#endif
+
+// Drop any isa build that isn't wider than the baseline, so a baseline built
+// with /arch:AVX -mf16c isn't ranked below the sse41 build.  This matches how
+// astcenc_mathlib.h derives ASTCENC_SSE/ASTCENC_AVX for the baseline.  cl doesn't
+// define __SSE4_1__, so its baseline is scalar astcenc and keeps the sse41 build.
+#if COMPILE_ASTCENC_SSE41 && (defined(__SSE4_1__) || defined(__SSE4_2__))
+#undef COMPILE_ASTCENC_SSE41
+#define COMPILE_ASTCENC_SSE41 0
+#endif
+#if COMPILE_ASTCENC_AVX2 && defined(__AVX2__)
+#undef COMPILE_ASTCENC_AVX2
+#define COMPILE_ASTCENC_AVX2 0
+#endif
+
+#if COMPILE_ASTCENC_AVX2
+namespace kram_astcenc_avx2 {
+#include "KramAstcVariant.h"
+}
+#endif
+
+#if COMPILE_ASTCENC_SSE41
+namespace kram_astcenc_sse41 {
+#include "KramAstcVariant.h"
+}
+#endif
+
+#if COMPILE_ASTCENC_AVX2 || COMPILE_ASTCENC_SSE41
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace kram {
+
+// Each isa build has its own context type, so cast to and from the global one.
+#define ASTCENC_ISA_API(isa)                                                                 \
+    static astcenc_error isa##ContextAlloc(const astcenc_config* config,                     \
+                                           unsigned int threadCount,                         \
+                                           astcenc_context** context)                        \
+    {                                                                                        \
+        return kram_astcenc_##isa::astcenc_context_alloc(                                    \
+            config, threadCount, (kram_astcenc_##isa::astcenc_context**)context);            \
+    }                                                                                        \
+    static astcenc_error isa##CompressImage(astcenc_context* context, astcenc_image* image,  \
+                                            const astcenc_swizzle* swizzle,                  \
+                                            uint8_t* dataOut, size_t dataLen,                \
+                                            unsigned int threadIndex)                        \
+    {                                                                                        \
+        return kram_astcenc_##isa::astcenc_compress_image(                                   \
+            (kram_astcenc_##isa::astcenc_context*)context, image, swizzle,                   \
+            dataOut, dataLen, threadIndex);                                                  \
+    }                                                                                        \
+    static astcenc_error isa##DecompressImage(astcenc_context* context, const uint8_t* data, \
+                                              size_t dataLen, astcenc_image* imageOut,       \
+                                              const astcenc_swizzle* swizzle,                \
+                                              unsigned int threadIndex)                      \
+    {                                                                                        \
+        return kram_astcenc_##isa::astcenc_decompress_image(                                 \
+            (kram_astcenc_##isa::astcenc_context*)context, data, dataLen, imageOut,          \
+            swizzle, threadIndex);                                                           \
+    }                                                                                        \
+    static void isa##ContextFree(astcenc_context* context)                                   \
+    {                                                                                        \
+        kram_astcenc_##isa::astcenc_context_free(                                            \
+            (kram_astcenc_##isa::astcenc_context*)context);                                  \
+    }                                                                                        \
+    static const AstcencApi isa##Api = {                                                     \
+        #isa,                                                                                \
+        kram_astcenc_##isa::astcenc_config_init,                                             \
+        isa##ContextAlloc,                                                                   \
+        isa##CompressImage,                                                                  \
+        isa##DecompressImage,                                                                \
+        isa##ContextFree,                                                                    \
+    };
+
+#if COMPILE_ASTCENC_AVX2
+ASTCENC_ISA_API(avx2)
+#endif
+
+#if COMPILE_ASTCENC_SSE41
+ASTCENC_ISA_API(sse41)
+#endif
+
+#undef ASTCENC_ISA_API
+
+// the build that the rest of libkram is compiled with
+static const AstcencApi baselineApi = {
+    "baseline",
+    astcenc_config_init,
+    astcenc_context_alloc,
+    astcenc_compress_image,
+    astcenc_decompress_image,
+    astcenc_context_free,
+};
+
+#if COMPILE_ASTCENC_AVX2 || COMPILE_ASTCENC_SSE41
+
+// The cpu features that the isa builds are compiled for.  This is checked
+// here, since astcenc only checks cpuid in context_alloc, and calling into an
+// avx2 build at all can execute avx2 instructions.
+struct CpuFeatures {
+    bool hasSse41 = false;
+    bool hasPopcnt = false;
+    bool hasF16c = false;
+    bool hasAvx2 = false;
+};
+
+static void cpuid(uint32_t leaf, uint32_t data[4])
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    __cpuidex((int*)data, leaf, 0);
+#else
+    if (!__get_cpuid_count(leaf, 0, &data[0], &data[1], &data[2], &data[3])) {
+        data[0] = data[1] = data[2] = data[3] = 0;
+    }
+#endif
+}
+
+// avx registers also need to be saved by the os
+static bool isAvxStateEnabled()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    uint64_t xcr0 = _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    uint64_t xcr0 = ((uint64_t)edx << 32) | eax;
+#endif
+    return (xcr0 & 6) == 6;
+}
+
+static CpuFeatures cpuFeatures()
+{
+    CpuFeatures features;
+
+    uint32_t data[4];
+    cpuid(0, data);
+    uint32_t numLeaves = data[0];
+
+    bool hasOsxsave = false;
+    if (numLeaves >= 1) {
+        cpuid(1, data);
+        features.hasSse41 = data[2] & (1 << 19);
+        features.hasPopcnt = data[2] & (1 << 23);
+        hasOsxsave = data[2] & (1 << 27);
+        features.hasF16c = data[2] & (1 << 29);
+    }
+
+    if (numLeaves >= 7 && hasOsxsave && isAvxStateEnabled()) {
+        cpuid(7, data);
+        features.hasAvx2 = data[1] & (1 << 5);
+    }
+
+    return features;
+}
+
+#endif
+
+static const AstcencApi* selectAstcencApi()
+{
+#if COMPILE_ASTCENC_AVX2 || COMPILE_ASTCENC_SSE41
+    CpuFeatures features = cpuFeatures();
+    macroUnusedVar(features);
+#endif
+
+    // widest first
+#if COMPILE_ASTCENC_AVX2
+    if (features.hasAvx2 && features.hasPopcnt && features.hasF16c) {
+        return &avx2Api;
+    }
+#endif
+#if COMPILE_ASTCENC_SSE41
+    if (features.hasSse41 && features.hasPopcnt) {
+        return &sse41Api;
+    }
+#endif
+
+    return &baselineApi;
+}
+
+const AstcencApi& astcencApi()
+{
+    static const AstcencApi* api = selectAstcencApi();
+    return *api;
+}
+
+}  // namespace kram
+
+#endif
@@ -0,0 +1,29 @@
+// kram - Copyright 2020-2023 by Alec Miller. - MIT License
+// The license and copyright notice shall be included
+// in all copies or substantial portions of the Software.
+
+#pragma once
+
+#include "astcenc.h"
+
+namespace kram {
+
+// On x64, libkram can build astcenc once for the baseline isa, and again
+// for sse4.1 and avx2 (see ASTCENC_ISA in libkram/CMakeLists.txt).  The
+// widest build that the cpu supports is picked on first use, so one binary
+// still gets the 8-wide avx2 path on newer cpus.  Otherwise this forwards to
+// the only build of astcenc.
+struct AstcencApi {
+    const char* isaName;
+
+    decltype(&astcenc_config_init) configInit;
+    decltype(&astcenc_context_alloc) contextAlloc;
+    decltype(&astcenc_compress_image) compressImage;
+    decltype(&astcenc_decompress_image) decompressImage;
+    decltype(&astcenc_context_free) contextFree;
+};
+
+// Contexts must be freed by the same api that allocated them.
+const AstcencApi& astcencApi();
+
+}  // namespace kram
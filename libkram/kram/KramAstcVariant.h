@@ -0,0 +1,50 @@
+// kram - Copyright 2020-2023 by Alec Miller. - MIT License
+// The license and copyright notice shall be included
+// in all copies or substantial portions of the Software.
+
+// No pragma once, this is included inside of each kram_astcenc_<isa> namespace.
+// astcenc.h stays global, so the config, image, and swizzle types are shared
+// by all of the isa builds.  Only the context is private to each build, and
+// that is opaque to callers.  Declaring the api here also keeps the calls to
+// astcenc_compress_reset in astcenc_entry.cpp from binding to the baseline build.
+
+struct astcenc_context;
+
+astcenc_error astcenc_config_init(
+    astcenc_profile profile,
+    unsigned int block_x,
+    unsigned int block_y,
+    unsigned int block_z,
+    float quality,
+    unsigned int flags,
+    astcenc_config* config);
+
+astcenc_error astcenc_context_alloc(
+    const astcenc_config* config,
+    unsigned int thread_count,
+    astcenc_context** context);
+
+astcenc_error astcenc_compress_image(
+    astcenc_context* context,
+    astcenc_image* image,
+    const astcenc_swizzle* swizzle,
+    uint8_t* data_out,
+    size_t data_len,
+    unsigned int thread_index);
+
+astcenc_error astcenc_compress_reset(
+    astcenc_context* context);
+
+astcenc_error astcenc_decompress_image(
+    astcenc_context* context,
+    const uint8_t* data,
+    size_t data_len,
+    astcenc_image* image_out,
+    const astcenc_swizzle* swizzle,
+    unsigned int thread_index);
+
+astcenc_error astcenc_decompress_reset(
+    astcenc_context* context);
+
+void astcenc_context_free(
+    astcenc_context* context);
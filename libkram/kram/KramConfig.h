@@ -331,6 +331,11 @@ public:
     explicit half4(tType val) { reg = val; }
     half4(half xx, half yy, half zz, half ww) : x(xx), y(yy), z(zz), w(ww) {}
     half4(const half4& val) { reg = val.reg; }
+    half4& operator=(const half4& val)
+    {
+        reg = val.reg;
+        return *this;
+    }
 
     // no real ops here, althought Neon does have sevearal
     // use of these pull data out of simd registers
@@ -498,6 +503,51 @@ inline half4 toHalf4(const float4& vv)
 }
 #endif
 
+// Bulk conversions for rows and images of texels.  F16C converts 2 texels per
+// instruction, without the lane inserts/extracts of the single texel calls above.
+#if USE_SSE && !USE_FLOAT16 && defined(__AVX__)
+
+inline void toFloat4(const half4* src, float4* dst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128i reg16 = _mm_loadu_si128((const __m128i*)&src[i]);
+        _mm256_storeu_ps((float*)&dst[i], _mm256_cvtph_ps(reg16));
+    }
+    for (; i < count; ++i) {
+        dst[i] = toFloat4(src[i]);
+    }
+}
+inline void toHalf4(const float4* src, half4* dst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128i reg16 = _mm256_cvtps_ph(_mm256_loadu_ps((const float*)&src[i]), 0);  // round to nearest-even
+        _mm_storeu_si128((__m128i*)&dst[i], reg16);
+    }
+    for (; i < count; ++i) {
+        dst[i] = toHalf4(src[i]);
+    }
+}
+
+#else
+
+// Neon and _Float16 already convert a texel per instruction
+inline void toFloat4(const half4* src, float4* dst, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = toFloat4(src[i]);
+    }
+}
+inline void toHalf4(const float4* src, half4* dst, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = toHalf4(src[i]);
+    }
+}
+
+#endif
+
 }  // namespace simd
 
 //---------------------------------------
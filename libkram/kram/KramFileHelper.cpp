@@ -13,9 +13,11 @@
 //#include <algorithm> // for min
 //#include <vector>
 
+#include "KramTrace.h"
 #include "tmpfileplus.h"
 
 #if KRAM_MAC || KRAM_IOS || KRAM_LINUX
+#include <dirent.h>  // for opendir()
 #include <unistd.h>  // for getpagesize()
 #endif
 
@@ -113,6 +115,8 @@ bool FileHelper::readBytes(FILE* fp, uint8_t* data, size_t dataSize)
 }
 bool FileHelper::writeBytes(FILE* fp, const uint8_t* data, size_t dataSize)
 {
+    TraceScope traceScope("writeFile");
+
     size_t elementsWritten = fwrite(data, 1, dataSize, fp);
     if (elementsWritten != (size_t)dataSize) {
         return false;
@@ -137,11 +141,89 @@ size_t FileHelper::pagesize()
     return pagesize;
 }
 
+bool FileHelper::listFilesInFolder(const char* folderName, vector<string>& files, bool isRecursive)
+{
+    string folder = folderName;
+    if (!folder.empty() && folder.back() != '/') {
+        folder += '/';
+    }
+
+#if KRAM_WIN
+    string searchPattern = folder + "*";
+
+    WIN32_FIND_DATAA findData;
+    HANDLE findHandle = FindFirstFileA(searchPattern.c_str(), &findData);
+    if (findHandle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    do {
+        const char* name = findData.cFileName;
+
+        // skip ., .., and hidden files
+        if (name[0] == '.') {
+            continue;
+        }
+
+        string filename = folder + name;
+        if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            if (isRecursive) {
+                listFilesInFolder(filename.c_str(), files, isRecursive);
+            }
+        }
+        else {
+            files.push_back(filename);
+        }
+    } while (FindNextFileA(findHandle, &findData));
+
+    FindClose(findHandle);
+#else
+    DIR* dir = opendir(folder.c_str());
+    if (!dir) {
+        return false;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        const char* name = entry->d_name;
+
+        // skip ., .., and hidden files
+        if (name[0] == '.') {
+            continue;
+        }
+
+        string filename = folder + name;
+
+        // d_type isn't filled in on all filesystems, so fallback to stat
+        bool isDir = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN) {
+            struct stat stats;
+            isDir = stat(filename.c_str(), &stats) == 0 && (stats.st_mode & S_IFDIR);
+        }
+
+        if (isDir) {
+            if (isRecursive) {
+                listFilesInFolder(filename.c_str(), files, isRecursive);
+            }
+        }
+        else {
+            files.push_back(filename);
+        }
+    }
+
+    closedir(dir);
+#endif
+
+    return true;
+}
+
 bool FileHelper::copyTemporaryFileTo(const char* dstFilename)
 {
     if (!_fp) return false;
     if (_filename.empty()) return false;
 
+    TraceScope traceScope("copyTemporaryFile", dstFilename);
+
     // since we're not closing, need to flush output
     fflush(_fp);
 
@@ -54,6 +54,10 @@ public:
 
     static size_t pagesize();
 
+    // append all files found in the folder, and in subfolders if recursive
+    // filenames are prefixed with the folder name, and use / as separator
+    static bool listFilesInFolder(const char* folderName, vector<string>& files, bool isRecursive = true);
+
 private:
     FILE* _fp = nullptr;
     string _filename;
@@ -34,6 +34,7 @@
 
 #if COMPILE_ASTCENC
 #include "astcenc.h"  // astc encoder
+#include "KramAstcDispatch.h"
 
 // hack to improve block generation on L1 and LA encoding
 //extern thread_local int32_t gAstcenc_UniqueChannelsInPartitioning;
@@ -51,7 +52,9 @@
 #include "KramMipper.h"
 #include "KramSDFMipper.h"
 #include "KramTimer.h"
+#include "KramTrace.h"
 #include "KramZipHelper.h"
+#include "TaskSystem.h"
 
 // for zlib compress
 #include "miniz.h"
@@ -64,6 +67,229 @@ namespace kram {
 using namespace NAMESPACE_STL;
 using namespace simd;
 
+#if COMPILE_COMP
+
+// Compressonator works on the fp16 bits of each channel stored in a float,
+// and negates the bits for negative values of the signed format.
+static float toBC6HChannel(half value, bool isSigned)
+{
+    uint16_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint16_t magnitude = bits & 0x7FFF;
+    if (magnitude > 0x7BFF) {
+        // inf to the largest finite value, nan to 0
+        magnitude = (magnitude == 0x7C00) ? 0x7BFF : 0;
+    }
+
+    if (bits & 0x8000) {
+        return isSigned ? -(float)magnitude : 0.0f;
+    }
+    return (float)magnitude;
+}
+
+// and this is the reverse for the decoder, which returns the negated magnitude
+// for negative values of the signed format
+static float fromBC6HChannel(float value)
+{
+    // casting a negative float to uint16_t is undefined, so split off the sign
+    uint16_t bits = (uint16_t)std::min(fabsf(value), (float)0x7BFF);
+    if (value < 0.0f) {
+        bits |= 0x8000;
+    }
+    half h;
+    memcpy(&h, &bits, sizeof(bits));
+    return toFloat4(half4(h)).x;
+}
+
+#endif
+
+//---------------------------------------------------------
+// Packed hdr formats are one 32-bit texel with unsigned floats, so these
+// clamp to 0.  Conversions work on 4 texels at a time with the rgb
+// channels transposed into registers.  sse2neon provides these on Neon.
+
+// nan to 0, and negative and inf to the range of the format
+static inline __m128 clampPackedFloat(__m128 c, __m128 maxValue)
+{
+    c = _mm_and_ps(c, _mm_cmpord_ps(c, c));
+    return _mm_min_ps(_mm_max_ps(c, _mm_setzero_ps()), maxValue);
+}
+
+// round to an unsigned float with a 5-bit exponent (bias 15) and no sign
+template <int32_t numMantissaBits>
+static inline __m128i toPackedFloatChannel(__m128 c)
+{
+    const int32_t shift = 23 - numMantissaBits;
+    __m128i bits = _mm_castps_si128(c);
+
+    // normals round to nearest even on the fp32 bits, then rebias the exponent
+    __m128i lsb = _mm_and_si128(_mm_srli_epi32(bits, shift), _mm_set1_epi32(1));
+    __m128i normal = _mm_add_epi32(bits, _mm_add_epi32(lsb, _mm_set1_epi32((1 << (shift - 1)) - 1)));
+    normal = _mm_sub_epi32(_mm_srli_epi32(normal, shift), _mm_set1_epi32((127 - 15) << numMantissaBits));
+
+    // below 2^-14 are denormals, and these can round up into the smallest normal
+    __m128i denormal = _mm_cvtps_epi32(_mm_mul_ps(c, _mm_set1_ps((float)(1 << (14 + numMantissaBits)))));
+    __m128 isDenormal = _mm_cmplt_ps(c, _mm_set1_ps(1.0f / 16384.0f));
+
+    return _mm_castps_si128(_mm_blendv_ps(_mm_castsi128_ps(normal), _mm_castsi128_ps(denormal), isDenormal));
+}
+
+template <int32_t numMantissaBits>
+static inline __m128 fromPackedFloatChannel(__m128i bits)
+{
+    const int32_t shift = 23 - numMantissaBits;
+    __m128i exponent = _mm_srli_epi32(bits, numMantissaBits);
+
+    // rebias the exponent, and exponent 31 is inf/nan
+    __m128i normal = _mm_add_epi32(_mm_slli_epi32(bits, shift), _mm_set1_epi32((127 - 15) << 23));
+    __m128i isSpecial = _mm_cmpeq_epi32(exponent, _mm_set1_epi32(31));
+    normal = _mm_or_si128(normal, _mm_and_si128(isSpecial, _mm_set1_epi32(0x7F800000)));
+
+    __m128i mantissa = _mm_and_si128(bits, _mm_set1_epi32((1 << numMantissaBits) - 1));
+    __m128 denormal = _mm_mul_ps(_mm_cvtepi32_ps(mantissa), _mm_set1_ps(1.0f / (float)(1 << (14 + numMantissaBits))));
+    __m128i isDenormal = _mm_cmpeq_epi32(exponent, _mm_setzero_si128());
+
+    return _mm_blendv_ps(_mm_castsi128_ps(normal), denormal, _mm_castsi128_ps(isDenormal));
+}
+
+// r11 g11 b10 from low to high bits, same as DXGI_FORMAT_R11G11B10_FLOAT
+static inline __m128i toRG11B10Float(__m128 r, __m128 g, __m128 b)
+{
+    // largest finite values, (1 + 63/64) * 2^15 and (1 + 31/32) * 2^15
+    const __m128 kMax11 = _mm_set1_ps(65024.0f);
+    const __m128 kMax10 = _mm_set1_ps(64512.0f);
+
+    __m128i rBits = toPackedFloatChannel<6>(clampPackedFloat(r, kMax11));
+    __m128i gBits = toPackedFloatChannel<6>(clampPackedFloat(g, kMax11));
+    __m128i bBits = toPackedFloatChannel<5>(clampPackedFloat(b, kMax10));
+
+    return _mm_or_si128(rBits, _mm_or_si128(_mm_slli_epi32(gBits, 11), _mm_slli_epi32(bBits, 22)));
+}
+
+static inline void fromRG11B10Float(__m128i bits, __m128& r, __m128& g, __m128& b)
+{
+    const __m128i kMask11 = _mm_set1_epi32(0x7FF);
+
+    r = fromPackedFloatChannel<6>(_mm_and_si128(bits, kMask11));
+    g = fromPackedFloatChannel<6>(_mm_and_si128(_mm_srli_epi32(bits, 11), kMask11));
+    b = fromPackedFloatChannel<5>(_mm_srli_epi32(bits, 22));
+}
+
+// 9-bit mantissas with no implied 1, and a shared 5-bit exponent (bias 15) in
+// the top bits, same as DXGI_FORMAT_R9G9B9E5_SHAREDEXP.  This follows the
+// EXT_texture_shared_exponent encoding, but with the exponent from the fp32 bits.
+static inline __m128i toRGB9E5Float(__m128 r, __m128 g, __m128 b)
+{
+    // largest value, (511/512) * 2^16
+    const __m128 kMax = _mm_set1_ps(65408.0f);
+    const __m128 kHalf = _mm_set1_ps(0.5f);
+
+    r = clampPackedFloat(r, kMax);
+    g = clampPackedFloat(g, kMax);
+    b = clampPackedFloat(b, kMax);
+
+    __m128 maxValue = _mm_max_ps(r, _mm_max_ps(g, b));
+
+    // floor(log2(maxValue)) is the fp32 exponent, and 0 and denormals clamp to -16
+    __m128i exponent = _mm_sub_epi32(_mm_srli_epi32(_mm_castps_si128(maxValue), 23), _mm_set1_epi32(127));
+    exponent = _mm_add_epi32(_mm_max_epi32(exponent, _mm_set1_epi32(-16)), _mm_set1_epi32(16));
+
+    // scale is 2^(24 - exponent) to move 9 bits of the max value above the decimal
+    __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_sub_epi32(_mm_set1_epi32(127 + 24), exponent), 23));
+
+    // rounding can carry into a 10th bit, so go up an exponent then
+    __m128i maxMantissa = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(maxValue, scale), kHalf));
+    __m128i isCarry = _mm_cmpeq_epi32(maxMantissa, _mm_set1_epi32(512));
+    exponent = _mm_sub_epi32(exponent, isCarry);
+    scale = _mm_blendv_ps(scale, _mm_mul_ps(scale, kHalf), _mm_castsi128_ps(isCarry));
+
+    __m128i rBits = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(r, scale), kHalf));
+    __m128i gBits = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(g, scale), kHalf));
+    __m128i bBits = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(b, scale), kHalf));
+
+    return _mm_or_si128(_mm_or_si128(rBits, _mm_slli_epi32(gBits, 9)),
+                        _mm_or_si128(_mm_slli_epi32(bBits, 18), _mm_slli_epi32(exponent, 27)));
+}
+
+static inline void fromRGB9E5Float(__m128i bits, __m128& r, __m128& g, __m128& b)
+{
+    const __m128i kMask9 = _mm_set1_epi32(0x1FF);
+
+    // 2^(exponent - 15 - 9)
+    __m128i exponent = _mm_srli_epi32(bits, 27);
+    __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(exponent, _mm_set1_epi32(127 - 24)), 23));
+
+    r = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(bits, kMask9)), scale);
+    g = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(bits, 9), kMask9)), scale);
+    b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(bits, 18), kMask9)), scale);
+}
+
+// count texels of float4 to RG11B10Float or RGB9E5Float
+static void packFloatTexels(MyMTLPixelFormat format, const float4* src, uint32_t* dst, int32_t count)
+{
+    bool isRGB9E5 = format == MyMTLPixelFormatRGB9E5Float;
+
+    for (int32_t i = 0; i < count; i += 4) {
+        int32_t numTexels = std::min(4, count - i);
+
+        // pad out the last group
+        float4 texels[4] = {};
+        for (int32_t t = 0; t < numTexels; ++t) {
+            texels[t] = src[i + t];
+        }
+
+        __m128 r = *(const __m128*)&texels[0];
+        __m128 g = *(const __m128*)&texels[1];
+        __m128 b = *(const __m128*)&texels[2];
+        __m128 a = *(const __m128*)&texels[3];
+        _MM_TRANSPOSE4_PS(r, g, b, a);
+
+        __m128i bits = isRGB9E5 ? toRGB9E5Float(r, g, b) : toRG11B10Float(r, g, b);
+
+        if (numTexels == 4) {
+            _mm_storeu_si128((__m128i*)(dst + i), bits);
+        }
+        else {
+            uint32_t packed[4];
+            _mm_storeu_si128((__m128i*)packed, bits);
+            memcpy(dst + i, packed, numTexels * sizeof(uint32_t));
+        }
+    }
+}
+
+// count texels of RG11B10Float or RGB9E5Float to float4, alpha is set to 1
+static void unpackFloatTexels(MyMTLPixelFormat format, const uint32_t* src, float4* dst, int32_t count)
+{
+    bool isRGB9E5 = format == MyMTLPixelFormatRGB9E5Float;
+
+    for (int32_t i = 0; i < count; i += 4) {
+        int32_t numTexels = std::min(4, count - i);
+
+        uint32_t packed[4] = {};
+        memcpy(packed, src + i, numTexels * sizeof(uint32_t));
+        __m128i bits = _mm_loadu_si128((const __m128i*)packed);
+
+        __m128 r, g, b;
+        __m128 a = _mm_set1_ps(1.0f);
+        if (isRGB9E5)
+            fromRGB9E5Float(bits, r, g, b);
+        else
+            fromRG11B10Float(bits, r, g, b);
+        _MM_TRANSPOSE4_PS(r, g, b, a);
+
+        float4 texels[4];
+        *(__m128*)&texels[0] = r;
+        *(__m128*)&texels[1] = g;
+        *(__m128*)&texels[2] = b;
+        *(__m128*)&texels[3] = a;
+
+        for (int32_t t = 0; t < numTexels; ++t) {
+            dst[i + t] = texels[t];
+        }
+    }
+}
+
 template <typename T>
 void pointFilterImage(int32_t w, int32_t h, const T* srcImage,
                       int32_t dstW, int32_t dstH, T* dstImage)
@@ -201,6 +427,16 @@ bool Image::convertToFourChannel(const KTXImage& image, uint32_t mipNumber)
             break;
         }
 
+        case MyMTLPixelFormatRG11B10Float:
+        case MyMTLPixelFormatRGB9E5Float: {
+            const uint32_t* srcPixels = (const uint32_t*)(srcLevelData + mipBaseOffset);
+
+            _pixelsFloat.resize(_width * _height);
+
+            unpackFloatTexels(image.pixelFormat, srcPixels, _pixelsFloat.data(), _width * _height);
+            break;
+        }
+
         case MyMTLPixelFormatR16Float:
         case MyMTLPixelFormatRG16Float:
 #if SUPPORT_RGB
@@ -209,13 +445,18 @@ bool Image::convertToFourChannel(const KTXImage& image, uint32_t mipNumber)
         case MyMTLPixelFormatRGBA16Float: {
             int32_t numSrcChannels = numChannelsOfFormat(image.pixelFormat);
 
-            _pixelsFloat.resize(_width * _height);
+            // keep as half, the mips and encoders convert to float as needed
+            _pixelsHalf.resize(_width * _height);
 
-            // treat as float for per channel copies
-            float4* dstPixels = _pixelsFloat.data();
+            half4* dstPixels = _pixelsHalf.data();
 
             const half* srcPixels = (const half*)(srcLevelData + mipBaseOffset);
 
+            if (numSrcChannels == 4) {
+                memcpy((uint8_t*)dstPixels, srcPixels, vsizeof(_pixelsHalf));
+                break;
+            }
+
             half4 dstTemp = toHalf4(float4m(0.0f, 0.0f, 0.0f, 1.0f));
 
             for (int32_t y = 0; y < _height; ++y) {
@@ -230,8 +471,7 @@ bool Image::convertToFourChannel(const KTXImage& image, uint32_t mipNumber)
                         dstTemp.v[i] = srcPixels[srcX + i];
                     }
 
-                    // use AVX to convert
-                    dstPixels[dstX] = toFloat4(dstTemp);
+                    dstPixels[dstX] = dstTemp;
                 }
             }
             break;
@@ -363,6 +603,30 @@ bool Image::convertToFourChannelForThumbnail(const KTXImage& image, uint32_t mip
             break;
         }
 
+        case MyMTLPixelFormatRG11B10Float:
+        case MyMTLPixelFormatRGB9E5Float: {
+            const uint32_t* srcPixels = (const uint32_t*)(srcLevelData + mipBaseOffset);
+
+            vector<float4> rowPixels;
+            rowPixels.resize(_width);
+
+            _pixels.resize(_width * _height);
+
+            Color* dstPixels = _pixels.data();
+
+            for (int32_t y = 0; y < _height; ++y) {
+                int32_t y0 = y * _width;
+
+                unpackFloatTexels(image.pixelFormat, srcPixels + y0, rowPixels.data(), _width);
+
+                // This is a simple saturate to unorm8
+                for (int32_t x = 0; x < _width; ++x) {
+                    dstPixels[y0 + x] = ColorFromUnormFloat4(rowPixels[x]);
+                }
+            }
+            break;
+        }
+
         case MyMTLPixelFormatR16Float:
         case MyMTLPixelFormatRG16Float:
 #if SUPPORT_RGB
@@ -581,6 +845,8 @@ bool KramDecoder::decodeBlocks(
     vector<uint8_t>& outputTexture,  // currently Color
     const KramDecoderParams& params) const
 {
+    TraceScope traceScope("decodeMip", formatTypeName(blockFormat));
+
     bool success = false;
 
     // could tie use flags to format filter, or encoder settings
@@ -726,7 +992,11 @@ bool KramDecoder::decodeBlocks(
                             
                             // losing snorm and chopping to 8-bit
                             for (uint32_t i = 0; i < 16; ++i) {
-                                pixels[i] = ColorFromUnormFloat4(*(const float4*)&pixelsFloat[i]);
+                                float4 c = float4m(fromBC6HChannel(pixelsFloat[i][0]),
+                                                   fromBC6HChannel(pixelsFloat[i][1]),
+                                                   fromBC6HChannel(pixelsFloat[i][2]),
+                                                   1.0f);
+                                pixels[i] = ColorFromUnormFloat4(c);
                             }
                             break;
                         }
@@ -893,24 +1163,27 @@ bool KramDecoder::decodeBlocks(
                 profile = ASTCENC_PRF_HDR;  // TODO: also ASTCENC_PRF_HDR_RGB_LDR_A
             }
 
+            // picks the sse4.1/avx2 build of astcenc
+            const AstcencApi& astcenc = astcencApi();
+
             astcenc_config config;
-            astcenc_error error = astcenc_config_init(
+            astcenc_error error = astcenc.configInit(
                 profile, blockDims.x, blockDims.y, 1, ASTCENC_PRE_FAST, ASTCENC_FLG_DECOMPRESS_ONLY, &config);
             if (error != ASTCENC_SUCCESS) {
                 return false;
             }
 
             astcenc_context* codec_context = nullptr;
-            error = astcenc_context_alloc(&config, 1, &codec_context);
+            error = astcenc.contextAlloc(&config, 1, &codec_context);
             if (error != ASTCENC_SUCCESS) {
                 return false;
             }
             // no swizzle
             astcenc_swizzle swizzleDecode = {ASTCENC_SWZ_R, ASTCENC_SWZ_G, ASTCENC_SWZ_B, ASTCENC_SWZ_A};
 
-            error = astcenc_decompress_image(codec_context, srcData, srcDataLength, &dstImageASTC, &swizzleDecode, 0);
+            error = astcenc.decompressImage(codec_context, srcData, srcDataLength, &dstImageASTC, &swizzleDecode, 0);
 
-            astcenc_context_free(codec_context);
+            astcenc.contextFree(codec_context);
 
             success = (error == ASTCENC_SUCCESS);
         }
@@ -1032,6 +1305,8 @@ bool KramDecoder::decodeImpl(const KTXImage& srcImage, FILE* dstFile, KTXImage&
     vector<uint8_t> mipStorage;
     mipStorage.resize(srcImage.mipLengthLargest() * numChunks);  // enough to hold biggest mip
 
+    vector<float4> unpackedTexels;
+
     for (uint32_t i = 0; i < srcImage.mipLevels.size(); ++i) {
         // DONE: to decode compressed KTX2 want to walk all chunks of a single level
         // after decompressing the level.   This isn't doing unpackLevel and needs to here.
@@ -1062,7 +1337,18 @@ bool KramDecoder::decodeImpl(const KTXImage& srcImage, FILE* dstFile, KTXImage&
             const uint8_t* srcData = srcLevelData + mipBaseOffset + chunk * srcMipLevel.length;
 
             // decode the blocks to LDR RGBA8
-            if (isExplicitFormat(srcImage.pixelFormat)) {
+            if (isPackedFloatFormat(srcImage.pixelFormat)) {
+                // these expand to RGBA16F
+                int32_t numTexels = w * h;
+                unpackedTexels.resize(numTexels);
+                unpackFloatTexels(srcImage.pixelFormat, (const uint32_t*)srcData, unpackedTexels.data(), numTexels);
+
+                half4* dstTexels = (half4*)outputTexture.data();
+                for (int32_t t = 0; t < numTexels; ++t) {
+                    dstTexels[t] = toHalf4(unpackedTexels[t]);
+                }
+            }
+            else if (isExplicitFormat(srcImage.pixelFormat)) {
                 // just copy the data as is
                 memcpy(outputTexture.data(), srcData, srcMipLevel.length);
             }
@@ -1112,7 +1398,7 @@ bool Image::resizeImage(int32_t wResize, int32_t hResize, bool resizePow2, Image
     if (_width == wResize && _height == hResize) {
         return true;
     }
-    if (_pixels.empty()) {
+    if (!isHDR() && _pixels.empty()) {
         return false;
     }
 
@@ -1132,6 +1418,14 @@ bool Image::resizeImage(int32_t wResize, int32_t hResize, bool resizePow2, Image
 
         _pixelsFloat = pixelsResize;
     }
+    else {
+        vector<half4> pixelsResize;
+        pixelsResize.resize(wResize * hResize);
+
+        pointFilterImage(_width, _height, _pixelsHalf.data(), wResize, hResize, pixelsResize.data());
+
+        _pixelsHalf = pixelsResize;
+    }
 
     _width = wResize;
     _height = hResize;
@@ -1412,6 +1706,28 @@ KTX2DescriptorFileBlock::KTX2DescriptorFileBlock(MyMTLPixelFormat format, bool i
             channels[1].bitLength = 64 - 1;
             break;
 
+        case MyMTLPixelFormatRG11B10Float:
+            for (uint32_t i = 0; i < numChannels; ++i) {
+                auto& c = channels[i];
+                c.channelType = KHR_DF_CHANNEL_RED + i;
+                c.bitOffset = 11 * i;
+                c.bitLength = (i == 2 ? 10 : 11) - 1;
+            }
+            colorModel = KHR_DF_MODEL_RGBSDA;
+            break;
+
+        case MyMTLPixelFormatRGB9E5Float:
+            // TODO: spec has 3 more samples for the shared exponent, but only
+            // have room for 4 here.  So this only describes the mantissas.
+            for (uint32_t i = 0; i < numChannels; ++i) {
+                auto& c = channels[i];
+                c.channelType = KHR_DF_CHANNEL_RED + i;
+                c.bitOffset = 9 * i;
+                c.bitLength = 9 - 1;
+            }
+            colorModel = KHR_DF_MODEL_RGBSDA;
+            break;
+
             // NOTE: astc is all the same, and can already use defaults
 
         default: {
@@ -1735,6 +2051,8 @@ bool KramEncoder::saveKTX2(const KTXImage& srcImage, const KTX2Compressor& compr
 
             const uint8_t* levelData = srcImage.fileData + level1.offset;
 
+            TraceScope traceSupercompress("supercompressMip");
+
             // compress each mip
             switch (compressor.compressorType) {
                 case KTX2SupercompressionZstd: {
@@ -1762,6 +2080,8 @@ bool KramEncoder::saveKTX2(const KTXImage& srcImage, const KTX2Compressor& compr
                     return false;
             }
 
+            traceSupercompress.close();
+
             // also need for compressed levels?
             // align the offset to leastCommonMultiple(4, texel_block_size);
             if (lastImageByteOffset & 0x3) {
@@ -1986,6 +2306,180 @@ void printBCBlock(const uint8_t* bcBlock, MyMTLPixelFormat format)
     }
 }
 
+static float psnrFromMse(float mse)
+{
+    // cap lossless channels so reports don't have inf
+    if (mse <= 1e-6f) {
+        return 99.0f;
+    }
+    return 10.0f * log10f((255.0f * 255.0f) / mse);
+}
+
+static float lumaOfColor(const Color& c)
+{
+    // Rec709 weights, same as the etc REC709 error metric
+    return 0.2126f * c.r + 0.7152f * c.g + 0.0722f * c.b;
+}
+
+// mean ssim of luma over 8x8 windows stepped by 4
+static float computeSSIM(const Color* srcPixels, const Color* dstPixels, int32_t w, int32_t h)
+{
+    const float c1 = (0.01f * 255.0f) * (0.01f * 255.0f);
+    const float c2 = (0.03f * 255.0f) * (0.03f * 255.0f);
+
+    const int32_t windowDim = 8;
+    const int32_t windowStep = 4;
+
+    // small mips are treated as a single window
+    int32_t winW = std::min(windowDim, w);
+    int32_t winH = std::min(windowDim, h);
+
+    double sumSSIM = 0.0;
+    int32_t numWindows = 0;
+
+    for (int32_t y = 0; y + winH <= h; y += windowStep) {
+        for (int32_t x = 0; x + winW <= w; x += windowStep) {
+            float sumA = 0.0f, sumB = 0.0f;
+            float sumAA = 0.0f, sumBB = 0.0f, sumAB = 0.0f;
+
+            for (int32_t yy = y; yy < y + winH; ++yy) {
+                for (int32_t xx = x; xx < x + winW; ++xx) {
+                    float a = lumaOfColor(srcPixels[yy * w + xx]);
+                    float b = lumaOfColor(dstPixels[yy * w + xx]);
+                    sumA += a;
+                    sumB += b;
+                    sumAA += a * a;
+                    sumBB += b * b;
+                    sumAB += a * b;
+                }
+            }
+
+            float invCount = 1.0f / (float)(winW * winH);
+            float meanA = sumA * invCount;
+            float meanB = sumB * invCount;
+            float varA = sumAA * invCount - meanA * meanA;
+            float varB = sumBB * invCount - meanB * meanB;
+            float covAB = sumAB * invCount - meanA * meanB;
+
+            float ssim = ((2.0f * meanA * meanB + c1) * (2.0f * covAB + c2)) /
+                         ((meanA * meanA + meanB * meanB + c1) * (varA + varB + c2));
+
+            sumSSIM += ssim;
+            numWindows++;
+
+            if (winW == w) break;
+        }
+        if (winH == h) break;
+    }
+
+    return numWindows ? (float)(sumSSIM / numWindows) : 1.0f;
+}
+
+static void normalOfColor(const Color& c, int32_t xChannel, int32_t yChannel, float n[3])
+{
+    const uint8_t* channels = (const uint8_t*)&c;
+    float x = channels[xChannel] * (2.0f / 255.0f) - 1.0f;
+    float y = channels[yChannel] * (2.0f / 255.0f) - 1.0f;
+    float z = sqrtf(std::max(0.0f, 1.0f - x * x - y * y));
+    float invLength = 1.0f / sqrtf(x * x + y * y + z * z);
+    n[0] = x * invLength;
+    n[1] = y * invLength;
+    n[2] = z * invLength;
+}
+
+// Decode the encoded mip and compare to the pixels that were handed to the encoder
+static bool computeMipMetrics(const ImageInfo& info, const ImageData& srcImage,
+                              const uint8_t* blockData, size_t blockDataSize,
+                              ImageMetrics& metrics)
+{
+    int32_t w = srcImage.width;
+    int32_t h = srcImage.height;
+
+    metrics.width = w;
+    metrics.height = h;
+
+    // the snorm decode remaps endpoints in place, so decode from a copy
+    vector<uint8_t> blockCopy(blockData, blockData + blockDataSize);
+    vector<uint8_t> decodedData;
+    decodedData.resize(w * h * sizeof(Color));
+
+    KramDecoder decoder;
+    KramDecoderParams decoderParams;
+    if (!decoder.decodeBlocks(w, h, blockCopy.data(), (uint32_t)blockDataSize,
+                              info.pixelFormat, decodedData, decoderParams)) {
+        return false;
+    }
+
+    const Color* srcPixels = srcImage.pixels;
+    const Color* dstPixels = (const Color*)decodedData.data();
+
+    // accumulate squared error a row at a time in simd, then in double
+    double sumSq[4] = {};
+    for (int32_t y = 0; y < h; ++y) {
+        float4 rowSumSq = float4m(0.0f);
+        for (int32_t x = 0; x < w; ++x) {
+            const Color& a = srcPixels[y * w + x];
+            const Color& b = dstPixels[y * w + x];
+            float4 diff = float4m(a.r, a.g, a.b, a.a) - float4m(b.r, b.g, b.b, b.a);
+            rowSumSq += diff * diff;
+        }
+        for (int32_t i = 0; i < 4; ++i) {
+            sumSq[i] += rowSumSq[i];
+        }
+    }
+
+    // only score the channels that the format stores
+    int32_t numChannels = (int32_t)numChannelsOfFormat(info.pixelFormat);
+    if (numChannels == 4 && !info.hasAlpha) {
+        numChannels = 3;
+    }
+    metrics.numChannels = numChannels;
+
+    double invCount = 1.0 / (double)(w * h);
+    double sumAll = 0.0;
+    for (int32_t i = 0; i < 4; ++i) {
+        metrics.mse[i] = (float)(sumSq[i] * invCount);
+        metrics.psnr[i] = psnrFromMse(metrics.mse[i]);
+        if (i < numChannels) {
+            sumAll += sumSq[i];
+        }
+    }
+    metrics.mseAll = (float)(sumAll * invCount / numChannels);
+    metrics.psnrAll = psnrFromMse(metrics.mseAll);
+
+    metrics.ssim = computeSSIM(srcPixels, dstPixels, w, h);
+
+    if (info.isNormal) {
+        // match the channels that addBaseProps reports for the swizzle
+        int32_t xChannel = 0;
+        int32_t yChannel = 1;
+        if (info.swizzleText == "gggr") {
+            xChannel = 3;
+            yChannel = 1;
+        }
+        else if (info.swizzleText == "rrrg") {
+            xChannel = 0;
+            yChannel = 3;
+        }
+
+        double sumAngle = 0.0;
+        float maxAngle = 0.0f;
+        for (int32_t i = 0, iEnd = w * h; i < iEnd; ++i) {
+            float n0[3], n1[3];
+            normalOfColor(srcPixels[i], xChannel, yChannel, n0);
+            normalOfColor(dstPixels[i], xChannel, yChannel, n1);
+            float cosAngle = std::clamp(n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2], -1.0f, 1.0f);
+            float angle = acosf(cosAngle) * (180.0f / 3.14159265f);
+            sumAngle += angle;
+            maxAngle = std::max(maxAngle, angle);
+        }
+        metrics.normalAngleAvg = (float)(sumAngle * invCount);
+        metrics.normalAngleMax = maxAngle;
+    }
+
+    return true;
+}
+
 bool KramEncoder::createMipsFromChunks(
     ImageInfo& info,
     Image& singleImage,
@@ -2035,7 +2529,33 @@ bool KramEncoder::createMipsFromChunks(
     bool doPremultiply = info.hasAlpha && (info.isPremultiplied || info.isPrezero);
     bool isMultichunk = numChunks > 1;
 
-    if (info.isHDR) {
+    bool isHalfSource = !singleImage.pixelsHalf().empty();
+
+    if (info.isHDR && isHalfSource) {
+        // here the source is half, and the mips stay half too
+        if (isMultichunk) {
+            halfImage.resize(w * h);
+            srcImage.pixelsHalf = halfImage.data();
+        }
+        else {
+            srcImage.pixelsHalf = (half4*)singleImage.pixelsHalf().data();
+        }
+
+        if (doPremultiply) {
+            for (const auto& pixel : singleImage.pixelsHalf()) {
+                float4 pixelFloat = toFloat4(pixel);
+                float alpha = pixelFloat.w;
+
+                // only premul at 0 alpha regions for prezero
+                if (!info.isPrezero || alpha == 0.0f) {
+                    pixelFloat *= alpha;
+                    pixelFloat.w = alpha;
+                    const_cast<half4&>(pixel) = toHalf4(pixelFloat);
+                }
+            }
+        }
+    }
+    else if (info.isHDR) {
         // here the source is float
 
         // used to store chunks of the strip data
@@ -2104,6 +2624,7 @@ bool KramEncoder::createMipsFromChunks(
 
     for (int32_t chunk = 0; chunk < numChunks; ++chunk) {
         Timer timerBuildMips;
+        TraceScope traceBuildMips("buildMips");
         
         // this needs to append before chunkOffset copy below
         w = srcTopMipWidth;
@@ -2116,9 +2637,18 @@ bool KramEncoder::createMipsFromChunks(
         srcImage.width = w;
         srcImage.height = h;
 
-        if (info.isHDR) {
-            // TODO: should this support halfImage too?
-            
+        if (info.isHDR && isHalfSource) {
+            if (isMultichunk) {
+                const half4* srcPixels = singleImage.pixelsHalf().data();
+                for (int32_t y = 0; y < h; ++y) {
+                    // offset into original strip/atlas
+                    int32_t yOffset = (y + chunkOffset.y) * singleImage.width() + chunkOffset.x;
+
+                    memcpy((uint8_t*)&data.halfImage[y * w], (const uint8_t*)&srcPixels[yOffset], w * sizeof(half4));
+                }
+            }
+        }
+        else if (info.isHDR) {
             if (isMultichunk) {
                 const float4* srcPixels = (const float4*)singleImage.pixelsFloat().data();
                 for (int32_t y = 0; y < h; ++y) {
@@ -2243,8 +2773,10 @@ bool KramEncoder::createMipsFromChunks(
                 }
                 
                 // This is more memory than in-place, but the submips
-                // are only 1/3rd the memory of the main mip
-                mipPixels.resize(numPixels);
+                // are only 1/3rd the memory of the main mip.
+                // Hdr mips only write the half/float pixels.
+                if (!info.isHDR)
+                    mipPixels.resize(numPixels);
                 if (srcImage.pixelsFloat)
                     mipPixelsFloat.resize(numPixels);
                 else if (srcImage.pixelsHalf)
@@ -2255,7 +2787,8 @@ bool KramEncoder::createMipsFromChunks(
                     ImageData& dstMipImage = dstMipImages[mipLevel];
                     dstMipImage.isSRGB = dstImageData.isSRGB;
                     
-                    dstMipImage.pixels = mipPixels.data() + pixelOffset;
+                    if (!info.isHDR)
+                        dstMipImage.pixels = mipPixels.data() + pixelOffset;
                     if (srcImage.pixelsFloat)
                         dstMipImage.pixelsFloat = mipPixelsFloat.data() + pixelOffset;
                     else if (srcImage.pixelsHalf)
@@ -2273,7 +2806,7 @@ bool KramEncoder::createMipsFromChunks(
                 }
                 
                 // Now can run mip flooding on image
-                if (info.doMipflood) {
+                if (info.doMipflood && !info.isHDR) {
                     mipper.mipflood(dstMipImages);
                 }
                 
@@ -2292,6 +2825,7 @@ bool KramEncoder::createMipsFromChunks(
         }
         
         timerBuildMips.stop();
+        traceBuildMips.close();
         
         if (info.isVerbose) {
             KLOGI("Image", "Chunk %d source %d miplevels in %0.3fms\n",
@@ -2327,6 +2861,22 @@ bool KramEncoder::createMipsFromChunks(
                 }
             }
 
+            // explicit formats are lossless, and hdr isn't measured in 8-bit space
+            if (success && info.doMetrics &&
+                isBlockFormat(info.pixelFormat) && !isHdrFormat(info.pixelFormat)) {
+                ImageMetrics metrics;
+                metrics.chunk = chunk;
+                metrics.mipLevel = mipLevel;
+
+                if (computeMipMetrics(info, dstImageData,
+                                      outputTexture.data.data(), mipStorageSize, metrics)) {
+                    info.metrics.push_back(metrics);
+                }
+                else {
+                    KLOGW("Image", "metrics couldn't decode mipLevel %dx%d\n", w, h);
+                }
+            }
+
             // Write out the mip size on chunk 0, all other mips are this size since not supercompressed.
             // This throws off block alignment and gpu loading of ktx files from mmap.  I guess 3d textures
             // and arrays can then load entire level in a single call.
@@ -2375,14 +2925,164 @@ bool KramEncoder::createMipsFromChunks(
     return true;
 }
 
+// Classify a 4x4 block before encoding.  Constant blocks have an optimal
+// encoding that doesn't need an endpoint search, and counts of the other
+// traits are reported with -v to see how much of a texture is trivial.
+enum BlockTraits : uint32_t {
+    kBlockConstant = (1 << 0),
+    kBlockGray = (1 << 1),
+    kBlockOpaque = (1 << 2),
+    kBlockTwoColor = (1 << 3),
+};
+
+static uint32_t classifyBlock(const Color* pixels, int32_t count)
+{
+    const Color& c0 = pixels[0];
+
+    bool isGray = true;
+    bool isOpaque = true;
+    int32_t numColors = 1;
+    Color c1 = c0;
+
+    for (int32_t i = 0; i < count; ++i) {
+        const Color& c = pixels[i];
+        if (c.r != c.g || c.r != c.b) isGray = false;
+        if (c.a != 255) isOpaque = false;
+
+        if (numColors <= 2) {
+            bool isC0 = c.r == c0.r && c.g == c0.g && c.b == c0.b && c.a == c0.a;
+            if (!isC0) {
+                if (numColors == 1) {
+                    c1 = c;
+                    numColors = 2;
+                }
+                else if (!(c.r == c1.r && c.g == c1.g && c.b == c1.b && c.a == c1.a)) {
+                    numColors = 3;
+                }
+            }
+        }
+    }
+
+    uint32_t traits = 0;
+    if (numColors == 1) traits |= kBlockConstant;
+    if (numColors == 2) traits |= kBlockTwoColor;
+    if (isGray) traits |= kBlockGray;
+    if (isOpaque) traits |= kBlockOpaque;
+    return traits;
+}
+
+// BC4 block with both endpoints at the value and all selectors 0 reproduces it exactly.
+static void encodeBC4SolidBlock(uint8_t* dstBlock, uint8_t value)
+{
+    dstBlock[0] = value;
+    dstBlock[1] = value;
+    memset(dstBlock + 2, 0, 6);
+}
+
+// Runs encodeBlockRows on up to numThreads threads, or on this thread for 1.
+// Each call should pull the next row of blocks off of a shared counter until
+// there are none left, so that the work stays balanced.
+template <typename F>
+static void runBlockRows(int32_t numThreads, int32_t blocksY, F&& encodeBlockRows)
+{
+    numThreads = std::min(numThreads, blocksY);
+    if (numThreads <= 1) {
+        encodeBlockRows();
+    }
+    else {
+        // waits for all rows in the destructor
+        task_system system(numThreads);
+        for (int32_t i = 0; i < system.num_threads(); ++i) {
+            system.async_(encodeBlockRows);
+        }
+    }
+}
+
+#if COMPILE_COMP
+
+// Encodes from the float or half pixels when present, so hdr values aren't clamped
+// to 8-bit.  Each thread pulls the next row of blocks, and has its own encoder.
+static void encodeBC6H(const ImageInfo& info, const ImageData& mipImage, uint8_t* dstData)
+{
+    const int32_t blockDim = 4;
+    const int32_t blockSize = 16;
+
+    int32_t w = mipImage.width;
+    int32_t h = mipImage.height;
+    int32_t blocksX = (w + blockDim - 1) / blockDim;
+    int32_t blocksY = (h + blockDim - 1) / blockDim;
+
+    CMP_BC6H_BLOCK_PARAMETERS options;
+    options.isSigned = info.isSigned;
+
+    // More endpoint refinement barely changes the error, but searching more
+    // of the two region partitions does.  So the fast tier only searches the
+    // more common half of the partitions.
+    if (info.quality <= 50) {
+        options.quality = 0.01f;
+        options.maxPartitions = 16;
+    }
+    else {
+        options.quality = 0.05f;
+        options.maxPartitions = 32;
+    }
+
+    std::atomic<int32_t> nextBlockRow(0);
+
+    auto encodeBlockRows = [&]() {
+        BC6HBlockEncoder encoder(options);
+
+        for (int32_t by = nextBlockRow++; by < blocksY; by = nextBlockRow++) {
+            for (int32_t bx = 0; bx < blocksX; ++bx) {
+                // copy src to 4x4 clamping the edge pixels
+                float srcBlock[16][4];
+                for (int32_t i = 0; i < blockDim * blockDim; ++i) {
+                    int32_t xx = std::min(bx * blockDim + (i % blockDim), w - 1);
+                    int32_t yy = std::min(by * blockDim + (i / blockDim), h - 1);
+                    int32_t srcIndex = yy * w + xx;
+
+                    half4 src16;
+                    if (mipImage.pixelsFloat) {
+                        src16 = toHalf4(mipImage.pixelsFloat[srcIndex]);
+                    }
+                    else if (mipImage.pixelsHalf) {
+                        src16 = mipImage.pixelsHalf[srcIndex];
+                    }
+                    else {
+                        src16 = toHalf4(ColorToUnormFloat4(mipImage.pixels[srcIndex]));
+                    }
+
+                    srcBlock[i][0] = toBC6HChannel(src16.x, info.isSigned);
+                    srcBlock[i][1] = toBC6HChannel(src16.y, info.isSigned);
+                    srcBlock[i][2] = toBC6HChannel(src16.z, info.isSigned);
+                    srcBlock[i][3] = 0.0f;  // no alpha in bc6
+                }
+
+                uint8_t* dstBlock = &dstData[(by * blocksX + bx) * blockSize];
+                encoder.CompressBlock(srcBlock, dstBlock);
+            }
+        }
+    };
+
+    runBlockRows(info.numThreads, blocksY, encodeBlockRows);
+}
+
+#endif
+
+// texels of half mips converted to float at a time, fits on the stack
+static const int32_t kHalfConvertSpan = 256;
+
 bool KramEncoder::compressMipLevel(const ImageInfo& info, KTXImage& image,
                                    ImageData& mipImage, TextureData& outputTexture,
                                    int32_t mipStorageSize) const
 {
+    TraceScope traceScope("encodeMip", encoderName(info.textureEncoder));
+
     int32_t w = mipImage.width;
     int32_t h = mipImage.height;
 
     const Color* srcPixelData = mipImage.pixels;
+    const half4* srcPixelDataHalf4 = mipImage.pixelsHalf;
     const float4* srcPixelDataFloat4 = mipImage.pixelsFloat;
 
     // TODO: try to elim KTXImage passed into this
@@ -2431,11 +3131,16 @@ bool KramEncoder::compressMipLevel(const ImageInfo& info, KTXImage& image,
 
                 half* dst = (half*)outputTexture.data.data();
 
+                if (srcPixelDataHalf4 && count == 4) {
+                    memcpy(dst, srcPixelDataHalf4, w * h * sizeof(half4));
+                    break;
+                }
+
                 const float4* src = mipImage.pixelsFloat;
 
                 // assumes we don't need to align r16f rows to 4 bytes
                 for (int32_t i = 0, iEnd = w * h; i < iEnd; ++i) {
-                    half4 src16 = toHalf4(src[0]);
+                    half4 src16 = srcPixelDataHalf4 ? srcPixelDataHalf4[i] : toHalf4(src[i]);
 
                     switch (count) {
                         case 4:
@@ -2458,23 +3163,54 @@ bool KramEncoder::compressMipLevel(const ImageInfo& info, KTXImage& image,
 
                 float* dst = (float*)outputTexture.data.data();
 
-                const float4* src = mipImage.pixelsFloat;
+                // half sources convert a span of texels at a time
+                float4 srcSpan[kHalfConvertSpan];
 
                 for (int32_t i = 0, iEnd = w * h; i < iEnd; ++i) {
+                    const float4* src;
+                    if (srcPixelDataHalf4) {
+                        int32_t spanIndex = i % kHalfConvertSpan;
+                        if (spanIndex == 0) {
+                            toFloat4(&srcPixelDataHalf4[i], srcSpan, std::min(kHalfConvertSpan, iEnd - i));
+                        }
+                        src = &srcSpan[spanIndex];
+                    }
+                    else {
+                        // pixelsFloat is null when the mip is held as half
+                        src = &mipImage.pixelsFloat[i];
+                    }
+
                     switch (count) {
                         case 4:
-                            dst[count * i + 3] = src[i].w;
+                            dst[count * i + 3] = src->w;
                         case 3:
-                            dst[count * i + 2] = src[i].z;
+                            dst[count * i + 2] = src->z;
                         case 2:
-                            dst[count * i + 1] = src[i].y;
+                            dst[count * i + 1] = src->y;
                         case 1:
-                            dst[count * i + 0] = src[i].x;
+                            dst[count * i + 0] = src->x;
                     }
                 }
 
                 break;
             }
+            case MyMTLPixelFormatRG11B10Float:
+            case MyMTLPixelFormatRGB9E5Float: {
+                uint32_t* dst = (uint32_t*)outputTexture.data.data();
+
+                if (srcPixelDataHalf4) {
+                    float4 srcSpan[kHalfConvertSpan];
+                    for (int32_t i = 0, iEnd = w * h; i < iEnd; i += kHalfConvertSpan) {
+                        int32_t spanCount = std::min(kHalfConvertSpan, iEnd - i);
+                        toFloat4(&srcPixelDataHalf4[i], srcSpan, spanCount);
+                        packFloatTexels(info.pixelFormat, srcSpan, dst + i, spanCount);
+                    }
+                }
+                else {
+                    packFloatTexels(info.pixelFormat, mipImage.pixelsFloat, dst, w * h);
+                }
+                break;
+            }
             default:
                 return false;
                 break;
@@ -2555,9 +3291,8 @@ bool KramEncoder::compressMipLevel(const ImageInfo& info, KTXImage& image,
             imageEtc.SetVerboseOutput(info.isVerbose);
             Etc::Image::EncodingStatus status;
 
-            // TODO: have encoder setting to enable multipass
-            bool doSinglepass = true;  // || (effort == 100.0f); // problem is 100% quality also runs all passes
-            if (doSinglepass) {
+            // Note: 100% quality also runs all passes of multipass
+            if (!info.doEtcMultipass) {
                 // single pass iterates each block until done
                 status = imageEtc.EncodeSinglepass(effort, outputTexture.data.data());
             }
@@ -2565,8 +3300,9 @@ bool KramEncoder::compressMipLevel(const ImageInfo& info, KTXImage& image,
                 // multipass iterates all blocks once, then a percentage of the blocks with highest errors
                 // if that percentage isn't already reached in the first pass.  Below a certain block count
                 // all blocks are processed until done.  So only the largest mips have less quality.
+                // The blocks of each pass are spread across the threads.
                 float blockPercent = effort;
-                status = imageEtc.Encode(blockPercent, effort, outputTexture.data.data());
+                status = imageEtc.Encode(blockPercent, effort, outputTexture.data.data(), info.numThreads);
             }
 
             // all errors/warnings turned into asserts
@@ -2658,6 +3394,21 @@ bool KramEncoder::compressMipLevel(const ImageInfo& info, KTXImage& image,
 
             uint8_t* dstData = (uint8_t*)outputTexture.data.data();
 
+#if COMPILE_COMP
+            if (info.pixelFormat == MyMTLPixelFormatBC6H_RGBUfloat ||
+                info.pixelFormat == MyMTLPixelFormatBC6H_RGBFloat) {
+                encodeBC6H(info, mipImage, dstData);
+                return true;
+            }
+#endif
+
+            // stats on block classification
+            int32_t numBlocks = 0;
+            int32_t numConstantBlocks = 0;
+            int32_t numTwoColorBlocks = 0;
+            int32_t numGrayBlocks = 0;
+            int32_t numOpaqueBlocks = 0;
+
             const int32_t blockDim = 4;
             int32_t blocks_x = (w + blockDim - 1) / blockDim;
             //int32_t blocks_y = (h + blockDim - 1) / blockDim;
@@ -2703,17 +3454,35 @@ bool KramEncoder::compressMipLevel(const ImageInfo& info, KTXImage& image,
                     // could tie to quality parameter, high quality uses the two
                     // modes of bc3/4/5.
                     bool useHighQuality = true;
-                    
+
+                    uint32_t traits = classifyBlock(srcPixelCopyAsBlock, blockDim * blockDim);
+                    bool isConstant = (traits & kBlockConstant) != 0;
+
+                    numBlocks++;
+                    if (isConstant) numConstantBlocks++;
+                    if (traits & kBlockTwoColor) numTwoColorBlocks++;
+                    if (traits & kBlockGray) numGrayBlocks++;
+                    if (traits & kBlockOpaque) numOpaqueBlocks++;
+
+                    const Color& c0 = srcPixelCopyAsBlock[0];
+
                     switch (info.pixelFormat) {
                         case MyMTLPixelFormatBC1_RGBA:
                         case MyMTLPixelFormatBC1_RGBA_sRGB: {
-                            rgbcx::encode_bc1(bc1QualityLevel, dstBlock,
-                                              srcPixelCopy, false, false);
+                            if (isConstant)
+                                rgbcx::encode_bc1_solid_block(dstBlock, c0.r, c0.g, c0.b, false);
+                            else
+                                rgbcx::encode_bc1(bc1QualityLevel, dstBlock,
+                                                  srcPixelCopy, false, false);
                             break;
                         }
                         case MyMTLPixelFormatBC3_RGBA:
                         case MyMTLPixelFormatBC3_RGBA_sRGB: {
-                            if (useHighQuality)
+                            if (isConstant) {
+                                encodeBC4SolidBlock(dstBlock, c0.a);
+                                rgbcx::encode_bc1_solid_block(dstBlock + 8, c0.r, c0.g, c0.b, false);
+                            }
+                            else if (useHighQuality)
                                 rgbcx::encode_bc3_hq(bc3QualityLevel, dstBlock, srcPixelCopy);
                             else
                                 rgbcx::encode_bc3(bc3QualityLevel, dstBlock, srcPixelCopy);
@@ -2722,7 +3491,9 @@ bool KramEncoder::compressMipLevel(const ImageInfo& info, KTXImage& image,
 
                         case MyMTLPixelFormatBC4_RUnorm:
                         case MyMTLPixelFormatBC4_RSnorm: {
-                            if (useHighQuality)
+                            if (isConstant)
+                                encodeBC4SolidBlock(dstBlock, c0.r);
+                            else if (useHighQuality)
                                 rgbcx::encode_bc4_hq(dstBlock, srcPixelCopy);
                             else
                                 rgbcx::encode_bc4(dstBlock, srcPixelCopy);
@@ -2731,36 +3502,23 @@ bool KramEncoder::compressMipLevel(const ImageInfo& info, KTXImage& image,
 
                         case MyMTLPixelFormatBC5_RGUnorm:
                         case MyMTLPixelFormatBC5_RGSnorm: {
-                            if (useHighQuality)
+                            if (isConstant) {
+                                encodeBC4SolidBlock(dstBlock, c0.r);
+                                encodeBC4SolidBlock(dstBlock + 8, c0.g);
+                            }
+                            else if (useHighQuality)
                                 rgbcx::encode_bc5_hq(dstBlock, srcPixelCopy);
                             else
                                 rgbcx::encode_bc5(dstBlock, srcPixelCopy);
                             break;
                         }
 
-#if COMPILE_COMP
-                        case MyMTLPixelFormatBC6H_RGBUfloat:
-                        case MyMTLPixelFormatBC6H_RGBFloat: {
-                            CMP_BC6H_BLOCK_PARAMETERS options;
-                            options.isSigned = info.isSigned;
-                            
-                            BC6HBlockEncoder encoderCompressenator(options);
-                            
-                            // TODO: this needs HDR data
-                            float   srcPixelCopyFloat[16][4];
-                            for (int i = 0; i < 16; ++i) {
-                                srcPixelCopyFloat[i][0] = srcPixelCopy[i * 4 + 0];
-                                srcPixelCopyFloat[i][1] = srcPixelCopy[i * 4 + 1];
-                                srcPixelCopyFloat[i][2] = srcPixelCopy[i * 4 + 2];
-                                srcPixelCopyFloat[i][3] = 1.0f;
-                            }
-                            encoderCompressenator.CompressBlock(srcPixelCopyFloat, dstBlock);
-                            break;
-                        }
-#endif
                         case MyMTLPixelFormatBC7_RGBAUnorm:
                         case MyMTLPixelFormatBC7_RGBAUnorm_sRGB: {
-                            bc7enc_compress_block(dstBlock, srcPixelCopy, &bc7params);
+                            if (isConstant)
+                                bc7enc_compress_block_solid(dstBlock, (const color_rgba*)srcPixelCopy);
+                            else
+                                bc7enc_compress_block(dstBlock, srcPixelCopy, &bc7params);
 
                             //                            if (doPrintBlock) {
                             //                                printBCBlock(dstBlock, info.pixelFormat);
@@ -2774,7 +3532,13 @@ bool KramEncoder::compressMipLevel(const ImageInfo& info, KTXImage& image,
                 }
             }
 
-            // TODO: shouldn't set for bc6
+            if (info.isVerbose && numBlocks > 0) {
+                KLOGI("Image", "Blocks %d constant %d two-color %d gray %d opaque %d\n",
+                      numBlocks, numConstantBlocks, numTwoColorBlocks,
+                      numGrayBlocks, numOpaqueBlocks);
+            }
+
+            // bc6 returned above
             if (info.isSigned) {
                 doRemapSnormEndpoints = true;
             }
@@ -2862,9 +3626,20 @@ bool KramEncoder::compressMipLevel(const ImageInfo& info, KTXImage& image,
             }
 
             if (success) {
-                squish::CompressImage((const squish::u8*)srcPixelData, w, h,
-                                      outputTexture.data.data(), format, flags,
-                                      weights);
+                int32_t blocksY = (h + 3) / 4;
+                std::atomic<int32_t> nextBlockRow(0);
+
+                // the fit state is reused across all blocks of a thread
+                auto encodeBlockRows = [&]() {
+                    squish::BlockCompressor compressor(format, flags, weights);
+
+                    for (int32_t by = nextBlockRow++; by < blocksY; by = nextBlockRow++) {
+                        compressor.CompressBlockRows((const squish::u8*)srcPixelData, w, h,
+                                                     outputTexture.data.data(), by, by + 1);
+                    }
+                };
+
+                runBlockRows(info.numThreads, blocksY, encodeBlockRows);
 
                 if (info.isSigned) {
                     doRemapSnormEndpoints = true;
@@ -3013,8 +3788,11 @@ bool KramEncoder::compressMipLevel(const ImageInfo& info, KTXImage& image,
             //                preset = ASTCENC_PRE_EXHAUSTIVE;
             //            }
 
+            // picks the sse4.1/avx2 build of astcenc
+            const AstcencApi& astcenc = astcencApi();
+
             astcenc_config config;
-            astcenc_error error = astcenc_config_init(
+            astcenc_error error = astcenc.configInit(
                 profile, blockDims.x, blockDims.y, 1, quality, flags, &config);
             if (error != ASTCENC_SUCCESS) {
                 return false;
@@ -3055,8 +3833,7 @@ bool KramEncoder::compressMipLevel(const ImageInfo& info, KTXImage& image,
             //            config.tune_block_mode_limit =
             //            config.a_scale_radius =
 
-            // Note: this can accept fp16 src, but have already converted to
-            // float4
+            // hdr can be fp16 or fp32 src, ldr is 8-bit
             astcenc_image srcImage;
             srcImage.dim_x = w;
             srcImage.dim_y = h;
@@ -3066,7 +3843,11 @@ bool KramEncoder::compressMipLevel(const ImageInfo& info, KTXImage& image,
             // data is triple-pointer so it can work with 3d textures, but only
             // have 2d image
             // hacked the src pixel handling to only do slices, not a 3D texture
-            if (info.isHDR) {
+            if (info.isHDR && srcPixelDataHalf4) {
+                srcImage.data = (void**)&srcPixelDataHalf4;
+                srcImage.data_type = ASTCENC_TYPE_F16;
+            }
+            else if (info.isHDR) {
                 srcImage.data = (void**)&srcPixelDataFloat4;
                 srcImage.data_type = ASTCENC_TYPE_F32;
             }
@@ -3081,7 +3862,7 @@ bool KramEncoder::compressMipLevel(const ImageInfo& info, KTXImage& image,
 
             // could this be built once, and reused across all mips
             astcenc_context* codec_context = nullptr;
-            error = astcenc_context_alloc(&config, 1, &codec_context);
+            error = astcenc.contextAlloc(&config, 1, &codec_context);
             if (error != ASTCENC_SUCCESS) {
                 return false;
             }
@@ -3120,14 +3901,14 @@ bool KramEncoder::compressMipLevel(const ImageInfo& info, KTXImage& image,
                 gAstcenc_UniqueChannelsInPartitioning = 4;
             }
 #else
-            error = astcenc_compress_image(
+            error = astcenc.compressImage(
                 codec_context, &srcImage, &swizzleEncode,
                 outputTexture.data.data(), mipStorageSize,
                 0);  // threadIndex
 #endif
 
             // Or should this context only be freed after all mips?
-            astcenc_context_free(codec_context);
+            astcenc.contextFree(codec_context);
 
             if (error != ASTCENC_SUCCESS) {
                 return false;
@@ -61,8 +61,12 @@ public:
     int32_t height() const { return _height; }
 
     const vector<Color>& pixels() const { return _pixels; }
+    const vector<half4>& pixelsHalf() const { return _pixelsHalf; }
     const vector<float4>& pixelsFloat() const { return _pixelsFloat; }
 
+    // 16f sources stay half, and 32f/packed float sources are float
+    bool isHDR() const { return !_pixelsHalf.empty() || !_pixelsFloat.empty(); }
+
     // content analysis
     bool hasColor() const { return _hasColor; }
     bool hasAlpha() const { return _hasAlpha; }
@@ -80,7 +84,7 @@ public:
     void setChunksY(uint32_t chunksY) { _chunksY = chunksY; }
 
 private:
-    // convert r/rg/rgb to rgba, 16f -> 32f
+    // convert r/rg/rgb to rgba
     bool convertToFourChannel(const KTXImage& image, uint32_t mipNumber);
 
     // converts all to rgba8unorm
@@ -104,10 +108,11 @@ private:
     // track to fix Apple Finder previews that are always white background
     bool _hasBlackBackground = false;
     
-    // this is the entire strip data, float version can be passed for HDR
-    // sources always 4 channels RGBA for 8 and 32f data.  16f promoted to 32f.
+    // this is the entire strip data, half or float version can be passed for HDR
+    // sources always 4 channels RGBA.  Only one of these is filled in.
+    // 16f stays 16f, which is half the memory of 32f on large hdr sources.
     vector<Color> _pixels;
-    //vector<half4> _pixelsHalf; // TODO: add support to import fp16
+    vector<half4> _pixelsHalf;
     vector<float4> _pixelsFloat;
 
     uint32_t _chunksY = 0;
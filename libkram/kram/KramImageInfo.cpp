@@ -167,6 +167,14 @@ static MyMTLPixelFormat parseFormat(ImageInfoArgs& infoArgs)
         format = MyMTLPixelFormatRGBA32Float;
     }
 
+    // packed hdr formats, rgb only and no negative values
+    else if (isStringEqual(formatString, "rg11b10f")) {
+        format = MyMTLPixelFormatRG11B10Float;
+    }
+    else if (isStringEqual(formatString, "rgb9e5")) {
+        format = MyMTLPixelFormatRGB9E5Float;
+    }
+
     return format;
 }
 
@@ -415,6 +423,9 @@ static const MyMTLPixelFormat kEncodingFormatsExplicit[] =
         MyMTLPixelFormatR32Float,
         MyMTLPixelFormatRG32Float,
         MyMTLPixelFormatRGBA32Float,
+
+        MyMTLPixelFormatRG11B10Float,
+        MyMTLPixelFormatRGB9E5Float,
 };
 
 // better countof in C++11, https://www.g-truc.net/post-0708.html
@@ -816,6 +827,39 @@ bool validateTextureType(MyMTLTextureType textureType, int32_t& w, int32_t& h,
     return true;
 }
 
+// This works on float4 or half4 pixels, since it only moves channels around.
+template <typename T>
+static void swizzleTexturePixels(int32_t w, int32_t h, T* srcPixels,
+                                 const SwizzleIndex& swizzle, const T& constants)
+{
+    T c = constants;
+    for (int32_t y = 0; y < h; ++y) {
+        int32_t y0 = y * w;
+
+        for (int32_t x = 0; x < w; ++x) {
+            T& c0 = srcPixels[y0 + x];
+            const T& ci = c0;
+
+            // reorder, then writeback
+            // this doesn't copy over constants set outside loop
+            if (swizzle.index[0] >= 0) {
+                c[0] = ci[swizzle.index[0]];
+            }
+            if (swizzle.index[1] >= 0) {
+                c[1] = ci[swizzle.index[1]];
+            }
+            if (swizzle.index[2] >= 0) {
+                c[2] = ci[swizzle.index[2]];
+            }
+            if (swizzle.index[3] >= 0) {
+                c[3] = ci[swizzle.index[3]];
+            }
+
+            c0 = c;
+        }
+    }
+}
+
 // const member function, but it can change the srcPixels.
 void ImageInfo::swizzleTextureHDR(int32_t w, int32_t h, float4* srcPixelsFloat_,
                                   const char* swizzleText)
@@ -835,32 +879,26 @@ void ImageInfo::swizzleTextureHDR(int32_t w, int32_t h, float4* srcPixelsFloat_,
         }
     }
 
-    float4* srcPixelsFloat = (float4*)srcPixelsFloat_;
-    for (int32_t y = 0; y < h; ++y) {
-        int32_t y0 = y * w;
+    swizzleTexturePixels(w, h, srcPixelsFloat_, swizzle, c);
+}
 
-        for (int32_t x = 0; x < w; ++x) {
-            float4& c0 = srcPixelsFloat[y0 + x];
-            const float4& ci = c0;
+void ImageInfo::swizzleTextureHDR(int32_t w, int32_t h, half4* srcPixelsHalf_,
+                                  const char* swizzleText)
+{
+    SwizzleIndex swizzle = toSwizzleIndex(swizzleText);
 
-            // reorder, then writeback
-            // this doesn't copy over constants set outside loop
-            if (swizzle.index[0] >= 0) {
-                c.x = ci[swizzle.index[0]];
-            }
-            if (swizzle.index[1] >= 0) {
-                c.y = ci[swizzle.index[1]];
-            }
-            if (swizzle.index[2] >= 0) {
-                c.z = ci[swizzle.index[2]];
-            }
-            if (swizzle.index[3] >= 0) {
-                c.w = ci[swizzle.index[3]];
-            }
+    if (swizzle.index[0] == 0 && swizzle.index[1] == 1 && swizzle.index[2] == 2 && swizzle.index[3] == 3) {
+        return;
+    }
 
-            c0 = c;
+    float4 c = {0, 0, 0, 0};
+    for (int32_t i = 0; i < 4; ++i) {
+        if (swizzle.index[i] == -1) {
+            c[i] = 1.0f;
         }
     }
+
+    swizzleTexturePixels(w, h, srcPixelsHalf_, swizzle, toHalf4(c));
 }
 
 void ImageInfo::swizzleTextureLDR(int32_t w, int32_t h, Color* srcPixels_,
@@ -912,12 +950,11 @@ void ImageInfo::swizzleTextureLDR(int32_t w, int32_t h, Color* srcPixels_,
 
 //-------------------------
 
-void ImageInfo::updateImageTraitsHDR(int32_t w, int32_t h, const float4* srcPixels)
+// Compares channels of float4 or half4 pixels, half compares are exact too.
+template <typename T>
+static void updateImageTraitsPixels(int32_t w, int32_t h, const T* srcPixels, const T& opaque,
+                                    bool& hasColor, bool& hasAlpha)
 {
-    if (srcPixels == nullptr) {
-        return;
-    }
-
     // validate that image hasColor and isn't grayscale data
     if (hasColor) {
         hasColor = false;
@@ -927,7 +964,7 @@ void ImageInfo::updateImageTraitsHDR(int32_t w, int32_t h, const float4* srcPixe
             int32_t y0 = y * w;
 
             for (int32_t x = 0; x < w; ++x) {
-                const float4& c0 = srcPixels[y0 + x];
+                const T& c0 = srcPixels[y0 + x];
 
                 if (c0.x != c0.y || c0.x != c0.z) {
                     hasColor = true;
@@ -946,8 +983,8 @@ void ImageInfo::updateImageTraitsHDR(int32_t w, int32_t h, const float4* srcPixe
             int32_t y0 = y * w;
 
             for (int32_t x = 0; x < w; ++x) {
-                const float4& c0 = srcPixels[y0 + x];
-                if (c0.w != 1.0f) {
+                const T& c0 = srcPixels[y0 + x];
+                if (c0.w != opaque.w) {
                     hasAlpha = true;
                     break;
                 }
@@ -956,6 +993,24 @@ void ImageInfo::updateImageTraitsHDR(int32_t w, int32_t h, const float4* srcPixe
     }
 }
 
+void ImageInfo::updateImageTraitsHDR(int32_t w, int32_t h, const float4* srcPixels)
+{
+    if (srcPixels == nullptr) {
+        return;
+    }
+
+    updateImageTraitsPixels(w, h, srcPixels, float4m(1.0f), hasColor, hasAlpha);
+}
+
+void ImageInfo::updateImageTraitsHDR(int32_t w, int32_t h, const half4* srcPixels)
+{
+    if (srcPixels == nullptr) {
+        return;
+    }
+
+    updateImageTraitsPixels(w, h, srcPixels, toHalf4(float4m(1.0f)), hasColor, hasAlpha);
+}
+
 void ImageInfo::updateImageTraitsLDR(int32_t w, int32_t h, const Color* srcPixels)
 {
     if (srcPixels == nullptr) {
@@ -1037,8 +1092,11 @@ void ImageInfo::initWithArgs(const ImageInfoArgs& args)
     averageChannels = args.averageChannels;
 
     isVerbose = args.isVerbose;
+    doMetrics = args.doMetrics;
 
     quality = args.quality;
+    numThreads = args.numThreads;
+    doEtcMultipass = args.doEtcMultipass;
 
     // this is for height to normal, will convert .r to normal xy
     isHeight = args.isHeight;
@@ -1122,8 +1180,9 @@ void ImageInfo::initWithSourceImage(Image& sourceImage)
     int32_t h = sourceImage.height();
     Color* srcPixels = (Color*)sourceImage.pixels().data();
     float4* srcPixelsFloat = (float4*)sourceImage.pixelsFloat().data();
+    half4* srcPixelsHalf = (half4*)sourceImage.pixelsHalf().data();
 
-    isHDR = srcPixelsFloat != nullptr;
+    isHDR = sourceImage.isHDR();
 
     // transfer the chunk count, this was a ktx/2 import
     if (sourceImage.chunksY() > 0) {
@@ -1144,7 +1203,17 @@ void ImageInfo::initWithSourceImage(Image& sourceImage)
 
     // this will only work on 2d textures, since this is all pre-chunk
     if (isHeight) {
-        heightToNormals(w, h, srcPixelsFloat, srcPixels, heightScale, isWrap);
+        if (srcPixelsHalf) {
+            // normals are computed in float, then stored back to the half source
+            vector<float4> pixelsFloat;
+            pixelsFloat.resize(w * h);
+            toFloat4(srcPixelsHalf, pixelsFloat.data(), w * h);
+            heightToNormals(w, h, pixelsFloat.data(), srcPixels, heightScale, isWrap);
+            toHalf4(pixelsFloat.data(), srcPixelsHalf, w * h);
+        }
+        else {
+            heightToNormals(w, h, srcPixelsFloat, srcPixels, heightScale, isWrap);
+        }
     }
 
     // this updates hasColor/hasAlpha
@@ -1161,7 +1230,10 @@ void ImageInfo::initWithSourceImage(Image& sourceImage)
             hasAlpha = false;
         }
 
-        if (isHDR) {
+        if (srcPixelsHalf) {
+            swizzleTextureHDR(w, h, srcPixelsHalf, swizzleText.c_str());
+        }
+        else if (isHDR) {
             swizzleTextureHDR(w, h, srcPixelsFloat, swizzleText.c_str());
         }
         else {
@@ -1170,7 +1242,10 @@ void ImageInfo::initWithSourceImage(Image& sourceImage)
     }
 
     // this updates hasColor/hasAlpha by walking pixels
-    if (isHDR) {
+    if (srcPixelsHalf) {
+        updateImageTraitsHDR(w, h, srcPixelsHalf);
+    }
+    else if (isHDR) {
         updateImageTraitsHDR(w, h, srcPixelsFloat);
     }
     else {
@@ -49,6 +49,9 @@ public:
 
     int32_t quality = 49;  // may want float
 
+    // threads used to encode blocks of each mip, scripts already encode files in parallel
+    int32_t numThreads = 1;
+
     // ktx2 has a compression type and level
     KTX2Compressor compressor;
     bool isKTX2 = false;
@@ -57,6 +60,8 @@ public:
     bool doMipflood = false;
     bool isVerbose = false;
     bool doSDF = false;
+    bool doEtcMultipass = false;  // etcenc refines the blocks with the largest errors in passes
+    bool doMetrics = false;  // decode each mip and measure error vs. source
     
     bool isSourcePremultiplied = false; // skip further premul of src
     bool isPremultiplied = false;
@@ -96,6 +101,26 @@ public:
     int32_t sdfThreshold = 120;
 };
 
+// Error of an encoded mip vs. the pixels handed to the encoder, filled in when
+// doMetrics is set.  Measured in the stored 8-bit space, so srgb stays srgb.
+struct ImageMetrics {
+    int32_t chunk = 0;
+    int32_t mipLevel = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+    int32_t numChannels = 4;  // channels used in mseAll/psnrAll
+
+    float mse[4] = {};   // per channel rgba in 0-255 units
+    float psnr[4] = {};  // per channel in dB, capped at 99 when lossless
+    float mseAll = 0.0f;
+    float psnrAll = 0.0f;
+    float ssim = 0.0f;  // luma ssim over 8x8 windows
+
+    // only for normal maps, angle between source and decoded normal in degrees
+    float normalAngleAvg = 0.0f;
+    float normalAngleMax = 0.0f;
+};
+
 // preset data that contains all inputs about the encoding
 class ImageInfo {
 public:
@@ -108,6 +133,8 @@ public:
     // this makea input pixels non-const.
     static void swizzleTextureHDR(int32_t w, int32_t h, float4* srcPixelsFloat_,
                                   const char* swizzleText);
+    static void swizzleTextureHDR(int32_t w, int32_t h, half4* srcPixelsHalf_,
+                                  const char* swizzleText);
     static void swizzleTextureLDR(int32_t w, int32_t h, Color* srcPixels_,
                                   const char* swizzleText);
 
@@ -121,6 +148,8 @@ private:
     // this walks pixels for hasColor and hasAlpha if not already set to false
     void updateImageTraitsHDR(int32_t w, int32_t h,
                               const float4* srcPixelsFloat_);
+    void updateImageTraitsHDR(int32_t w, int32_t h,
+                              const half4* srcPixelsHalf_);
     void updateImageTraitsLDR(int32_t w, int32_t h, const Color* srcPixels_);
 
     void optimizeFormat();
@@ -157,9 +186,14 @@ public:
     bool doMipmaps = false;
     bool doMipflood = false;
     bool optimizeFormatForOpaque = false;
+    bool doEtcMultipass = false;
     
     bool isVerbose = false;
 
+    // filled in by the encoder for each chunk and mip when doMetrics is set
+    bool doMetrics = false;
+    vector<ImageMetrics> metrics;
+
     // compression format
     bool isASTC = false;
     bool isBC = false;
@@ -180,6 +214,7 @@ public:
     float heightScale = 1.0f;
 
     int32_t quality = 49;
+    int32_t numThreads = 1;
 
     int32_t mipMinSize = 1;
     int32_t mipMaxSize = 32 * 1024;
@@ -213,6 +248,9 @@ TexEncoder parseEncoder(const char* encoder);
 
 bool isEncoderAvailable(TexEncoder encoder);
 
+// encoder is available and can encode the format
+bool isSupportedFormat(TexEncoder encoder, MyMTLPixelFormat format);
+
 const char* encoderName(TexEncoder encoder);
 
 }  // namespace kram
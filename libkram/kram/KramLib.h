@@ -16,8 +16,10 @@
 #include "KramImage.h"
 #include "KramImageInfo.h"
 #include "KramLog.h"
+#include "KramMemory.h"
 #include "KramMipper.h"
 #include "KramMmapHelper.h"
 #include "KramSDFMipper.h"
 #include "KramTimer.h"
+#include "KramTrace.h"
 #include "KramZipHelper.h"
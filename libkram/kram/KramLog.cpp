@@ -9,7 +9,9 @@
 // for Win
 #include <stdarg.h>
 
+#include <atomic>
 #include <mutex>
+#include <thread>
 
 #if KRAM_WIN
 #include <windows.h>
@@ -18,6 +20,7 @@
 #endif
 
 #include "KramFmt.h"
+#include "KramTimer.h"
 #include "format.h" // really fmt/format.h
 
 namespace kram {
@@ -179,6 +182,39 @@ bool endsWith(const string& value, const string& ending)
     return true;
 }
 
+void appendJsonString(string& str, const char* text)
+{
+    str += '"';
+    for (const char* c = text; *c; ++c) {
+        switch (*c) {
+            case '"':
+                str += "\\\"";
+                break;
+            case '\\':
+                str += "\\\\";
+                break;
+            case '\n':
+                str += "\\n";
+                break;
+            case '\r':
+                str += "\\r";
+                break;
+            case '\t':
+                str += "\\t";
+                break;
+            default:
+                if ((uint8_t)*c < 0x20) {
+                    append_sprintf(str, "\\u%04x", (uint32_t)(uint8_t)*c);
+                }
+                else {
+                    str += *c;
+                }
+                break;
+        }
+    }
+    str += '"';
+}
+
 bool endsWithExtension(const char* str, const string& substring)
 {
     const char* search = strrchr(str, '.');
@@ -234,17 +270,323 @@ inline void OutputDebugStringU(LPCSTR lpOutputString, uint32_t len8)
 
 //----------------------------------
 
-static int32_t logMessageImpl(const char* group, int32_t logLevel,
-                          const char* file, int32_t line, const char* func,
-                          const char* fmt, const char* msg)
+// A formatted message, and the json line when that's enabled.
+struct LogRecord {
+    double timestamp = 0.0;
+    int32_t logLevel = LogLevelInfo;
+    const char* tag = "";
+    string text;
+    string json;
+};
+
+static FILE* gLogJsonFile = nullptr;
+
+static void writeLogRecord(const LogRecord& record)
 {
-    // TOOD: add any filtering up here, or before msg is built
+    const string& buffer = record.text;
+    int32_t logLevel = record.logLevel;
 
     // pipe to correct place, could even be file output
     FILE* fp = stdout;
     if (logLevel >= LogLevelWarning)
         fp = stderr;
 
+#if KRAM_WIN
+    if (::IsDebuggerPresent()) {
+        // TODO: split string up into multiple logs
+        // this is limited to 32K
+        // OutputDebugString(buffer.c_str());
+        
+        // This supports UTF8 strings by converting them to wide
+        OutputDebugStringU(buffer.c_str(), buffer.size());
+    }
+    else {
+        // avoid double print to debugger
+        fprintf(fp, "%s", buffer.c_str());
+    }
+#elif KRAM_ANDROID
+    AndroidLogLevel androidLogLevel = ANDROID_LOG_ERROR;
+    switch (logLevel) {
+        case LogLevelDebug:
+            androidLogLevel = ANDROID_LOG_DEBUG;
+            break;
+        case LogLevelInfo:
+            androidLogLevel = ANDROID_LOG_INFO;
+            break;
+
+        case LogLevelWarning:
+            androidLogLevel = ANDROID_LOG_WARNING;
+            break;
+        case LogLevelError:
+            androidLogLevel = ANDROID_LOG_ERROR;
+            break;
+    }
+    
+    // TODO: can also fix printf to work on Android
+    // but can't set log level like with this call, but no dump buffer limit
+    
+    // TODO: split string up into multiple logs
+    // this can only write 4K - 40? chars at time, don't use print it's 1023
+    __android_log_write(androidLogLevel, record.tag, buffer.c_str());
+#else
+    fprintf(fp, "%s", buffer.c_str());
+#endif
+
+
+    if (gLogJsonFile) {
+        fwrite(record.json.data(), 1, record.json.size(), gLogJsonFile);
+    }
+}
+
+// Each thread logs into its own single producer/single consumer ring of
+// records, so threads don't contend on a lock or stdio.  If the ring is full,
+// then the thread waits on the writer, so nothing is dropped.
+static const uint32_t kLogQueueSize = 256;
+
+class LogQueue {
+public:
+    LogQueue() { _records.resize(kLogQueueSize); }
+
+    void push(LogRecord& record)
+    {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        while (tail - _head.load(std::memory_order_acquire) >= kLogQueueSize) {
+            std::this_thread::yield();
+        }
+
+        _records[tail % kLogQueueSize] = std::move(record);
+        _tail.store(tail + 1, std::memory_order_release);
+    }
+
+    // only called from the writer thread
+    void pop(vector<LogRecord>& records)
+    {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        uint32_t tail = _tail.load(std::memory_order_acquire);
+        for (; head != tail; ++head) {
+            records.push_back(std::move(_records[head % kLogQueueSize]));
+        }
+        _head.store(head, std::memory_order_release);
+    }
+
+private:
+    vector<LogRecord> _records;
+    std::atomic<uint32_t> _head{0};
+    std::atomic<uint32_t> _tail{0};
+};
+
+// Queues outlive the threads, so the writer can still drain them.
+// Threads created later reuse the idle queues.  These are only locked
+// when a thread first logs, and when the writer looks for new queues.
+static std::mutex gLogQueueMutex;
+static vector<LogQueue*> gLogQueues;
+static vector<LogQueue*> gIdleLogQueues;
+
+static std::atomic<uint32_t> gLogThreadCounter(0);
+
+class LogQueueHolder {
+public:
+    ~LogQueueHolder()
+    {
+        if (_queue) {
+            lock_guard<std::mutex> lock(gLogQueueMutex);
+            gIdleLogQueues.push_back(_queue);
+        }
+    }
+
+    LogQueue* queue()
+    {
+        if (!_queue) {
+            lock_guard<std::mutex> lock(gLogQueueMutex);
+            if (!gIdleLogQueues.empty()) {
+                _queue = gIdleLogQueues.back();
+                gIdleLogQueues.pop_back();
+            }
+            else {
+                _queue = new LogQueue();
+                gLogQueues.push_back(_queue);
+            }
+        }
+        return _queue;
+    }
+
+    uint32_t threadIndex()
+    {
+        if (_threadIndex == 0) {
+            _threadIndex = ++gLogThreadCounter;
+        }
+        return _threadIndex;
+    }
+
+private:
+    LogQueue* _queue = nullptr;
+    uint32_t _threadIndex = 0;
+};
+
+static thread_local LogQueueHolder gLogQueueHolder;
+
+static std::atomic<bool> gIsLogAsync(false);
+static std::atomic<bool> gIsLogWriterStopping(false);
+static std::thread gLogWriterThread;
+
+static void logWriterThread()
+{
+    vector<LogQueue*> queues;
+    vector<LogRecord> records;
+
+    while (true) {
+        // producers are done once this is set, so one more pass drains them
+        bool isStopping = gIsLogWriterStopping;
+
+        {
+            lock_guard<std::mutex> lock(gLogQueueMutex);
+            queues = gLogQueues;
+        }
+
+        for (LogQueue* queue : queues) {
+            queue->pop(records);
+        }
+
+        if (records.empty()) {
+            if (isStopping) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        // interleave the threads by when the messages were logged
+        std::stable_sort(records.begin(), records.end(), [](const LogRecord& lhs, const LogRecord& rhs) {
+            return lhs.timestamp < rhs.timestamp;
+        });
+
+        for (const LogRecord& record : records) {
+            writeLogRecord(record);
+        }
+        records.clear();
+    }
+
+    fflush(stdout);
+    if (gLogJsonFile) {
+        fflush(gLogJsonFile);
+    }
+}
+
+// Nested scripts start and stop async output too, so only the outermost pair
+// starts and joins the writer.
+static std::mutex gLogAsyncMutex;
+static uint32_t gLogAsyncCount = 0;
+
+void logStartAsync()
+{
+    lock_guard<std::mutex> lock(gLogAsyncMutex);
+
+    if (gLogAsyncCount++ > 0) {
+        return;
+    }
+
+    gIsLogWriterStopping = false;
+    gLogWriterThread = std::thread(logWriterThread);
+    gIsLogAsync = true;
+}
+
+void logStopAsync()
+{
+    lock_guard<std::mutex> lock(gLogAsyncMutex);
+
+    if (gLogAsyncCount == 0 || --gLogAsyncCount > 0) {
+        return;
+    }
+
+    gIsLogAsync = false;
+    gIsLogWriterStopping = true;
+    gLogWriterThread.join();
+}
+
+bool setLogJsonFile(const char* filename)
+{
+    mylock lock(gLogLock);
+
+    if (gLogJsonFile) {
+        fclose(gLogJsonFile);
+        gLogJsonFile = nullptr;
+    }
+
+    if (filename) {
+        gLogJsonFile = fopen(filename, "w");
+        if (!gLogJsonFile) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static thread_local const char* gLogCommand = nullptr;
+static thread_local const char* gLogFilename = nullptr;
+
+LogContextScope::LogContextScope(const char* command, const char* filename)
+    : _command(gLogCommand), _filename(gLogFilename)
+{
+    gLogCommand = command;
+    gLogFilename = filename;
+}
+
+LogContextScope::~LogContextScope()
+{
+    gLogCommand = _command;
+    gLogFilename = _filename;
+}
+
+static void appendLogJson(LogRecord& record, const char* group,
+                          const char* file, int32_t line, const char* msg)
+{
+    static const char* levelNames[] = {"debug", "info", "warning", "error"};
+
+    string& json = record.json;
+    append_sprintf(json, "{\"ms\":%.3f,\"level\":\"%s\",\"thread\":%u",
+                   record.timestamp * 1e3, levelNames[record.logLevel & 3],
+                   gLogQueueHolder.threadIndex());
+
+    json += ",\"group\":";
+    appendJsonString(json, group);
+
+    if (gLogCommand) {
+        json += ",\"command\":";
+        appendJsonString(json, gLogCommand);
+    }
+    if (gLogFilename) {
+        json += ",\"file\":";
+        appendJsonString(json, gLogFilename);
+    }
+    if (file) {
+        // shorten filename
+        const char* filename = strrchr(file, '/');
+        if (!filename) {
+            filename = strrchr(file, '\\');
+        }
+        filename = filename ? filename + 1 : file;
+
+        json += ",\"source\":";
+        appendJsonString(json, filename);
+        append_sprintf(json, ",\"line\":%d", line);
+    }
+
+    // strip the trailing newline of the message
+    string text = msg;
+    while (!text.empty() && text.back() == '\n') {
+        text.pop_back();
+    }
+    json += ",\"msg\":";
+    appendJsonString(json, text.c_str());
+    json += "}\n";
+}
+
+static int32_t logMessageImpl(const char* group, int32_t logLevel,
+                          const char* file, int32_t line, const char* func,
+                          const char* fmt, const char* msg)
+{
+    // TOOD: add any filtering up here, or before msg is built
+
     // see if newline required
     int32_t len = (int32_t)strlen(fmt);
     bool needsNewline = false;
@@ -318,61 +660,37 @@ static int32_t logMessageImpl(const char* group, int32_t logLevel,
             break;
     }
 
-    // stdout isn't thread safe, so to prevent mixed output put this under mutex
-    mylock lock(gLogLock);
-
     // this means caller needs to know all errors to display in the hud
     if (gIsErrorLogCapture && logLevel == LogLevelError) {
+        mylock lock(gLogLock);
         gErrorLogCaptureText += msg;
         if (needsNewline) {
             gErrorLogCaptureText += "\n";
         }
     }
 
+    LogRecord record;
+    record.timestamp = currentTimestamp();
+    record.logLevel = logLevel;
+    record.tag = tag;
+
     // format into a buffer
-    static string buffer;
-    sprintf(buffer, "%s%s%s%s%s%s", tag, groupString, space, msg, needsNewline ? "\n" : "", fileLineFunc.c_str());
-    
-#if KRAM_WIN
-    if (::IsDebuggerPresent()) {
-        // TODO: split string up into multiple logs
-        // this is limited to 32K
-        // OutputDebugString(buffer.c_str());
-        
-        // This supports UTF8 strings by converting them to wide
-        OutputDebugStringU(buffer.c_str(), buffer.size());
-    }
-    else {
-        // avoid double print to debugger
-        fprintf(fp, "%s", buffer.c_str());
+    sprintf(record.text, "%s%s%s%s%s%s", tag, groupString, space, msg, needsNewline ? "\n" : "", fileLineFunc.c_str());
+
+    if (gLogJsonFile) {
+        appendLogJson(record, group, file, line, msg);
     }
-#elif KRAM_ANDROID
-    AndroidLogLevel androidLogLevel = ANDROID_LOG_ERROR;
-    switch (logLevel) {
-        case LogLevelDebug:
-            androidLogLevel = ANDROID_LOG_DEBUG;
-            break;
-        case LogLevelInfo:
-            androidLogLevel = ANDROID_LOG_INFO;
-            break;
 
-        case LogLevelWarning:
-            androidLogLevel = ANDROID_LOG_WARNING;
-            break;
-        case LogLevelError:
-            androidLogLevel = ANDROID_LOG_ERROR;
-            break;
+    if (gIsLogAsync) {
+        // no lock, the writer thread outputs the record
+        LogQueue* queue = gLogQueueHolder.queue();
+        queue->push(record);
+    }
+    else {
+        // stdout isn't thread safe, so to prevent mixed output put this under mutex
+        mylock lock(gLogLock);
+        writeLogRecord(record);
     }
-    
-    // TODO: can also fix printf to work on Android
-    // but can't set log level like with this call, but no dump buffer limit
-    
-    // TODO: split string up into multiple logs
-    // this can only write 4K - 40? chars at time, don't use print it's 1023
-    __android_log_write(androidLogLevel, tag, buffer.c_str());
-#else
-    fprintf(fp, "%s", buffer.c_str());
-#endif
 
     return 0;  // reserved for later
 }
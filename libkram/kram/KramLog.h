@@ -46,6 +46,30 @@ extern int32_t logMessage(const char* group, int32_t logLevel,
 #define KLOGW(group, fmt, ...) logMessage(group, kram::LogLevelWarning, __FILE__, __LINE__, __FUNCTION__, fmt, ##__VA_ARGS__)
 #define KLOGE(group, fmt, ...) logMessage(group, kram::LogLevelError, __FILE__, __LINE__, __FUNCTION__, fmt, ##__VA_ARGS__)
 
+// Log output is written on the calling thread under a lock until logStartAsync.
+// Then each thread queues its formatted messages without locking, and one
+// writer thread outputs them.  Call logStopAsync to flush once the other
+// threads are done logging.  These calls nest, and only the outermost stop flushes.
+void logStartAsync();
+void logStopAsync();
+
+// Also writes each message as a line of json to filename, nullptr closes the file.
+// The lines have ms, level, thread, group, command, file, source, line, and msg.
+// Set this before logStartAsync.
+bool setLogJsonFile(const char* filename);
+
+// Tags the json lines logged on this thread with the command and the file
+// that it processes.  The strings must last until the scope ends.
+class LogContextScope {
+public:
+    LogContextScope(const char* command, const char* filename);
+    ~LogContextScope();
+
+private:
+    const char* _command;
+    const char* _filename;
+};
+
 // TODO: move to Strings.h
 using namespace NAMESPACE_STL;
 
@@ -73,4 +97,7 @@ bool endsWithExtension(const char* str, const string& substring);
 // https://stackoverflow.com/questions/874134/find-out-if-string-ends-with-another-string-in-c
 bool endsWith(const string& value, const string& ending);
 
+// escape and quote a string for json output
+void appendJsonString(string& str, const char* text);
+
 }  // namespace kram
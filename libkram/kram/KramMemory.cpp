@@ -0,0 +1,133 @@
+// kram - Copyright 2020-2023 by Alec Miller. - MIT License
+// The license and copyright notice shall be included
+// in all copies or substantial portions of the Software.
+
+#include "KramMemory.h"
+
+#include <atomic>
+
+namespace kram {
+
+using namespace NAMESPACE_STL;
+
+// These are constant initialized, since allocations can occur before main.
+static std::atomic<int64_t> gCurrentBytes(0);
+static std::atomic<int64_t> gPeakBytes(0);
+static std::atomic<int32_t> gMemoryTrackingCount(0);
+
+static thread_local MemoryScope* gMemoryScope = nullptr;
+
+void memoryAllocated(size_t size)
+{
+    int64_t currentBytes = (gCurrentBytes += (int64_t)size);
+
+    // only raise the peak
+    int64_t peakBytes = gPeakBytes.load(std::memory_order_relaxed);
+    while (currentBytes > peakBytes &&
+           !gPeakBytes.compare_exchange_weak(peakBytes, currentBytes, std::memory_order_relaxed)) {
+    }
+
+    // all the open scopes on this thread see the allocation
+    for (MemoryScope* scope = gMemoryScope; scope; scope = scope->_parent) {
+        scope->_currentBytes += (int64_t)size;
+        if (scope->_peakBytes < scope->_currentBytes) {
+            scope->_peakBytes = scope->_currentBytes;
+        }
+    }
+}
+
+void memoryFreed(size_t size)
+{
+    gCurrentBytes -= (int64_t)size;
+
+    for (MemoryScope* scope = gMemoryScope; scope; scope = scope->_parent) {
+        scope->_currentBytes -= (int64_t)size;
+    }
+}
+
+void memoryStartTracking()
+{
+    gMemoryTrackingCount++;
+}
+
+void memoryStopTracking()
+{
+    gMemoryTrackingCount--;
+}
+
+bool isMemoryTracking()
+{
+    return gMemoryTrackingCount.load(std::memory_order_relaxed) > 0;
+}
+
+uint64_t memoryCurrentBytes()
+{
+    int64_t currentBytes = gCurrentBytes;
+    return currentBytes > 0 ? (uint64_t)currentBytes : 0;
+}
+
+uint64_t memoryPeakBytes()
+{
+    return (uint64_t)gPeakBytes.load();
+}
+
+MemoryScope::MemoryScope()
+    : _parent(gMemoryScope)
+{
+    gMemoryScope = this;
+}
+
+MemoryScope::~MemoryScope()
+{
+    gMemoryScope = _parent;
+}
+
+void MemoryBudget::acquire(uint64_t bytes)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (_usedBytes > 0 && _usedBytes + bytes > _maxBytes) {
+        _released.wait(lock);
+    }
+    _usedBytes += bytes;
+}
+
+void MemoryBudget::release(uint64_t bytes)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _usedBytes -= bytes;
+    }
+    _released.notify_all();
+}
+
+uint64_t parseMemorySize(const char* text)
+{
+    char* suffix = nullptr;
+    double size = strtod(text, &suffix);
+    if (suffix == text || size <= 0.0) {
+        return 0;
+    }
+
+    switch (*suffix) {
+        case 0:
+            break;
+        case 'k':
+        case 'K':
+            size *= 1024.0;
+            break;
+        case 'm':
+        case 'M':
+            size *= 1024.0 * 1024.0;
+            break;
+        case 'g':
+        case 'G':
+            size *= 1024.0 * 1024.0 * 1024.0;
+            break;
+        default:
+            return 0;
+    }
+
+    return (uint64_t)size;
+}
+
+}  // namespace kram
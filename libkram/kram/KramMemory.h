@@ -0,0 +1,71 @@
+// kram - Copyright 2020-2023 by Alec Miller. - MIT License
+// The license and copyright notice shall be included
+// in all copies or substantial portions of the Software.
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+//#include "KramConfig.h"
+
+namespace kram {
+
+// The app's operator new/delete call these with the size of each allocation
+// (see kramc/KramMain.cpp).  Without those hooks all of the counts stay 0.
+// The hooks only count while tracking is started, and then call memoryFreed
+// for just the allocations that were counted.
+void memoryAllocated(size_t size);
+void memoryFreed(size_t size);
+
+// Tracking is off by default, so untracked allocations only pay for a relaxed
+// load.  These calls nest, and tracking stops with the outermost stop.
+void memoryStartTracking();
+void memoryStopTracking();
+bool isMemoryTracking();
+
+// bytes currently allocated, and the most allocated at once across the process
+uint64_t memoryCurrentBytes();
+uint64_t memoryPeakBytes();
+
+// Tracks the peak bytes allocated on this thread while the scope is open.
+// A script command runs on one thread, and that's where the source, mips,
+// and output of an encode are allocated, so this is the peak of the command.
+// Allocations on other threads (f.e. the encoder threads) aren't counted.
+class MemoryScope {
+public:
+    MemoryScope();
+    ~MemoryScope();
+
+    uint64_t peakBytes() const { return _peakBytes > 0 ? (uint64_t)_peakBytes : 0; }
+
+private:
+    friend void memoryAllocated(size_t size);
+    friend void memoryFreed(size_t size);
+
+    MemoryScope* _parent;
+    int64_t _currentBytes = 0;  // can go negative if freeing older allocations
+    int64_t _peakBytes = 0;
+};
+
+// Limits the bytes of work that are running at once.  Acquire blocks until the
+// bytes fit under the budget, but always lets work through if nothing is running,
+// so a single large job can still exceed the budget.
+class MemoryBudget {
+public:
+    MemoryBudget(uint64_t maxBytes) : _maxBytes(maxBytes) {}
+
+    void acquire(uint64_t bytes);
+    void release(uint64_t bytes);
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _released;
+    uint64_t _maxBytes;
+    uint64_t _usedBytes = 0;
+};
+
+// parse "512M", "16G", "4096K", or plain bytes, returns 0 if invalid
+uint64_t parseMemorySize(const char* text);
+
+}  // namespace kram
@@ -0,0 +1,203 @@
+// kram - Copyright 2020-2023 by Alec Miller. - MIT License
+// The license and copyright notice shall be included
+// in all copies or substantial portions of the Software.
+
+#include "KramTrace.h"
+
+#include <atomic>
+#include <mutex>
+
+#include "KramFileHelper.h"
+#include "KramLog.h"
+#include "KramTimer.h"
+
+namespace kram {
+
+using namespace NAMESPACE_STL;
+
+struct TraceEvent {
+    double startTime;
+    double duration;
+    const char* name;
+    char detail[48];
+};
+
+// 16k events is about 1MB per thread, and a script command only records a few events per mip
+static const uint32_t kTraceEventsPerThread = 16 * 1024;
+
+struct TraceBuffer {
+    vector<TraceEvent> events;
+    uint32_t eventCount = 0;  // wraps around events once full
+    uint32_t threadIndex = 0;
+};
+
+static std::atomic<bool> gIsTraceEnabled(false);
+
+// Buffers outlive the threads, since task_system threads only last as long as the
+// task_system.  Threads created later reuse the idle buffers, so the count stays
+// at the most threads that ran at once.  These are only locked when a thread
+// records its first event.
+static std::mutex gTraceMutex;
+static vector<TraceBuffer*> gTraceBuffers;
+static vector<TraceBuffer*> gIdleTraceBuffers;
+
+class TraceBufferHolder {
+public:
+    ~TraceBufferHolder()
+    {
+        if (_buffer) {
+            lock_guard<std::mutex> lock(gTraceMutex);
+            gIdleTraceBuffers.push_back(_buffer);
+        }
+    }
+
+    TraceBuffer* buffer()
+    {
+        if (!_buffer) {
+            lock_guard<std::mutex> lock(gTraceMutex);
+            if (!gIdleTraceBuffers.empty()) {
+                _buffer = gIdleTraceBuffers.back();
+                gIdleTraceBuffers.pop_back();
+            }
+            else {
+                _buffer = new TraceBuffer();
+                _buffer->events.resize(kTraceEventsPerThread);
+                _buffer->threadIndex = (uint32_t)gTraceBuffers.size();
+                gTraceBuffers.push_back(_buffer);
+            }
+        }
+        return _buffer;
+    }
+
+private:
+    TraceBuffer* _buffer = nullptr;
+};
+
+static thread_local TraceBufferHolder gTraceBufferHolder;
+
+void traceStart()
+{
+    lock_guard<std::mutex> lock(gTraceMutex);
+    for (TraceBuffer* buffer : gTraceBuffers) {
+        buffer->eventCount = 0;
+    }
+    gIsTraceEnabled = true;
+}
+
+bool isTraceEnabled()
+{
+    return gIsTraceEnabled;
+}
+
+TraceScope::TraceScope(const char* name, const char* detail)
+    : _name(name), _detail(detail), _startTime(0.0)
+{
+    if (gIsTraceEnabled) {
+        _startTime = currentTimestamp();
+    }
+    else {
+        _name = nullptr;
+    }
+}
+
+TraceScope::~TraceScope()
+{
+    close();
+}
+
+void TraceScope::close()
+{
+    if (!_name || !gIsTraceEnabled) {
+        return;
+    }
+
+    TraceBuffer* buffer = gTraceBufferHolder.buffer();
+    TraceEvent& event = buffer->events[buffer->eventCount % kTraceEventsPerThread];
+    buffer->eventCount++;
+
+    event.startTime = _startTime;
+    event.duration = currentTimestamp() - _startTime;
+    event.name = _name;
+
+    // keep the end of long details, since that's the filename of a path
+    event.detail[0] = 0;
+    if (_detail) {
+        const char* detail = _detail;
+        size_t detailLength = strlen(detail);
+        if (detailLength >= sizeof(event.detail)) {
+            detail += detailLength - (sizeof(event.detail) - 1);
+            detailLength = sizeof(event.detail) - 1;
+        }
+        memcpy(event.detail, detail, detailLength + 1);
+    }
+
+    _name = nullptr;
+}
+
+bool traceStopAndWrite(const char* filename)
+{
+    gIsTraceEnabled = false;
+
+    FileHelper fileHelper;
+    if (!fileHelper.open(filename, "w+b")) {
+        KLOGE("Kram", "trace couldn't open %s", filename);
+        return false;
+    }
+
+    // Chrome trace format, with complete events in microseconds.
+    // Write out each thread's events, since all of them can be large.
+    string text;
+    text += "{\"traceEvents\":[\n";
+
+    uint32_t numEvents = 0;
+    uint32_t numDroppedEvents = 0;
+    bool success = true;
+    {
+        lock_guard<std::mutex> lock(gTraceMutex);
+        for (const TraceBuffer* buffer : gTraceBuffers) {
+            uint32_t eventCount = buffer->eventCount;
+            uint32_t firstEvent = 0;
+            if (eventCount > kTraceEventsPerThread) {
+                firstEvent = eventCount - kTraceEventsPerThread;
+                numDroppedEvents += firstEvent;
+            }
+
+            for (uint32_t i = firstEvent; i < eventCount; ++i) {
+                const TraceEvent& event = buffer->events[i % kTraceEventsPerThread];
+
+                if (numEvents++ > 0) {
+                    text += ",\n";
+                }
+
+                append_sprintf(text, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.1f,\"dur\":%.1f",
+                               event.name, buffer->threadIndex,
+                               event.startTime * 1e6, event.duration * 1e6);
+                if (event.detail[0]) {
+                    text += ",\"args\":{\"detail\":";
+                    appendJsonString(text, event.detail);
+                    text += "}";
+                }
+                text += "}";
+            }
+
+            success = success && fileHelper.write((const uint8_t*)text.data(), text.size());
+            text.clear();
+        }
+    }
+
+    text += "\n]}\n";
+    success = success && fileHelper.write((const uint8_t*)text.data(), text.size());
+
+    if (!success) {
+        KLOGE("Kram", "trace couldn't write %s", filename);
+        return false;
+    }
+
+    if (numDroppedEvents > 0) {
+        KLOGW("Kram", "trace dropped %u oldest events", numDroppedEvents);
+    }
+
+    return true;
+}
+
+}  // namespace kram
@@ -0,0 +1,43 @@
+// kram - Copyright 2020-2023 by Alec Miller. - MIT License
+// The license and copyright notice shall be included
+// in all copies or substantial portions of the Software.
+
+#pragma once
+
+//#include "KramConfig.h"
+
+namespace kram {
+
+// Records timed scopes from any thread, and writes them out as a Chrome trace
+// that chrome://tracing or ui.perfetto.dev can display.  Each thread records into
+// its own ring buffer, so there's no lock per event.  Once a buffer fills,
+// the oldest events of that thread are overwritten.  Nothing is recorded until
+// traceStart is called, so the scopes can stay in the code.
+
+// Clears any old events and starts recording.
+void traceStart();
+
+// Stops recording, and writes the events to filename as json.  Call once the threads
+// that recorded events are done (f.e. after task_system shuts down).
+bool traceStopAndWrite(const char* filename);
+
+bool isTraceEnabled();
+
+// Records a complete event from construction to destruction.  The name must
+// be a string literal.  The detail must last until the scope closes, and then
+// it's copied (and truncated) into the event.
+class TraceScope {
+public:
+    TraceScope(const char* name, const char* detail = nullptr);
+    ~TraceScope();
+
+    // records the event before the end of the scope
+    void close();
+
+private:
+    const char* _name;
+    const char* _detail;
+    double _startTime;
+};
+
+}  // namespace kram
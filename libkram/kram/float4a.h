@@ -180,6 +180,11 @@ public:
     explicit float4(tType val) { reg = val; }
     float4(float xx, float yy, float zz, float ww) { reg = _mm_setr_ps(xx, yy, zz, ww); }
     float4(const float4& val) { reg = val.reg; }
+    float4& operator=(const float4& val)
+    {
+        reg = val.reg;
+        return *this;
+    }
 
     union {
         tType reg;
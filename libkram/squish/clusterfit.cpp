@@ -32,7 +32,13 @@
 namespace squish {
 
 ClusterFit::ClusterFit( ColourSet const* colours, int format, int flags, float const*  metric ) 
-  : ColourFit( colours, format, flags )
+  : ClusterFit( format, flags, metric )
+{
+	Init( colours );
+}
+
+ClusterFit::ClusterFit( int format, int flags, float const* metric )
+  : ColourFit( NULL, format, flags )
 {
 	// set the iteration count
 	m_iterationCount = ( m_flags & kColourIterativeClusterFit ) ? kMaxIterations : 1;
@@ -42,6 +48,11 @@ ClusterFit::ClusterFit( ColourSet const* colours, int format, int flags, float c
 		m_metric = Vec4( makeVec4(metric[0], metric[1], metric[2], 1.0f ));
 	else
 		m_metric = VEC4_CONST( 1.0f );	
+}
+
+void ClusterFit::Init( ColourSet const* colours )
+{
+	SetColours( colours );
 
 	// initialise the best error
 	m_besterror = VEC4_CONST( FLT_MAX );
@@ -37,6 +37,10 @@ class ClusterFit : public ColourFit
 {
 public:
 	ClusterFit( ColourSet const* colours, int format, int flags, float const* metric );
+
+	//! Reusable fit, call Init for each block.
+	ClusterFit( int format, int flags, float const* metric );
+	void Init( ColourSet const* colours );
 	
 private:
 	bool ConstructOrdering( Vec3 const& axis, int iteration );
@@ -41,6 +41,9 @@ public:
 	ColourFit( ColourSet const* colours, int format, int flags );
 	virtual ~ColourFit();
 
+	//! Sets the colours to fit.  Derived fits redo their per-block setup in Init.
+	void SetColours( ColourSet const* colours ) { m_colours = colours; }
+
 	void Compress( void* block );
 
 protected:
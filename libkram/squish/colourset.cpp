@@ -28,9 +28,15 @@
 namespace squish {
 
 ColourSet::ColourSet( u8 const* rgba, int mask, int format, int flags )
-  : m_count( 0 ), 
-	m_transparent( false )
 {
+	Init( rgba, mask, format, flags );
+}
+
+void ColourSet::Init( u8 const* rgba, int mask, int format, int flags )
+{
+	m_count = 0;
+	m_transparent = false;
+
 	// check the compression mode for dxt1
 	bool isBC1 = format == kBC1;
 	bool weightByAlpha = ( ( flags & kWeightColourByAlpha ) != 0 );
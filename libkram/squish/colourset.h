@@ -38,6 +38,10 @@ class ColourSet
 public:
 	ColourSet( u8 const* rgba, int mask, int format, int flags );
 
+	//! Reusable set, call Init for each block.
+	ColourSet() : m_count( 0 ), m_transparent( false ) {}
+	void Init( u8 const* rgba, int mask, int format, int flags );
+
 	int GetCount() const { return m_count; }
 	Vec3 const* GetPoints() const { return m_points; }
 	float const* GetWeights() const { return m_weights; }
@@ -31,13 +31,24 @@
 namespace squish {
 
 RangeFit::RangeFit( ColourSet const* colours, int format, int flags, float const* metric )
-  : ColourFit( colours, format, flags )
+  : RangeFit( format, flags, metric )
+{
+	Init( colours );
+}
+
+RangeFit::RangeFit( int format, int flags, float const* metric )
+  : ColourFit( NULL, format, flags )
 {
 	// initialise the metric (old perceptual = 0.2126f, 0.7152f, 0.0722f)
 	if( metric )
 		m_metric = Vec3( metric[0], metric[1], metric[2] );
 	else
 		m_metric = Vec3( 1.0f );	
+}
+
+void RangeFit::Init( ColourSet const* colours )
+{
+	SetColours( colours );
 
 	// initialise the best error
 	m_besterror = FLT_MAX;
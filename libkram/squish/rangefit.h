@@ -38,6 +38,10 @@ class RangeFit : public ColourFit
 {
 public:
 	RangeFit( ColourSet const* colours, int format, int flags, float const* metric );
+
+	//! Reusable fit, call Init for each block.
+	RangeFit( int format, int flags, float const* metric );
+	void Init( ColourSet const* colours );
 	
 private:
 	virtual void Compress3( void* block );
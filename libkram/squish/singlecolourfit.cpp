@@ -59,8 +59,20 @@ static int FloatToInt( float a, int limit )
 }
 
 SingleColourFit::SingleColourFit( ColourSet const* colours, int format, int flags )
-  : ColourFit( colours, format, flags )
+  : SingleColourFit( format, flags )
 {
+	Init( colours );
+}
+
+SingleColourFit::SingleColourFit( int format, int flags )
+  : ColourFit( NULL, format, flags )
+{
+}
+
+void SingleColourFit::Init( ColourSet const* colours )
+{
+	SetColours( colours );
+
 	// grab the single colour
 	Vec3 const* values = m_colours->GetPoints();
 	m_colour[0] = ( u8 )FloatToInt( 255.0f*values->X(), 255 );
@@ -38,6 +38,10 @@ class SingleColourFit : public ColourFit
 {
 public:
 	SingleColourFit( ColourSet const* colours, int format, int flags );
+
+	//! Reusable fit, call Init for each block.
+	SingleColourFit( int format, int flags );
+	void Init( ColourSet const* colours );
 	
 private:
 	virtual void Compress3( void* block );
@@ -32,6 +32,9 @@
 #include "alpha.h"
 #include "singlecolourfit.h"
 
+#include <algorithm>
+#include <cstring>
+
 namespace squish {
 
 static int FixFlags( int flags )
@@ -52,15 +55,44 @@ struct Color {
     uint8_t r, g, b, a;
 };
 
-void CompressMasked( u8 * rgba, int mask, void* block, int format, int flags, float const* metric )
+// in bytes
+static int GetBlockSize( int format ) {
+    if (format == kBC1 || format == kBC4) {
+        return 8;
+    }
+    return 16;
+}
+
+BlockCompressor::BlockCompressor( int format, int flags, float const* metric )
+  : m_format( format ),
+    m_flags( FixFlags( flags ) )
 {
-	// fix any bad flags
-	flags = FixFlags( flags );
+    m_colours = new ColourSet();
+    m_clusterFit = new ClusterFit( m_format, m_flags, metric );
+    m_rangeFit = new RangeFit( m_format, m_flags, metric );
+    m_singleColourFit = new SingleColourFit( m_format, m_flags );
+}
 
+BlockCompressor::~BlockCompressor()
+{
+    delete m_colours;
+    delete m_clusterFit;
+    delete m_rangeFit;
+    delete m_singleColourFit;
+}
+
+void BlockCompressor::CompressMasked( u8 const* rgbaSrc, int mask, void* block )
+{
+    int format = m_format;
+    int flags = m_flags;
+    
 	// get the block locations
 	void* colourBlock = block;
 	void* alphaBlock = block;
-    
+
+    // bc4/5 swizzle channels into a, so work on a copy
+    u8 rgba[16*4];
+    memcpy( rgba, rgbaSrc, sizeof( rgba ) );
     Color *colors = (Color*)rgba;
     
     if( format == kBC1 || format == kBC2 || format == kBC3 ) {
@@ -70,27 +102,27 @@ void CompressMasked( u8 * rgba, int mask, void* block, int format, int flags, fl
         }
         
         // create the minimal point set
-        ColourSet colours( rgba, mask, format, flags );
-        int colorCount = colours.GetCount();
+        m_colours->Init( rgba, mask, format, flags );
+        int colorCount = m_colours->GetCount();
         
         // check the compression type and compress colour
         if( colorCount == 1 ) // TODO: could take this for graysccale?
         {
             // always do a single colour fit
-            SingleColourFit fit( &colours, format, flags );
-            fit.Compress( colourBlock );
+            m_singleColourFit->Init( m_colours );
+            m_singleColourFit->Compress( colourBlock );
         }
         else if( ( flags & kColourRangeFit ) != 0 || colorCount == 0 )
         {
             // do a range fit
-            RangeFit fit( &colours, format, flags, metric );
-            fit.Compress( colourBlock );
+            m_rangeFit->Init( m_colours );
+            m_rangeFit->Compress( colourBlock );
         }
         else
         {
             // default to a cluster fit (could be iterative or not)
-            ClusterFit fit( &colours, format, flags, metric );
-            fit.Compress( colourBlock );
+            m_clusterFit->Init( m_colours );
+            m_clusterFit->Compress( colourBlock );
         }
         
         // compress alpha separately if necessary
@@ -122,26 +154,16 @@ void CompressMasked( u8 * rgba, int mask, void* block, int format, int flags, fl
     }
 }
 
-
-// in bytes
-static int GetBlockSize( int format ) {
-    if (format == kBC1 || format == kBC4) {
-        return 8;
-    }
-    return 16;
-}
-
-void CompressImage( u8 const* rgba, int width, int height, void* blocks, int format, int flags, float const *metric )
+void BlockCompressor::CompressBlockRows( u8 const* rgba, int width, int height, void* blocks, 
+    int blockRowStart, int blockRowEnd )
 {
-	// fix any bad flags
-	flags = FixFlags( flags );
-
 	// initialise the block output
-	u8* targetBlock = reinterpret_cast< u8* >( blocks );
-    int bytesPerBlock = GetBlockSize( format );
+    int bytesPerBlock = GetBlockSize( m_format );
+    int blocksX = ( width + 3 ) / 4;
+	u8* targetBlock = reinterpret_cast< u8* >( blocks ) + blockRowStart * blocksX * bytesPerBlock;
     
 	// loop over blocks
-	for( int y = 0; y < height; y += 4 )
+	for( int y = 4*blockRowStart, yEnd = std::min( 4*blockRowEnd, height ); y < yEnd; y += 4 )
 	{
 		for( int x = 0; x < width; x += 4 )
 		{
@@ -178,7 +200,7 @@ void CompressImage( u8 const* rgba, int width, int height, void* blocks, int for
 			}
 			
 			// compress it into the output
-			CompressMasked( sourceRgba, mask, targetBlock, format, flags, metric );
+			CompressMasked( sourceRgba, mask, targetBlock );
 			
 			// advance
 			targetBlock += bytesPerBlock;
@@ -186,7 +208,18 @@ void CompressImage( u8 const* rgba, int width, int height, void* blocks, int for
 	}
 }
  
- 
+void CompressMasked( u8 const* rgba, int mask, void* block, int format, int flags, float const* metric )
+{
+    BlockCompressor compressor( format, flags, metric );
+    compressor.CompressMasked( rgba, mask, block );
+}
+
+void CompressImage( u8 const* rgba, int width, int height, void* blocks, int format, int flags, float const *metric )
+{
+    BlockCompressor compressor( format, flags, metric );
+    compressor.CompressBlockRows( rgba, width, height, blocks, 0, ( height + 3 ) / 4 );
+}
+
 void Decompress( u8* rgba, void const* block, int format )
 {
     // get the block locations
@@ -218,6 +218,49 @@ void CompressImage( u8 const* rgba, int width, int height, void* blocks, int for
 
 // -----------------------------------------------------------------------------
 
+class ColourSet;
+class ClusterFit;
+class RangeFit;
+class SingleColourFit;
+
+/*! @brief Compresses blocks with fit state that is reused across blocks.
+
+	The colour set and fits are allocated once, and then reset for each block
+	instead of being constructed per block. The parameters match 
+	CompressImage. Use one of these per thread, and give each thread 
+	different block rows of the same image to compress.
+*/
+class BlockCompressor
+{
+public:
+	BlockCompressor( int format, int flags, float const* metric = 0 );
+	~BlockCompressor();
+
+	//! Same as squish::CompressMasked.
+	void CompressMasked( u8 const* rgba, int mask, void* block );
+
+	/*! @brief Compresses the 4x4 block rows [blockRowStart, blockRowEnd) of an image.
+	
+		blocks is the storage for the compressed output of the entire image, 
+		and only the blocks of these rows are written.
+	*/
+	void CompressBlockRows( u8 const* rgba, int width, int height, void* blocks, 
+		int blockRowStart, int blockRowEnd );
+
+private:
+	BlockCompressor( BlockCompressor const& );
+	BlockCompressor& operator=( BlockCompressor const& );
+
+	int m_format;
+	int m_flags;
+	ColourSet* m_colours;
+	ClusterFit* m_clusterFit;
+	RangeFit* m_rangeFit;
+	SingleColourFit* m_singleColourFit;
+};
+
+// -----------------------------------------------------------------------------
+
 /*! @brief Decompresses an image in memory.
 
 	@param rgba		Storage for the decompressed pixels.